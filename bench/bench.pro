@@ -0,0 +1,34 @@
+#-------------------------------------------------
+#
+# Benchmarks of libirc and libircclient
+#
+#-------------------------------------------------
+
+QT       += network
+
+QT       -= gui
+
+TARGET = libirc-bench
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+    benchmark.cpp \
+    commands.cpp \
+    listeners.cpp \
+    members.cpp \
+    mockserver.cpp \
+    pmodes.cpp \
+    pool.cpp \
+    registry.cpp \
+    scenarios.cpp \
+    serialization.cpp
+
+HEADERS += benchmark.h \
+    mockserver.h
+
+unix:!macx: LIBS += -L$$PWD/../build-libircclient-Desktop-Debug/ -llibircclient -L$$PWD/../build-libirc-Desktop-Debug/ -llibirc
+
+INCLUDEPATH += $$PWD/../build-libircclient-Desktop-Debug $$PWD/../build-libirc-Desktop-Debug
+DEPENDPATH += $$PWD/../build-libircclient-Desktop-Debug $$PWD/../build-libirc-Desktop-Debug
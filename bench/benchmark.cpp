@@ -0,0 +1,190 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include "../libirc/serveraddress.h"
+#include "../libircclient/floodcontrol.h"
+#include "mockserver.h"
+
+using namespace libircclient;
+
+static bool compareNames(const Benchmark *a, const Benchmark *b)
+{
+    return a->GetName() < b->GetName();
+}
+
+QList<Benchmark*> Benchmark::GetAll()
+{
+    QList<Benchmark*> benchmarks = registry();
+    std::sort(benchmarks.begin(), benchmarks.end(), compareNames);
+    return benchmarks;
+}
+
+void Benchmark::Report(const QString &figure, double value, const QString &unit)
+{
+    printf("    %-48s %16.2f %s\n", figure.toUtf8().constData(), value, unit.toUtf8().constData());
+    fflush(stdout);
+}
+
+bool Benchmark::WaitFor(const std::function<bool()> &condition, int timeout)
+{
+    // Condition may be changed by other threads, so the loop needs to wake up even if this thread gets no events
+    QTimer poll;
+    poll.start(10);
+    QElapsedTimer elapsed;
+    elapsed.start();
+    while (!condition())
+    {
+        if (elapsed.elapsed() > timeout)
+        {
+            printf("    timed out\n");
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+Network *Benchmark::CreateNetwork(MockServer *server, const QString &nick)
+{
+    libirc::ServerAddress address("127.0.0.1", false, server->GetPort(), nick);
+    address.SetSuffix(BENCHMARK_CHANNEL);
+    Network *network = new Network(address, "mock");
+    // Interval 0 turns the flood control off
+    network->SetFloodControl(FloodControl(1, 0));
+    return network;
+}
+
+bool Benchmark::WaitForMembers(MockServer *server, int members)
+{
+    return WaitFor([&]() { return server->GetChannelSize(BENCHMARK_CHANNEL) >= members; });
+}
+
+bool Benchmark::RunScenario(MockServer *server, const QString &label, const std::function<void()> &start)
+{
+    bool finished = false;
+    unsigned long long lines = 0;
+    qint64 msec = 0;
+    QMetaObject::Connection connection = QObject::connect(server, &MockServer::Event_ScenarioFinished,
+                                                          [&](const QString &, unsigned long long scenario_lines, qint64 scenario_msec)
+                                                          {
+                                                              finished = true;
+                                                              lines = scenario_lines;
+                                                              msec = scenario_msec;
+                                                          });
+    start();
+    bool result = WaitFor([&]() { return finished; });
+    QObject::disconnect(connection);
+    if (!result)
+        return false;
+    Report(label + " time", static_cast<double>(msec), "ms");
+    Report(label + " lines", static_cast<double>(lines), "lines");
+    if (msec > 0)
+        Report(label + " throughput", static_cast<double>(lines) * 1000 / msec, "lines/s");
+    return true;
+}
+
+bool Benchmark::ReportLatency(MockServer *server, int samples)
+{
+    server->ResetStatistics();
+    for (int i = 0; i < samples; i++)
+    {
+        unsigned long long expected = server->GetStatistics().LatencySamples + static_cast<unsigned long long>(server->GetClientCount());
+        server->MeasureLatency();
+        if (!WaitFor([&]() { return server->GetStatistics().LatencySamples >= expected; }))
+            return false;
+    }
+    MockServerStatistics statistics = server->GetStatistics();
+    if (!statistics.LatencySamples)
+        return false;
+    Report("PING round trip average", static_cast<double>(statistics.LatencyTotal) / statistics.LatencySamples, "us");
+    Report("PING round trip min", static_cast<double>(statistics.LatencyMin), "us");
+    Report("PING round trip max", static_cast<double>(statistics.LatencyMax), "us");
+    return true;
+}
+
+Benchmark::Benchmark(const char *name, const char *description, bool (*function)())
+{
+    this->name = name;
+    this->description = description;
+    this->function = function;
+    registry().append(this);
+}
+
+QString Benchmark::GetName() const
+{
+    return this->name;
+}
+
+QString Benchmark::GetDescription() const
+{
+    return this->description;
+}
+
+bool Benchmark::Run()
+{
+    return this->function();
+}
+
+QList<Benchmark*> &Benchmark::registry()
+{
+    // Function local, because benchmarks register themselves during static initialization of other files
+    static QList<Benchmark*> benchmarks;
+    return benchmarks;
+}
+
+BenchmarkNetwork *BenchmarkNetwork::Create(const QString &nick)
+{
+    libirc::ServerAddress address("127.0.0.1", false, 6667, nick);
+    return new BenchmarkNetwork(address);
+}
+
+QList<QByteArray> BenchmarkNetwork::ChannelJoins(const QString &nick, int users)
+{
+    QList<QByteArray> lines;
+    lines.append(QString(":" + nick + "!ident@bench.host JOIN " + BENCHMARK_CHANNEL + "\r\n").toUtf8());
+    for (int i = 0; i < users; i++)
+    {
+        QString user = "user" + QString::number(i);
+        lines.append(QString(":" + user + "!" + user + "@" + user + ".bench.host JOIN " + BENCHMARK_CHANNEL + "\r\n").toUtf8());
+    }
+    return lines;
+}
+
+QList<QByteArray> BenchmarkNetwork::ChannelMessages(int users, int messages)
+{
+    QList<QByteArray> lines;
+    for (int i = 0; i < messages; i++)
+    {
+        QString user = "user" + QString::number(i % users);
+        lines.append(QString(":" + user + "!" + user + "@" + user + ".bench.host PRIVMSG " + BENCHMARK_CHANNEL +
+                             " :Hello, this is message number " + QString::number(i) + "\r\n").toUtf8());
+    }
+    return lines;
+}
+
+BenchmarkNetwork::BenchmarkNetwork(libirc::ServerAddress &server) : Network(server, "bench")
+{
+
+}
+
+void BenchmarkNetwork::Feed(const QList<QByteArray> &lines)
+{
+    foreach (const QByteArray &line, lines)
+        this->OnReceive(line);
+}
@@ -0,0 +1,89 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <functional>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include "../libircclient/network.h"
+
+class MockServer;
+
+//! Channel that benchmarks work with, networks created by Benchmark::CreateNetwork() join it
+#define BENCHMARK_CHANNEL "#bench"
+
+/*!
+ * Defines a benchmark, it's registered on startup and can be selected by its name on command line. The body returns
+ * false if the benchmark couldn't finish or its results are not valid.
+ */
+#define BENCHMARK(name, description) static bool benchmark_##name(); \
+                                     static Benchmark benchmark_registration_##name(#name, description, benchmark_##name); \
+                                     static bool benchmark_##name()
+
+class Benchmark
+{
+    public:
+        //! Returns all registered benchmarks sorted by name
+        static QList<Benchmark*> GetAll();
+        //! Prints one figure measured by benchmark
+        static void Report(const QString &figure, double value, const QString &unit);
+        //! Runs event loop of current thread until condition is true, returns false if it didn't happen in time
+        static bool WaitFor(const std::function<bool()> &condition, int timeout = 120000);
+        /*!
+         * \brief CreateNetwork creates network that connects to the mock server and joins BENCHMARK_CHANNEL
+         *
+         * The network has no flood control, so that only the speed of parsing is measured. It isn't connected yet,
+         * so that it can be moved to another thread first.
+         */
+        static libircclient::Network *CreateNetwork(MockServer *server, const QString &nick);
+        //! Waits until BENCHMARK_CHANNEL on mock server has at least given number of members
+        static bool WaitForMembers(MockServer *server, int members);
+        //! Starts a scenario of mock server, waits until all clients processed it and reports its figures
+        static bool RunScenario(MockServer *server, const QString &label, const std::function<void()> &start);
+        //! Measures round trip of PING to all clients of mock server
+        static bool ReportLatency(MockServer *server, int samples = 100);
+
+        Benchmark(const char *name, const char *description, bool (*function)());
+        QString GetName() const;
+        QString GetDescription() const;
+        bool Run();
+
+    private:
+        static QList<Benchmark*> &registry();
+        QString name;
+        QString description;
+        bool (*function)();
+};
+
+/*!
+ * \brief The BenchmarkNetwork class is a network that gets its lines directly instead of reading them from socket
+ *
+ * It's never connected, so only processing of the lines is measured, the socket and the other side are not involved.
+ */
+class BenchmarkNetwork : public libircclient::Network
+{
+    public:
+        static BenchmarkNetwork *Create(const QString &nick = "bench");
+        //! Returns lines in which the network and given number of users join BENCHMARK_CHANNEL
+        static QList<QByteArray> ChannelJoins(const QString &nick, int users);
+        //! Returns given number of messages sent to BENCHMARK_CHANNEL by users from ChannelJoins()
+        static QList<QByteArray> ChannelMessages(int users, int messages);
+
+        BenchmarkNetwork(libirc::ServerAddress &server);
+        //! Processes lines as if they were received from server, every line has to end with newline
+        void Feed(const QList<QByteArray> &lines);
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,82 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "benchmark.h"
+#include <cstring>
+#include <QElapsedTimer>
+#include "../libirc/irc_numerics.h"
+#include "../libircclient/parser.h"
+
+#define BENCH_COMMAND_LOOKUPS 2000000
+
+using namespace libircclient;
+
+//! Mix of commands roughly as they come from busy network, with one unknown command
+static const char *commands[] = { "PRIVMSG", "PRIVMSG", "PRIVMSG", "JOIN", "PART", "QUIT", "NOTICE", "MODE", "PING", "353",
+                                  "366", "001", "005", "NICK", "CHGHOST", "AWAY", "KICK", "TOPIC", "ACCOUNT" };
+
+struct NamedCommand
+{
+    const char *Name;
+    int Numeric;
+};
+
+//! Commands in order in which Parser compared them before they were looked up in constant time
+static const NamedCommand namedCommands[] = { { "PING", IRC_NUMERIC_RAW_PING }, { "JOIN", IRC_NUMERIC_RAW_JOIN },
+                                              { "NICK", IRC_NUMERIC_RAW_NICK }, { "PONG", IRC_NUMERIC_RAW_PONG },
+                                              { "NOTICE", IRC_NUMERIC_RAW_NOTICE }, { "MODE", IRC_NUMERIC_RAW_MODE },
+                                              { "PRIVMSG", IRC_NUMERIC_RAW_PRIVMSG }, { "KICK", IRC_NUMERIC_RAW_KICK },
+                                              { "TOPIC", IRC_NUMERIC_RAW_TOPIC }, { "PART", IRC_NUMERIC_RAW_PART },
+                                              { "CTCP", IRC_NUMERIC_RAW_CTCP }, { "QUIT", IRC_NUMERIC_RAW_QUIT },
+                                              { "AWAY", IRC_NUMERIC_RAW_AWAY }, { "CAP", IRC_NUMERIC_RAW_CAP },
+                                              { "METADATA", IRC_NUMERIC_RAW_METADATA }, { "INVITE", IRC_NUMERIC_RAW_INVITE },
+                                              { "CHGHOST", IRC_NUMERIC_RAW_CHGHOST } };
+
+//! Previous implementation, toInt() followed by a chain of string comparisons
+static int chainToNumeric(const QString &command)
+{
+    int numeric = command.toInt();
+    if (numeric != 0)
+        return numeric;
+    for (size_t i = 0; i < sizeof(namedCommands) / sizeof(NamedCommand); i++)
+    {
+        if (command == namedCommands[i].Name)
+            return namedCommands[i].Numeric;
+    }
+    return IRC_NUMERIC_INVALID;
+}
+
+BENCHMARK(command_lookup, "conversion of command of IRC line to numeric, constant time lookup against string comparisons")
+{
+    const int count = static_cast<int>(sizeof(commands) / sizeof(const char*));
+    QList<QString> strings;
+    for (int i = 0; i < count; i++)
+        strings.append(QString(commands[i]));
+    // Results are summed up so that the compiler can't skip the lookups, both have to give the same sum
+    long long chain_sum = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < BENCH_COMMAND_LOOKUPS; i++)
+        chain_sum += chainToNumeric(strings.at(i % count));
+    qint64 chain_time = timer.nsecsElapsed();
+    long long lookup_sum = 0;
+    timer.restart();
+    for (int i = 0; i < BENCH_COMMAND_LOOKUPS; i++)
+    {
+        const char *command = commands[i % count];
+        lookup_sum += Parser::CommandToNumeric(command, static_cast<int>(strlen(command)));
+    }
+    qint64 lookup_time = timer.nsecsElapsed();
+    Benchmark::Report("string comparisons", static_cast<double>(chain_time) / BENCH_COMMAND_LOOKUPS, "ns/command");
+    Benchmark::Report("CommandToNumeric", static_cast<double>(lookup_time) / BENCH_COMMAND_LOOKUPS, "ns/command");
+    return chain_sum == lookup_sum;
+}
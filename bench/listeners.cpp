@@ -0,0 +1,58 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "benchmark.h"
+#include <QElapsedTimer>
+#include "../libircclient/channel.h"
+
+#define BENCH_LISTENERS_USERS 100
+#define BENCH_LISTENERS_LINES 100000
+
+using namespace libircclient;
+
+//! Feeds the messages to network and reports how many lines per second it processed
+static void measure(BenchmarkNetwork *network, const QList<QByteArray> &messages, const QString &label)
+{
+    QElapsedTimer timer;
+    timer.start();
+    network->Feed(messages);
+    qint64 nsec = timer.nsecsElapsed();
+    Benchmark::Report(label, static_cast<double>(messages.size()) * 1000000000 / nsec, "lines/s");
+}
+
+BENCHMARK(listeners, "channel messages processed with no listeners connected to the network and with all of them")
+{
+    BenchmarkNetwork *network = BenchmarkNetwork::Create();
+    network->Feed(BenchmarkNetwork::ChannelJoins("bench", BENCH_LISTENERS_USERS));
+    QList<QByteArray> messages = BenchmarkNetwork::ChannelMessages(BENCH_LISTENERS_USERS, BENCH_LISTENERS_LINES);
+    measure(network, messages, "no listeners");
+    // Every signal network checks before it does the work needed to emit it
+    unsigned long long events = 0;
+    QList<QMetaObject::Connection> connections;
+    connections.append(QObject::connect(network, &Network::Event_RawIncoming, [&]() { events++; }));
+    connections.append(QObject::connect(network, &Network::Event_RawOutgoing, [&]() { events++; }));
+    connections.append(QObject::connect(network, &Network::Event_Parse, [&]() { events++; }));
+    connections.append(QObject::connect(network, &Network::Event_Unknown, [&]() { events++; }));
+    connections.append(QObject::connect(network, &Network::Event_WhoisGeneric, [&]() { events++; }));
+    connections.append(QObject::connect(network, &Network::Event_NICK, [&]() { events++; }));
+    connections.append(QObject::connect(network, &Network::Event_SelfNICK, [&]() { events++; }));
+    connections.append(QObject::connect(network, &Network::Event_CHGHOST, [&]() { events++; }));
+    connections.append(QObject::connect(network, &Network::Event_SelfCHGHOST, [&]() { events++; }));
+    measure(network, messages, "all listeners");
+    foreach (QMetaObject::Connection connection, connections)
+        QObject::disconnect(connection);
+    Channel *channel = network->GetChannel(BENCHMARK_CHANNEL);
+    bool joined = channel && channel->GetUserCount() == BENCH_LISTENERS_USERS + 1;
+    delete network;
+    // Listeners must have really been called, otherwise both runs measured the same thing
+    return joined && events >= BENCH_LISTENERS_LINES;
+}
@@ -0,0 +1,49 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include <cstdio>
+#include <QCoreApplication>
+#include <QList>
+#include <QString>
+#include "benchmark.h"
+
+// Usage: libirc-bench [--list] [name...], without names all benchmarks are run
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QList<QString> selected;
+    bool list = false;
+    for (int i = 1; i < argc; i++)
+    {
+        QString argument = QString::fromLocal8Bit(argv[i]);
+        if (argument == "--list")
+            list = true;
+        else
+            selected.append(argument);
+    }
+    int failed = 0;
+    foreach (Benchmark *benchmark, Benchmark::GetAll())
+    {
+        if (!selected.isEmpty() && !selected.contains(benchmark->GetName()))
+            continue;
+        printf("%s: %s\n", benchmark->GetName().toUtf8().constData(), benchmark->GetDescription().toUtf8().constData());
+        fflush(stdout);
+        if (list)
+            continue;
+        if (!benchmark->Run())
+        {
+            printf("    FAILED\n");
+            failed++;
+        }
+    }
+    return failed ? 1 : 0;
+}
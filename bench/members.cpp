@@ -0,0 +1,79 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "benchmark.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include "../libircclient/channel.h"
+#include "../libircclient/user.h"
+
+#define BENCH_MEMBERS 50000
+
+using namespace libircclient;
+
+BENCHMARK(member_table, "channel with 50000 members, memory of member table and time of insert, lookup and removal")
+{
+    QList<QString> nicks;
+    for (int i = 0; i < BENCH_MEMBERS; i++)
+        nicks.append(QString("user") + QString::number(i));
+    Channel channel(BENCHMARK_CHANNEL);
+    QElapsedTimer timer;
+    timer.start();
+    foreach (QString nick, nicks)
+    {
+        User user(nick + "!ident@host");
+        channel.InsertUser(&user);
+    }
+    qint64 insert_time = timer.nsecsElapsed();
+    if (channel.GetUserCount() != BENCH_MEMBERS)
+        return false;
+    qint64 memory = channel.GetMembershipMemoryUsage();
+    Benchmark::Report("member table", static_cast<double>(memory) / 1024, "KiB");
+    Benchmark::Report("member table per member", static_cast<double>(memory) / BENCH_MEMBERS, "bytes");
+    Benchmark::Report("insert", static_cast<double>(insert_time) / BENCH_MEMBERS, "ns/member");
+
+    // Keys are made before the timer starts, so that only the table is measured
+    QList<NickKey> keys;
+    foreach (QString nick, nicks)
+        keys.append(channel.GetNickKey(nick));
+    int found = 0;
+    timer.restart();
+    foreach (NickKey key, keys)
+    {
+        if (channel.GetUser(key))
+            found++;
+    }
+    qint64 lookup_time = timer.nsecsElapsed();
+    Benchmark::Report("lookup", static_cast<double>(lookup_time) / BENCH_MEMBERS, "ns/member");
+
+    // Same lookups in QHash, which is how members were stored before
+    QHash<NickKey, User*> hash;
+    hash.reserve(BENCH_MEMBERS);
+    foreach (NickKey key, keys)
+        hash.insert(key, channel.GetUser(key));
+    int hash_found = 0;
+    timer.restart();
+    foreach (NickKey key, keys)
+    {
+        if (hash.value(key))
+            hash_found++;
+    }
+    qint64 hash_time = timer.nsecsElapsed();
+    Benchmark::Report("QHash lookup", static_cast<double>(hash_time) / BENCH_MEMBERS, "ns/member");
+
+    timer.restart();
+    foreach (NickKey key, keys)
+        channel.RemoveUser(key);
+    qint64 remove_time = timer.nsecsElapsed();
+    Benchmark::Report("removal", static_cast<double>(remove_time) / BENCH_MEMBERS, "ns/member");
+    return found == BENCH_MEMBERS && hash_found == BENCH_MEMBERS && channel.GetUserCount() == 0;
+}
@@ -0,0 +1,888 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "mockserver.h"
+#include <QDateTime>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "../libirc/irc_numerics.h"
+
+//! Numerics that are not in irc_numerics.h because client never needs them
+#define MOCK_NUMERIC_UMODEIS            221
+#define MOCK_NUMERIC_ERR_NONICKNAME     431
+#define MOCK_NUMERIC_ERR_NOTONCHANNEL   442
+#define MOCK_NUMERIC_ERR_NOTREGISTERED  451
+#define MOCK_NUMERIC_ERR_NEEDMOREPARAMS 461
+
+//! Length of NAMES reply after which the rest of names goes to next line
+#define MOCK_NAMES_LENGTH 400
+
+using namespace libircclient;
+
+//! Splits text by spaces, empty parts are skipped
+static QList<QString> splitWords(const QString &text)
+{
+    QList<QString> words;
+    foreach (const QString &word, text.split(' '))
+    {
+        if (!word.isEmpty())
+            words.append(word);
+    }
+    return words;
+}
+
+static QString joinWords(const QList<QString> &words)
+{
+    QString text;
+    foreach (const QString &word, words)
+    {
+        if (!text.isEmpty())
+            text += " ";
+        text += word;
+    }
+    return text;
+}
+
+MockServer::MockServer(const QString &name, QObject *parent) : QObject(parent)
+{
+    this->name = name;
+    this->capabilities << "multi-prefix";
+    this->server = new QTcpServer(this);
+    this->clock.start();
+    connect(this->server, SIGNAL(newConnection()), this, SLOT(OnNewConnection()));
+}
+
+MockServer::~MockServer()
+{
+    this->Close();
+    qDeleteAll(this->channels);
+}
+
+bool MockServer::Listen(quint16 port)
+{
+    return this->server->listen(QHostAddress::LocalHost, port);
+}
+
+void MockServer::Close()
+{
+    this->server->close();
+    foreach (Client *client, this->clients)
+    {
+        foreach (const NickKey &channel_key, client->Channels)
+        {
+            Channel *channel = this->channels.value(channel_key);
+            if (channel)
+                channel->Members.remove(this->key(client->User.GetNick()));
+        }
+        client->Socket->disconnect(this);
+        client->Socket->abort();
+        client->Socket->deleteLater();
+        delete client;
+    }
+    this->clients.clear();
+    this->clientsByNick.clear();
+    this->scenarioClients.clear();
+}
+
+quint16 MockServer::GetPort() const
+{
+    return this->server->serverPort();
+}
+
+QString MockServer::GetServerName() const
+{
+    return this->name;
+}
+
+void MockServer::SetCapabilities(const QList<QString> &capabilities)
+{
+    this->capabilities = capabilities;
+}
+
+QList<QString> MockServer::GetCapabilities() const
+{
+    return this->capabilities;
+}
+
+int MockServer::GetClientCount() const
+{
+    return this->clients.size();
+}
+
+int MockServer::GetFakeUserCount() const
+{
+    return this->fakeUsers.size();
+}
+
+int MockServer::GetChannelSize(const QString &channel_name)
+{
+    Channel *channel = this->getChannel(channel_name, false);
+    if (!channel)
+        return 0;
+    return channel->Members.size();
+}
+
+void MockServer::AddFakeUsers(const QString &channel_name, int count, const QString &prefix)
+{
+    Channel *channel = this->getChannel(channel_name, true);
+    if (!channel)
+        return;
+    NickKey channel_key = this->key(channel->Info.GetName());
+    for (int i = 0; i < count; i++)
+    {
+        QString nick = prefix + QString::number(++this->nextFakeUser);
+        NickKey nick_key = this->key(nick);
+        if (this->clientsByNick.contains(nick_key) || this->fakeUsers.contains(nick_key))
+            continue;
+        FakeUser user;
+        user.User.SetNick(nick);
+        user.User.SetIdent("fake");
+        user.User.SetHost("users." + this->name);
+        user.User.SetRealname("Fake user");
+        user.Channels.append(channel_key);
+        Member member = { nick, nullptr, false, false };
+        channel->Members.insert(nick_key, member);
+        this->sendToChannel(channel, ":" + userString(user.User) + " JOIN " + channel->Info.GetName());
+        this->fakeUsers.insert(nick_key, user);
+    }
+}
+
+void MockServer::NamesBurst(const QString &channel_name)
+{
+    this->beginScenario("names");
+    QList<Client*> recipients;
+    Channel *channel = this->getChannel(channel_name, false);
+    if (channel)
+    {
+        foreach (const Member &member, channel->Members)
+        {
+            if (!member.Connection)
+                continue;
+            this->sendNames(member.Connection, channel);
+            recipients.append(member.Connection);
+        }
+    }
+    this->endScenario(recipients);
+}
+
+void MockServer::FloodChannel(const QString &channel_name, int lines, const QString &text)
+{
+    this->beginScenario("flood");
+    QList<Client*> recipients;
+    Channel *channel = this->getChannel(channel_name, false);
+    if (channel)
+    {
+        QList<QString> senders;
+        foreach (const Member &member, channel->Members)
+        {
+            if (member.Connection)
+                recipients.append(member.Connection);
+            else
+                senders.append(userString(this->fakeUsers.value(this->key(member.Nick)).User));
+        }
+        // Without fake users the messages come from server itself
+        if (senders.isEmpty())
+            senders.append(this->name);
+        for (int i = 0; i < lines; i++)
+        {
+            QByteArray data = QString(":" + senders.at(i % senders.size()) + " PRIVMSG " + channel->Info.GetName() + " :" +
+                                      text + " " + QString::number(i) + "\r\n").toUtf8();
+            foreach (Client *client, recipients)
+                this->sendData(client, data);
+        }
+    }
+    this->endScenario(recipients);
+}
+
+int MockServer::Netsplit(int count, const QString &reason)
+{
+    QString quit_reason = reason;
+    // This is how real servers tell the clients that users quit because of split
+    if (quit_reason.isEmpty())
+        quit_reason = this->name + " split." + this->name;
+    this->beginScenario("netsplit");
+    QSet<Client*> recipients;
+    QList<NickKey> victims = this->fakeUsers.keys().mid(0, qMax(0, count));
+    foreach (const NickKey &nick_key, victims)
+    {
+        FakeUser user = this->fakeUsers.take(nick_key);
+        QSet<Client*> targets;
+        foreach (const NickKey &channel_key, user.Channels)
+        {
+            Channel *channel = this->channels.value(channel_key);
+            if (!channel)
+                continue;
+            channel->Members.remove(nick_key);
+            foreach (const Member &member, channel->Members)
+            {
+                if (member.Connection)
+                    targets.insert(member.Connection);
+            }
+            if (channel->Members.isEmpty())
+            {
+                this->channels.remove(channel_key);
+                delete channel;
+            }
+        }
+        // Every client gets one QUIT, no matter how many channels it shares with the user
+        QByteArray data = QString(":" + userString(user.User) + " QUIT :" + quit_reason + "\r\n").toUtf8();
+        foreach (Client *client, targets)
+            this->sendData(client, data);
+        recipients.unite(targets);
+    }
+    this->endScenario(recipients.values());
+    return victims.size();
+}
+
+void MockServer::MeasureLatency()
+{
+    foreach (Client *client, this->clients)
+    {
+        if (client->Registered)
+            this->send(client, "PING :latency-" + QString::number(this->clock.nsecsElapsed() / 1000));
+    }
+}
+
+bool MockServer::IsScenarioRunning() const
+{
+    return !this->scenarioClients.isEmpty();
+}
+
+MockServerStatistics MockServer::GetStatistics() const
+{
+    return this->statistics;
+}
+
+void MockServer::ResetStatistics()
+{
+    this->statistics = MockServerStatistics();
+}
+
+void MockServer::OnNewConnection()
+{
+    while (this->server->hasPendingConnections())
+    {
+        QTcpSocket *socket = this->server->nextPendingConnection();
+        Client *client = new Client();
+        client->Socket = socket;
+        client->User.SetHost(socket->peerAddress().toString());
+        this->clients.insert(socket, client);
+        this->statistics.Connections++;
+        connect(socket, SIGNAL(readyRead()), this, SLOT(OnReadyRead()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(OnDisconnected()));
+    }
+}
+
+void MockServer::OnReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(QObject::sender());
+    Client *client = this->clients.value(socket);
+    if (!client)
+        return;
+    QByteArray data = socket->readAll();
+    this->statistics.BytesReceived += static_cast<unsigned long long>(data.size());
+    client->Buffer.append(data);
+    int position = 0;
+    int end;
+    while ((end = client->Buffer.indexOf('\n', position)) >= 0)
+    {
+        QByteArray line = client->Buffer.mid(position, end - position);
+        position = end + 1;
+        if (line.endsWith('\r'))
+            line.chop(1);
+        if (line.isEmpty())
+            continue;
+        this->processLine(client, line);
+        // Client may have quit
+        if (!this->clients.contains(socket))
+            return;
+    }
+    client->Buffer.remove(0, position);
+}
+
+void MockServer::OnDisconnected()
+{
+    Client *client = this->clients.value(qobject_cast<QTcpSocket*>(QObject::sender()));
+    if (client)
+        this->removeClient(client, "Connection closed");
+}
+
+QString MockServer::userString(const libirc::User &user)
+{
+    return user.GetNick() + "!" + user.GetIdent() + "@" + user.GetHost();
+}
+
+QString MockServer::memberPrefix(const Member &member, bool multi_prefix)
+{
+    QString prefix;
+    if (member.Op)
+        prefix += "@";
+    if (member.Voice && (multi_prefix || prefix.isEmpty()))
+        prefix += "+";
+    return prefix;
+}
+
+void MockServer::processLine(Client *client, const QByteArray &line)
+{
+    this->statistics.LinesReceived++;
+    QString text = QString::fromUtf8(line);
+    int position = 0;
+    // Tags and source are ignored, clients shouldn't send the source anyway
+    if (text.startsWith('@'))
+    {
+        position = text.indexOf(' ');
+        if (position < 0)
+            return;
+        position++;
+    }
+    if (text.mid(position).startsWith(':'))
+    {
+        position = text.indexOf(' ', position);
+        if (position < 0)
+            return;
+        position++;
+    }
+    QString command;
+    QList<QString> parameters;
+    int trailing = text.indexOf(" :", position);
+    QString middle = trailing < 0 ? text.mid(position) : text.mid(position, trailing - position);
+    parameters = splitWords(middle);
+    if (parameters.isEmpty())
+        return;
+    command = parameters.takeFirst().toUpper();
+    if (trailing >= 0)
+        parameters.append(text.mid(trailing + 2));
+
+    if (command == "CAP")
+    {
+        this->processCap(client, parameters);
+    } else if (command == "NICK")
+    {
+        this->processNick(client, parameters);
+    } else if (command == "USER")
+    {
+        if (parameters.size() < 4)
+        {
+            this->sendNumeric(client, MOCK_NUMERIC_ERR_NEEDMOREPARAMS, "USER :Not enough parameters");
+            return;
+        }
+        if (client->Registered)
+            return;
+        client->User.SetIdent(parameters[0]);
+        client->User.SetRealname(parameters[3]);
+        client->HasUser = true;
+        this->tryRegister(client);
+    } else if (command == "PASS")
+    {
+        // There are no passwords here
+    } else if (command == "PING")
+    {
+        this->send(client, ":" + this->name + " PONG " + this->name + " :" + parameters.value(0));
+    } else if (command == "PONG")
+    {
+        this->processPong(client, parameters.isEmpty() ? QString() : parameters.last());
+    } else if (command == "QUIT")
+    {
+        this->removeClient(client, "Quit: " + parameters.value(0));
+    } else if (!client->Registered)
+    {
+        this->sendNumeric(client, MOCK_NUMERIC_ERR_NOTREGISTERED, ":You have not registered");
+    } else if (command == "JOIN")
+    {
+        foreach (const QString &channel, parameters.value(0).split(','))
+            this->processJoin(client, channel);
+    } else if (command == "PART")
+    {
+        foreach (const QString &channel, parameters.value(0).split(','))
+            this->processPart(client, channel, parameters.value(1));
+    } else if (command == "NAMES")
+    {
+        Channel *channel = this->getChannel(parameters.value(0), false);
+        if (channel)
+            this->sendNames(client, channel);
+        else
+            this->sendNumeric(client, IRC_NUMERIC_ENDOFNAMES, parameters.value(0) + " :End of /NAMES list.");
+    } else if (command == "WHO")
+    {
+        this->processWho(client, parameters.value(0));
+    } else if (command == "MODE")
+    {
+        this->processMode(client, parameters);
+    } else if (command == "TOPIC")
+    {
+        this->processTopic(client, parameters);
+    } else if (command == "PRIVMSG" || command == "NOTICE")
+    {
+        this->processMessage(client, command, parameters);
+    } else
+    {
+        this->sendNumeric(client, IRC_NUMERIC_UNKNOWN, command + " :Unknown command");
+    }
+}
+
+void MockServer::processCap(Client *client, const QList<QString> &parameters)
+{
+    QString subcommand = parameters.value(0).toUpper();
+    QString nick = client->User.GetNick().isEmpty() ? "*" : client->User.GetNick();
+    if (subcommand == "LS")
+    {
+        if (!client->Registered)
+            client->CapNegotiation = true;
+        this->send(client, ":" + this->name + " CAP " + nick + " LS :" + joinWords(this->capabilities));
+    } else if (subcommand == "LIST")
+    {
+        this->send(client, ":" + this->name + " CAP " + nick + " LIST :" + joinWords(client->Capabilities));
+    } else if (subcommand == "REQ")
+    {
+        if (!client->Registered)
+            client->CapNegotiation = true;
+        QList<QString> requested = splitWords(parameters.value(1));
+        // Request is either accepted or refused as a whole
+        foreach (const QString &capability, requested)
+        {
+            if (!this->capabilities.contains(capability))
+            {
+                this->send(client, ":" + this->name + " CAP " + nick + " NAK :" + parameters.value(1));
+                return;
+            }
+        }
+        foreach (const QString &capability, requested)
+        {
+            if (!client->Capabilities.contains(capability))
+                client->Capabilities.append(capability);
+        }
+        this->send(client, ":" + this->name + " CAP " + nick + " ACK :" + parameters.value(1));
+    } else if (subcommand == "END")
+    {
+        client->CapNegotiation = false;
+        this->tryRegister(client);
+    } else
+    {
+        this->sendNumeric(client, IRC_NUMERIC_ERR_INVALIDCAPCMD, subcommand + " :Invalid CAP command");
+    }
+}
+
+void MockServer::processNick(Client *client, const QList<QString> &parameters)
+{
+    QString nick = parameters.value(0);
+    if (nick.isEmpty())
+    {
+        this->sendNumeric(client, MOCK_NUMERIC_ERR_NONICKNAME, ":No nickname given");
+        return;
+    }
+    NickKey nick_key = this->key(nick);
+    NickKey old_key = this->key(client->User.GetNick());
+    Client *owner = this->clientsByNick.value(nick_key);
+    if ((owner && owner != client) || this->fakeUsers.contains(nick_key))
+    {
+        this->sendNumeric(client, IRC_NUMERIC_NICKUSED, nick + " :Nickname is already in use");
+        return;
+    }
+    QString source = userString(client->User);
+    if (this->clientsByNick.value(old_key) == client)
+        this->clientsByNick.remove(old_key);
+    client->User.SetNick(nick);
+    this->clientsByNick.insert(nick_key, client);
+    if (!client->Registered)
+    {
+        this->tryRegister(client);
+        return;
+    }
+    QSet<Client*> recipients;
+    recipients.insert(client);
+    foreach (const NickKey &channel_key, client->Channels)
+    {
+        Channel *channel = this->channels.value(channel_key);
+        if (!channel)
+            continue;
+        Member member = channel->Members.take(old_key);
+        member.Nick = nick;
+        channel->Members.insert(nick_key, member);
+        foreach (const Member &peer, channel->Members)
+        {
+            if (peer.Connection)
+                recipients.insert(peer.Connection);
+        }
+    }
+    QByteArray data = QString(":" + source + " NICK :" + nick + "\r\n").toUtf8();
+    foreach (Client *recipient, recipients)
+        this->sendData(recipient, data);
+}
+
+void MockServer::processJoin(Client *client, const QString &name)
+{
+    if (!name.startsWith('#'))
+    {
+        this->sendNumeric(client, IRC_NUMERIC_ERR_NOSUCHCHANNEL, name + " :No such channel");
+        return;
+    }
+    Channel *channel = this->getChannel(name, true);
+    NickKey nick_key = this->key(client->User.GetNick());
+    if (channel->Members.contains(nick_key))
+        return;
+    Member member = { client->User.GetNick(), client, channel->Members.isEmpty(), false };
+    channel->Members.insert(nick_key, member);
+    client->Channels.append(this->key(channel->Info.GetName()));
+    this->sendToChannel(channel, ":" + userString(client->User) + " JOIN " + channel->Info.GetName());
+    if (!channel->Info.GetTopic().isEmpty())
+        this->sendNumeric(client, IRC_NUMERIC_TOPICINFO, channel->Info.GetName() + " :" + channel->Info.GetTopic());
+    this->sendNames(client, channel);
+}
+
+void MockServer::processPart(Client *client, const QString &name, const QString &reason)
+{
+    Channel *channel = this->getChannel(name, false);
+    NickKey nick_key = this->key(client->User.GetNick());
+    if (!channel || !channel->Members.contains(nick_key))
+    {
+        this->sendNumeric(client, MOCK_NUMERIC_ERR_NOTONCHANNEL, name + " :You're not on that channel");
+        return;
+    }
+    QString line = ":" + userString(client->User) + " PART " + channel->Info.GetName();
+    if (!reason.isEmpty())
+        line += " :" + reason;
+    this->sendToChannel(channel, line);
+    channel->Members.remove(nick_key);
+    NickKey channel_key = this->key(channel->Info.GetName());
+    client->Channels.removeOne(channel_key);
+    if (channel->Members.isEmpty())
+    {
+        this->channels.remove(channel_key);
+        delete channel;
+    }
+}
+
+void MockServer::processMode(Client *client, const QList<QString> &parameters)
+{
+    QString target = parameters.value(0);
+    if (target.isEmpty())
+    {
+        this->sendNumeric(client, MOCK_NUMERIC_ERR_NEEDMOREPARAMS, "MODE :Not enough parameters");
+        return;
+    }
+    if (!target.startsWith('#'))
+    {
+        // User modes are not really tracked, we just confirm whatever user wants
+        if (parameters.size() < 2)
+            this->sendNumeric(client, MOCK_NUMERIC_UMODEIS, "+i");
+        else
+            this->send(client, ":" + client->User.GetNick() + " MODE " + client->User.GetNick() + " :" + parameters.at(1));
+        return;
+    }
+    Channel *channel = this->getChannel(target, false);
+    if (!channel)
+    {
+        this->sendNumeric(client, IRC_NUMERIC_ERR_NOSUCHCHANNEL, target + " :No such channel");
+        return;
+    }
+    if (parameters.size() < 2)
+    {
+        this->sendNumeric(client, IRC_NUMERIC_MODEINFO, channel->Info.GetName() + " +" + channel->Modes);
+        return;
+    }
+    QString modes = parameters.at(1);
+    if (modes == "b" || modes == "+b")
+    {
+        if (parameters.size() < 3)
+        {
+            this->sendNumeric(client, IRC_NUMERIC_ENDOFBANS, channel->Info.GetName() + " :End of channel ban list");
+            return;
+        }
+    }
+    bool adding = true;
+    int parameter = 2;
+    foreach (QChar mode, modes)
+    {
+        char c = mode.toLatin1();
+        if (c == '+' || c == '-')
+        {
+            adding = c == '+';
+        } else if (c == 'o' || c == 'v')
+        {
+            NickKey nick_key = this->key(parameters.value(parameter++));
+            if (!channel->Members.contains(nick_key))
+                continue;
+            if (c == 'o')
+                channel->Members[nick_key].Op = adding;
+            else
+                channel->Members[nick_key].Voice = adding;
+        } else if (c == 'b' || c == 'k' || (c == 'l' && adding))
+        {
+            // Lists and modes with parameters are only relayed
+            parameter++;
+        } else if (adding && !channel->Modes.contains(mode))
+        {
+            channel->Modes += mode;
+        } else if (!adding)
+        {
+            channel->Modes.remove(mode);
+        }
+    }
+    this->sendToChannel(channel, ":" + userString(client->User) + " MODE " + channel->Info.GetName() + " " +
+                                 joinWords(parameters.mid(1)));
+}
+
+void MockServer::processTopic(Client *client, const QList<QString> &parameters)
+{
+    Channel *channel = this->getChannel(parameters.value(0), false);
+    if (!channel)
+    {
+        this->sendNumeric(client, IRC_NUMERIC_ERR_NOSUCHCHANNEL, parameters.value(0) + " :No such channel");
+        return;
+    }
+    if (parameters.size() < 2)
+    {
+        if (channel->Info.GetTopic().isEmpty())
+            this->sendNumeric(client, IRC_NUMERIC_NOTOPIC, channel->Info.GetName() + " :No topic is set");
+        else
+            this->sendNumeric(client, IRC_NUMERIC_TOPICINFO, channel->Info.GetName() + " :" + channel->Info.GetTopic());
+        return;
+    }
+    channel->Info.SetTopic(parameters.at(1));
+    channel->Info.SetTopicUser(client->User.GetNick());
+    channel->Info.SetTopicTime(QDateTime::currentDateTime());
+    this->sendToChannel(channel, ":" + userString(client->User) + " TOPIC " + channel->Info.GetName() + " :" + parameters.at(1));
+}
+
+void MockServer::processMessage(Client *client, const QString &command, const QList<QString> &parameters)
+{
+    // Errors are never sent as reply to NOTICE
+    bool is_notice = command == "NOTICE";
+    if (parameters.size() < 2)
+    {
+        if (!is_notice)
+            this->sendNumeric(client, IRC_NUMERIC_ERR_NOTEXTTOSEND, ":No text to send");
+        return;
+    }
+    QString target = parameters.at(0);
+    QString line = ":" + userString(client->User) + " " + command + " " + target + " :" + parameters.at(1);
+    if (target.startsWith('#'))
+    {
+        Channel *channel = this->getChannel(target, false);
+        if (channel)
+            this->sendToChannel(channel, line, client);
+        else if (!is_notice)
+            this->sendNumeric(client, IRC_NUMERIC_ERR_NOSUCHCHANNEL, target + " :No such channel");
+        return;
+    }
+    NickKey nick_key = this->key(target);
+    Client *recipient = this->clientsByNick.value(nick_key);
+    if (recipient)
+        this->send(recipient, line);
+    else if (!this->fakeUsers.contains(nick_key) && !is_notice)
+        this->sendNumeric(client, IRC_NUMERIC_ERR_NOSUCHNICK, target + " :No such nick/channel");
+}
+
+void MockServer::processWho(Client *client, const QString &mask)
+{
+    Channel *channel = this->getChannel(mask, false);
+    QList<Member> members;
+    if (channel)
+    {
+        members = channel->Members.values();
+    } else
+    {
+        NickKey nick_key = this->key(mask);
+        if (this->clientsByNick.contains(nick_key) || this->fakeUsers.contains(nick_key))
+        {
+            Member member = { mask, this->clientsByNick.value(nick_key), false, false };
+            members.append(member);
+        }
+    }
+    bool multi_prefix = client->Capabilities.contains("multi-prefix");
+    foreach (const Member &member, members)
+    {
+        libirc::User user = member.Connection ? member.Connection->User : this->fakeUsers.value(this->key(member.Nick)).User;
+        this->sendNumeric(client, IRC_NUMERIC_WHOREPLY, (channel ? channel->Info.GetName() : "*") + " " + user.GetIdent() + " " +
+                                                         user.GetHost() + " " + this->name + " " + user.GetNick() + " H" +
+                                                         memberPrefix(member, multi_prefix) + " :0 " + user.GetRealname());
+    }
+    this->sendNumeric(client, IRC_NUMERIC_ENDOFWHO, mask + " :End of /WHO list.");
+}
+
+void MockServer::processPong(Client *client, const QString &token)
+{
+    if (token.startsWith("latency-"))
+    {
+        qint64 latency = this->clock.nsecsElapsed() / 1000 - token.mid(8).toLongLong();
+        if (!this->statistics.LatencySamples || latency < this->statistics.LatencyMin)
+            this->statistics.LatencyMin = latency;
+        if (latency > this->statistics.LatencyMax)
+            this->statistics.LatencyMax = latency;
+        this->statistics.LatencyTotal += latency;
+        this->statistics.LatencySamples++;
+        return;
+    }
+    if (token == this->scenarioToken)
+        this->finishScenario(client);
+}
+
+void MockServer::tryRegister(Client *client)
+{
+    if (client->Registered || client->CapNegotiation || !client->HasUser || client->User.GetNick().isEmpty())
+        return;
+    client->Registered = true;
+    this->sendNumeric(client, IRC_NUMERIC_WELCOME, ":Welcome to the mock IRC network " + userString(client->User));
+    this->sendNumeric(client, IRC_NUMERIC_YOURHOST, ":Your host is " + this->name + ", running version libirc-mock");
+    this->sendNumeric(client, IRC_NUMERIC_CREATED, ":This server was created just now");
+    this->sendNumeric(client, IRC_NUMERIC_MYINFO, this->name + " libirc-mock i biklmnostv");
+    this->sendNumeric(client, IRC_NUMERIC_ISUPPORT, "CHANTYPES=# PREFIX=(ov)@+ CHANMODES=b,k,l,imnst CASEMAPPING=rfc1459 "
+                                                    "NETWORK=Mock :are supported by this server");
+    this->sendNumeric(client, IRC_NUMERIC_MOTDBEGIN, ":- " + this->name + " Message of the day -");
+    this->sendNumeric(client, IRC_NUMERIC_MOTD, ":- This is a mock server of libirc, it's meant only for testing");
+    this->sendNumeric(client, IRC_NUMERIC_MOTDEND, ":End of /MOTD command.");
+    emit this->Event_ClientRegistered(client->User.GetNick());
+}
+
+void MockServer::removeClient(Client *client, const QString &reason)
+{
+    NickKey nick_key = this->key(client->User.GetNick());
+    QSet<Client*> recipients;
+    foreach (const NickKey &channel_key, client->Channels)
+    {
+        Channel *channel = this->channels.value(channel_key);
+        if (!channel)
+            continue;
+        channel->Members.remove(nick_key);
+        foreach (const Member &member, channel->Members)
+        {
+            if (member.Connection)
+                recipients.insert(member.Connection);
+        }
+        if (channel->Members.isEmpty())
+        {
+            this->channels.remove(channel_key);
+            delete channel;
+        }
+    }
+    QByteArray data = QString(":" + userString(client->User) + " QUIT :" + reason + "\r\n").toUtf8();
+    foreach (Client *recipient, recipients)
+        this->sendData(recipient, data);
+    if (this->clientsByNick.value(nick_key) == client)
+        this->clientsByNick.remove(nick_key);
+    // Client that is gone will never answer the PING of scenario
+    this->finishScenario(client);
+    this->clients.remove(client->Socket);
+    client->Socket->disconnect(this);
+    if (client->Socket->state() == QAbstractSocket::ConnectedState)
+    {
+        this->send(client, "ERROR :Closing link (" + reason + ")");
+        client->Socket->disconnectFromHost();
+    }
+    client->Socket->deleteLater();
+    if (client->Registered)
+        emit this->Event_ClientDisconnected(client->User.GetNick());
+    delete client;
+}
+
+void MockServer::send(Client *client, const QString &line)
+{
+    this->sendData(client, QString(line + "\r\n").toUtf8());
+}
+
+void MockServer::sendData(Client *client, const QByteArray &data)
+{
+    client->Socket->write(data);
+    this->statistics.BytesSent += static_cast<unsigned long long>(data.size());
+    this->statistics.LinesSent++;
+}
+
+void MockServer::sendNumeric(Client *client, int numeric, const QString &parameters)
+{
+    QString nick = client->User.GetNick().isEmpty() ? "*" : client->User.GetNick();
+    this->send(client, ":" + this->name + " " + QString("%1").arg(numeric, 3, 10, QChar('0')) + " " + nick + " " + parameters);
+}
+
+void MockServer::sendNames(Client *client, Channel *channel)
+{
+    bool multi_prefix = client->Capabilities.contains("multi-prefix");
+    QString header = "= " + channel->Info.GetName() + " :";
+    QString names;
+    foreach (const Member &member, channel->Members)
+    {
+        if (names.size() > MOCK_NAMES_LENGTH)
+        {
+            this->sendNumeric(client, IRC_NUMERIC_NAMREPLY, header + names);
+            names.clear();
+        }
+        if (!names.isEmpty())
+            names += " ";
+        names += memberPrefix(member, multi_prefix) + member.Nick;
+    }
+    if (!names.isEmpty())
+        this->sendNumeric(client, IRC_NUMERIC_NAMREPLY, header + names);
+    this->sendNumeric(client, IRC_NUMERIC_ENDOFNAMES, channel->Info.GetName() + " :End of /NAMES list.");
+}
+
+void MockServer::sendToChannel(Channel *channel, const QString &line, Client *except)
+{
+    QByteArray data = QString(line + "\r\n").toUtf8();
+    foreach (const Member &member, channel->Members)
+    {
+        if (member.Connection && member.Connection != except)
+            this->sendData(member.Connection, data);
+    }
+}
+
+MockServer::Channel *MockServer::getChannel(const QString &name, bool create)
+{
+    if (name.isEmpty())
+        return nullptr;
+    NickKey channel_key = this->key(name);
+    Channel *channel = this->channels.value(channel_key);
+    if (!channel && create)
+    {
+        channel = new Channel(name);
+        channel->Modes = "nt";
+        this->channels.insert(channel_key, channel);
+    }
+    return channel;
+}
+
+void MockServer::beginScenario(const QString &name)
+{
+    // Scenario that didn't finish yet is forgotten
+    this->scenarioName = name;
+    this->scenarioToken.clear();
+    this->scenarioClients.clear();
+    this->scenarioStartLines = this->statistics.LinesSent;
+    this->scenarioStart = this->clock.elapsed();
+}
+
+void MockServer::endScenario(const QList<Client*> &clients)
+{
+    this->scenarioLines = this->statistics.LinesSent - this->scenarioStartLines;
+    if (clients.isEmpty())
+    {
+        emit this->Event_ScenarioFinished(this->scenarioName, this->scenarioLines, this->clock.elapsed() - this->scenarioStart);
+        return;
+    }
+    this->scenarioToken = "scenario-" + QString::number(++this->scenarioID);
+    foreach (Client *client, clients)
+    {
+        this->scenarioClients.insert(client);
+        this->send(client, "PING :" + this->scenarioToken);
+    }
+}
+
+void MockServer::finishScenario(Client *client)
+{
+    if (!this->scenarioClients.remove(client) || !this->scenarioClients.isEmpty())
+        return;
+    emit this->Event_ScenarioFinished(this->scenarioName, this->scenarioLines, this->clock.elapsed() - this->scenarioStart);
+}
+
+NickKey MockServer::key(const QString &name) const
+{
+    return NickKey(name, CaseMappingRFC1459);
+}
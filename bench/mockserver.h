@@ -0,0 +1,187 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef MOCKSERVER_H
+#define MOCKSERVER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include "../libirc/channel.h"
+#include "../libirc/user.h"
+#include "../libircclient/casemapping.h"
+
+class QTcpServer;
+class QTcpSocket;
+
+//! Figures collected by MockServer, times are in microseconds
+struct MockServerStatistics
+{
+    unsigned long long Connections = 0;
+    unsigned long long BytesSent = 0;
+    unsigned long long BytesReceived = 0;
+    unsigned long long LinesSent = 0;
+    unsigned long long LinesReceived = 0;
+    //! Number of PING round trips measured by MeasureLatency()
+    unsigned long long LatencySamples = 0;
+    qint64 LatencyMin = 0;
+    qint64 LatencyMax = 0;
+    qint64 LatencyTotal = 0;
+};
+
+/*!
+ * \brief The MockServer class is a minimal ircd that runs on localhost in the same process
+ *
+ * It's meant for testing and measuring clients built on libircclient without a real ircd. It understands
+ * registration, CAP LS/REQ/END, JOIN, PART, NAMES, WHO, MODE, TOPIC, PRIVMSG, NOTICE, PING, PONG and QUIT,
+ * everything else is answered with 421. It's a single server, there is no services, flood protection nor
+ * permission checks, first user who joins a channel gets op.
+ *
+ * Besides connected clients, the server can hold fake users that are members of channels as if they were
+ * connected from another server. These are used by scenarios, which send a burst of data to clients, such as
+ * NamesBurst() or Netsplit(). Scenario is finished once every client that received the burst answered a PING
+ * that was sent after it, so the time reported by Event_ScenarioFinished includes processing in the client.
+ */
+class MockServer : public QObject
+{
+    Q_OBJECT
+    public:
+        MockServer(const QString &name = "mock.irc", QObject *parent = nullptr);
+        ~MockServer() override;
+        //! Starts listening on localhost, port 0 picks any free port, see GetPort()
+        bool Listen(quint16 port = 0);
+        //! Disconnects all clients and stops listening
+        void Close();
+        quint16 GetPort() const;
+        QString GetServerName() const;
+        //! Capabilities that are announced in CAP LS, by default only multi-prefix
+        void SetCapabilities(const QList<QString> &capabilities);
+        QList<QString> GetCapabilities() const;
+        int GetClientCount() const;
+        int GetFakeUserCount() const;
+        //! Number of members of channel, both connected clients and fake users, 0 if it doesn't exist
+        int GetChannelSize(const QString &channel);
+        //! Creates count fake users named prefix + number and puts them to channel, clients in channel see them join
+        void AddFakeUsers(const QString &channel, int count, const QString &prefix = "user");
+        //! Scenario: sends NAMES of channel to all clients in it
+        void NamesBurst(const QString &channel);
+        //! Scenario: fake users send lines messages to channel
+        void FloodChannel(const QString &channel, int lines, const QString &text = "Hello");
+        /*!
+         * \brief Netsplit is a scenario in which count fake users quit at once, like when a server splits
+         * \return Number of users that quit, it's less than count if there are not enough fake users
+         */
+        int Netsplit(int count, const QString &reason = "");
+        //! Sends PING to every registered client, round trips are collected in statistics
+        void MeasureLatency();
+        bool IsScenarioRunning() const;
+        MockServerStatistics GetStatistics() const;
+        void ResetStatistics();
+
+    signals:
+        void Event_ClientRegistered(QString nick);
+        void Event_ClientDisconnected(QString nick);
+        //! Scenario finished, lines is number of lines that were sent to clients by it
+        void Event_ScenarioFinished(QString name, unsigned long long lines, qint64 msec);
+
+    private slots:
+        void OnNewConnection();
+        void OnReadyRead();
+        void OnDisconnected();
+
+    private:
+        struct Client
+        {
+            QTcpSocket *Socket;
+            libirc::User User;
+            bool HasUser = false;
+            bool Registered = false;
+            //! Registration waits for CAP END while this is true
+            bool CapNegotiation = false;
+            QList<QString> Capabilities;
+            QList<libircclient::NickKey> Channels;
+            QByteArray Buffer;
+        };
+        struct FakeUser
+        {
+            libirc::User User;
+            QList<libircclient::NickKey> Channels;
+        };
+        struct Member
+        {
+            QString Nick;
+            //! nullptr for fake users
+            Client *Connection;
+            bool Op;
+            bool Voice;
+        };
+        struct Channel
+        {
+            Channel(const QString &name) : Info(name) {}
+            libirc::Channel Info;
+            QString Modes;
+            QHash<libircclient::NickKey, Member> Members;
+        };
+        static QString userString(const libirc::User &user);
+        static QString memberPrefix(const Member &member, bool multi_prefix);
+        void processLine(Client *client, const QByteArray &line);
+        void processCap(Client *client, const QList<QString> &parameters);
+        void processNick(Client *client, const QList<QString> &parameters);
+        void processJoin(Client *client, const QString &name);
+        void processPart(Client *client, const QString &name, const QString &reason);
+        void processMode(Client *client, const QList<QString> &parameters);
+        void processTopic(Client *client, const QList<QString> &parameters);
+        void processMessage(Client *client, const QString &command, const QList<QString> &parameters);
+        void processWho(Client *client, const QString &mask);
+        void processPong(Client *client, const QString &token);
+        void tryRegister(Client *client);
+        void removeClient(Client *client, const QString &reason);
+        void send(Client *client, const QString &line);
+        //! Writes line that is already encoded and terminated, so that it's not encoded again for every client
+        void sendData(Client *client, const QByteArray &data);
+        void sendNumeric(Client *client, int numeric, const QString &parameters);
+        void sendNames(Client *client, Channel *channel);
+        //! Sends line to all connected members of channel, except one
+        void sendToChannel(Channel *channel, const QString &line, Client *except = nullptr);
+        Channel *getChannel(const QString &name, bool create);
+        //! Starts measuring of scenario, lines sent to clients are counted from now
+        void beginScenario(const QString &name);
+        //! Sends PING that finishes scenario to every client that received something
+        void endScenario(const QList<Client*> &clients);
+        //! Client answered the PING of scenario or disconnected, scenario is finished once all of them did
+        void finishScenario(Client *client);
+        libircclient::NickKey key(const QString &name) const;
+        QString name;
+        QTcpServer *server;
+        QList<QString> capabilities;
+        QHash<QTcpSocket*, Client*> clients;
+        QHash<libircclient::NickKey, Client*> clientsByNick;
+        QHash<libircclient::NickKey, FakeUser> fakeUsers;
+        QHash<libircclient::NickKey, Channel*> channels;
+        unsigned int nextFakeUser = 0;
+        MockServerStatistics statistics;
+        //! Used for latency and scenario measurements
+        QElapsedTimer clock;
+        QString scenarioName;
+        QString scenarioToken;
+        unsigned long long scenarioStartLines = 0;
+        unsigned long long scenarioLines = 0;
+        //! Clients that didn't answer the PING of current scenario yet
+        QSet<Client*> scenarioClients;
+        qint64 scenarioStart = 0;
+        unsigned int scenarioID = 0;
+};
+
+#endif // MOCKSERVER_H
@@ -0,0 +1,92 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "benchmark.h"
+#include <QElapsedTimer>
+#include "../libircclient/channel.h"
+#include "../libircclient/mode.h"
+
+#define BENCH_BANS 10000
+
+using namespace libircclient;
+
+//! Previous implementation, every insert scans the whole list for duplicate
+static bool listSetPMode(QList<ChannelPMode> &list, const ChannelPMode &mode)
+{
+    foreach (const ChannelPMode &mode_, list)
+    {
+        if (mode_.Get() == mode.Get() && mode_.Parameter == mode.Parameter)
+            return false;
+    }
+    list.append(mode);
+    return true;
+}
+
+static bool listRemovePMode(QList<ChannelPMode> &list, const ChannelPMode &mode)
+{
+    for (int i = 0; i < list.count(); i++)
+    {
+        if (list.at(i).Get() == mode.Get() && list.at(i).Parameter == mode.Parameter)
+        {
+            list.removeAt(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+BENCHMARK(ban_list, "sync of ban list with 10000 entries and its removal, table indexed by parameter against list scans")
+{
+    // Same entries as Network creates from 367 numerics
+    QList<ChannelPMode> bans;
+    for (int i = 0; i < BENCH_BANS; i++)
+    {
+        ChannelPMode ban("b");
+        ban.Parameter = QString("ban") + QString::number(i) + "!*@*";
+        ban.SetBy = User("op!ident@host");
+        bans.append(ban);
+    }
+
+    QList<ChannelPMode> list;
+    QElapsedTimer timer;
+    timer.start();
+    foreach (const ChannelPMode &ban, bans)
+        listSetPMode(list, ban);
+    qint64 list_sync_time = timer.nsecsElapsed();
+    timer.restart();
+    foreach (const ChannelPMode &ban, bans)
+        listRemovePMode(list, ban);
+    qint64 list_remove_time = timer.nsecsElapsed();
+
+    Channel channel(BENCHMARK_CHANNEL);
+    timer.restart();
+    foreach (const ChannelPMode &ban, bans)
+        channel.SetPMode(ban);
+    qint64 sync_time = timer.nsecsElapsed();
+    int synced = channel.GetBans().count();
+    // Server sends the whole list again when client asks for it, every entry is a duplicate now
+    timer.restart();
+    foreach (const ChannelPMode &ban, bans)
+        channel.SetPMode(ban);
+    qint64 resync_time = timer.nsecsElapsed();
+    timer.restart();
+    foreach (const ChannelPMode &ban, bans)
+        channel.RemovePMode(ban);
+    qint64 remove_time = timer.nsecsElapsed();
+
+    Benchmark::Report("list sync", static_cast<double>(list_sync_time) / 1000000, "ms");
+    Benchmark::Report("list removal", static_cast<double>(list_remove_time) / 1000000, "ms");
+    Benchmark::Report("table sync", static_cast<double>(sync_time) / 1000000, "ms");
+    Benchmark::Report("table sync of duplicates", static_cast<double>(resync_time) / 1000000, "ms");
+    Benchmark::Report("table removal", static_cast<double>(remove_time) / 1000000, "ms");
+    return list.isEmpty() && synced == BENCH_BANS && channel.GetBans().isEmpty();
+}
@@ -0,0 +1,69 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "benchmark.h"
+#include <atomic>
+#include <QElapsedTimer>
+#include "../libircclient/networkpool.h"
+
+#define BENCH_POOL_NETWORKS 32
+#define BENCH_POOL_USERS    100
+#define BENCH_POOL_LINES    20000
+
+using namespace libircclient;
+
+//! Runs all networks in pool with given number of threads, each of them processes the messages in its worker
+static bool runPool(int threads, const QList<QByteArray> &messages)
+{
+    NetworkPool *pool = new NetworkPool(threads);
+    QList<BenchmarkNetwork*> networks;
+    for (int i = 0; i < BENCH_POOL_NETWORKS; i++)
+    {
+        BenchmarkNetwork *network = BenchmarkNetwork::Create("bench" + QString::number(i));
+        network->Feed(BenchmarkNetwork::ChannelJoins("bench" + QString::number(i), BENCH_POOL_USERS));
+        networks.append(network);
+        pool->Insert(network);
+    }
+    std::atomic<int> finished(0);
+    QElapsedTimer timer;
+    timer.start();
+    foreach (BenchmarkNetwork *network, networks)
+    {
+        QMetaObject::invokeMethod(network, [network, &messages, &finished]()
+        {
+            network->Feed(messages);
+            finished++;
+        }, Qt::QueuedConnection);
+    }
+    bool result = Benchmark::WaitFor([&]() { return finished == BENCH_POOL_NETWORKS; });
+    qint64 nsec = timer.nsecsElapsed();
+    if (result)
+    {
+        double lines = static_cast<double>(messages.size()) * BENCH_POOL_NETWORKS;
+        Benchmark::Report(QString::number(threads) + " threads", lines * 1000000000 / nsec, "lines/s");
+    }
+    // Pool moves networks back to this thread, so they can be deleted here
+    delete pool;
+    qDeleteAll(networks);
+    return result;
+}
+
+BENCHMARK(network_pool, "32 networks process channel messages while they run in pool of 1, 2, 4 and 8 threads")
+{
+    QList<QByteArray> messages = BenchmarkNetwork::ChannelMessages(BENCH_POOL_USERS, BENCH_POOL_LINES);
+    for (int threads = 1; threads <= 8; threads *= 2)
+    {
+        if (!runPool(threads, messages))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,104 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "benchmark.h"
+#include <atomic>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include "../libirc/serializableitem.h"
+
+#define BENCH_REGISTRY_THREADS 8
+#define BENCH_REGISTRY_ITEMS   200000
+
+using namespace libirc;
+
+//! Previous implementation, one hash for all ids behind one mutex
+static QMutex globalLock;
+static QHash<unsigned long long, SerializableItem*> globalRegistry;
+static std::atomic<unsigned long long> globalID(1);
+
+//! Item is created, registered, looked up and destroyed, which is what happens to RPC ids of users that join and part
+static void cycleSharded()
+{
+    for (int i = 0; i < BENCH_REGISTRY_ITEMS; i++)
+    {
+        SerializableItem *item = new SerializableItem();
+        SerializableItem::GetItemByRPCID(item->__rpc_GetID());
+        delete item;
+    }
+}
+
+static void cycleGlobal()
+{
+    for (int i = 0; i < BENCH_REGISTRY_ITEMS; i++)
+    {
+        SerializableItem *item = new SerializableItem();
+        unsigned long long id = globalID++;
+        globalLock.lock();
+        globalRegistry.insert(id, item);
+        globalLock.unlock();
+        globalLock.lock();
+        globalRegistry.value(id, nullptr);
+        globalLock.unlock();
+        globalLock.lock();
+        globalRegistry.remove(id);
+        globalLock.unlock();
+        delete item;
+    }
+}
+
+class RegistryThread : public QThread
+{
+    public:
+        RegistryThread(void (*cycle)())
+        {
+            this->cycle = cycle;
+        }
+
+    protected:
+        void run() override
+        {
+            this->cycle();
+        }
+
+    private:
+        void (*cycle)();
+};
+
+//! Runs the cycle in given number of threads at once and reports the throughput of all of them together
+static void measure(const QString &label, void (*cycle)(), int threads)
+{
+    QList<RegistryThread*> workers;
+    for (int i = 0; i < threads; i++)
+        workers.append(new RegistryThread(cycle));
+    QElapsedTimer timer;
+    timer.start();
+    foreach (RegistryThread *worker, workers)
+        worker->start();
+    foreach (RegistryThread *worker, workers)
+        worker->wait();
+    qint64 nsec = timer.nsecsElapsed();
+    qDeleteAll(workers);
+    double items = static_cast<double>(BENCH_REGISTRY_ITEMS) * threads;
+    Benchmark::Report(label + ", " + QString::number(threads) + " threads", items * 1000000000 / nsec, "items/s");
+}
+
+BENCHMARK(rpc_registry, "registry of RPC ids used by 8 threads at once, shards against one global mutex")
+{
+    measure("global mutex", cycleGlobal, 1);
+    measure("global mutex", cycleGlobal, BENCH_REGISTRY_THREADS);
+    measure("shards", cycleSharded, 1);
+    measure("shards", cycleSharded, BENCH_REGISTRY_THREADS);
+    return globalRegistry.isEmpty();
+}
@@ -0,0 +1,78 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "benchmark.h"
+#include "../libircclient/channel.h"
+#include "../libircclient/network.h"
+#include "mockserver.h"
+
+#define BENCH_NAMES_USERS    10000
+#define BENCH_NETSPLIT_USERS 1000
+
+using namespace libircclient;
+
+//! Waits until the client sees given number of users in the channel, itself included
+static bool waitForUsers(Network *network, int users)
+{
+    return Benchmark::WaitFor([&]()
+    {
+        Channel *channel = network->GetChannel(BENCHMARK_CHANNEL);
+        return channel && channel->GetUserCount() == users;
+    });
+}
+
+BENCHMARK(names_burst, "mock server sends NAMES of channel with 10000 users to one client")
+{
+    MockServer server;
+    if (!server.Listen())
+        return false;
+    Network *network = Benchmark::CreateNetwork(&server, "bench");
+    network->Connect();
+    bool result = Benchmark::WaitForMembers(&server, 1);
+    if (result)
+    {
+        server.AddFakeUsers(BENCHMARK_CHANNEL, BENCH_NAMES_USERS);
+        result = waitForUsers(network, BENCH_NAMES_USERS + 1);
+    }
+    if (result)
+        result = Benchmark::RunScenario(&server, "NAMES burst", [&]() { server.NamesBurst(BENCHMARK_CHANNEL); });
+    if (result)
+        result = waitForUsers(network, BENCH_NAMES_USERS + 1);
+    if (result)
+        result = Benchmark::ReportLatency(&server);
+    delete network;
+    return result;
+}
+
+BENCHMARK(netsplit, "1000 users of channel quit at once in netsplit while one client watches")
+{
+    MockServer server;
+    if (!server.Listen())
+        return false;
+    Network *network = Benchmark::CreateNetwork(&server, "bench");
+    network->Connect();
+    bool result = Benchmark::WaitForMembers(&server, 1);
+    if (result)
+    {
+        server.AddFakeUsers(BENCHMARK_CHANNEL, BENCH_NETSPLIT_USERS);
+        result = waitForUsers(network, BENCH_NETSPLIT_USERS + 1);
+    }
+    if (result)
+        result = Benchmark::RunScenario(&server, "netsplit", [&]() { server.Netsplit(BENCH_NETSPLIT_USERS); });
+    // Only the client itself should be left
+    if (result)
+        result = waitForUsers(network, 1);
+    if (result)
+        result = Benchmark::ReportLatency(&server);
+    delete network;
+    return result;
+}
@@ -0,0 +1,107 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "benchmark.h"
+#include <QBuffer>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include "../libirc/serveraddress.h"
+#include "../libircclient/channel.h"
+#include "../libircclient/network.h"
+#include "../libircclient/user.h"
+
+#define BENCH_SERIALIZATION_CHANNELS 300
+#define BENCH_SERIALIZATION_MEMBERS  50
+#define BENCH_SERIALIZATION_USERS    3000
+#define BENCH_SERIALIZATION_ROUNDS   20
+
+using namespace libircclient;
+
+static Network *createNetwork()
+{
+    libirc::ServerAddress address("127.0.0.1", false, 6667, "bench");
+    return new Network(address, "mock");
+}
+
+BENCHMARK(serialization, "network with 300 channels saved and loaded in binary format against ToHash() in QDataStream")
+{
+    Network *network = createNetwork();
+    // Users are spread over channels, so that most of them are in more than one channel, like on real network
+    for (int i = 0; i < BENCH_SERIALIZATION_CHANNELS; i++)
+    {
+        Channel channel(QString("#channel") + QString::number(i));
+        channel.SetTopic("Topic of channel number " + QString::number(i));
+        for (int j = 0; j < BENCH_SERIALIZATION_MEMBERS; j++)
+        {
+            int id = (i * BENCH_SERIALIZATION_MEMBERS / 5 + j) % BENCH_SERIALIZATION_USERS;
+            User user(QString("user") + QString::number(id) + "!ident@host" + QString::number(id) + ".example.org");
+            channel.InsertUser(&user);
+        }
+        network->_st_InsertChannel(&channel);
+    }
+
+    QByteArray hash_data;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < BENCH_SERIALIZATION_ROUNDS; i++)
+    {
+        hash_data.clear();
+        QDataStream stream(&hash_data, QIODevice::WriteOnly);
+        stream << QVariant(network->ToHash());
+    }
+    qint64 hash_save_time = timer.nsecsElapsed();
+
+    QByteArray binary_data;
+    timer.restart();
+    for (int i = 0; i < BENCH_SERIALIZATION_ROUNDS; i++)
+    {
+        binary_data.clear();
+        QBuffer buffer(&binary_data);
+        buffer.open(QIODevice::WriteOnly);
+        network->SaveBinary(&buffer);
+    }
+    qint64 binary_save_time = timer.nsecsElapsed();
+    delete network;
+
+    bool result = true;
+    timer.restart();
+    for (int i = 0; i < BENCH_SERIALIZATION_ROUNDS; i++)
+    {
+        QVariant hash;
+        QDataStream stream(hash_data);
+        stream >> hash;
+        Network *loaded = createNetwork();
+        loaded->LoadHash(hash.toHash());
+        result = result && loaded->GetChannels().count() == BENCH_SERIALIZATION_CHANNELS;
+        delete loaded;
+    }
+    qint64 hash_load_time = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < BENCH_SERIALIZATION_ROUNDS; i++)
+    {
+        QBuffer buffer(&binary_data);
+        buffer.open(QIODevice::ReadOnly);
+        Network *loaded = createNetwork();
+        result = result && loaded->LoadBinary(&buffer) && loaded->GetChannels().count() == BENCH_SERIALIZATION_CHANNELS;
+        delete loaded;
+    }
+    qint64 binary_load_time = timer.nsecsElapsed();
+
+    Benchmark::Report("ToHash size", static_cast<double>(hash_data.size()) / 1024, "KiB");
+    Benchmark::Report("binary size", static_cast<double>(binary_data.size()) / 1024, "KiB");
+    Benchmark::Report("ToHash save", static_cast<double>(hash_save_time) / BENCH_SERIALIZATION_ROUNDS / 1000000, "ms");
+    Benchmark::Report("binary save", static_cast<double>(binary_save_time) / BENCH_SERIALIZATION_ROUNDS / 1000000, "ms");
+    Benchmark::Report("ToHash load", static_cast<double>(hash_load_time) / BENCH_SERIALIZATION_ROUNDS / 1000000, "ms");
+    Benchmark::Report("binary load", static_cast<double>(binary_load_time) / BENCH_SERIALIZATION_ROUNDS / 1000000, "ms");
+    return result;
+}
@@ -0,0 +1,602 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "binaryserializer.h"
+#include <QIODevice>
+#include <QDateTime>
+#include <QStringList>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+using namespace libirc;
+
+#define BINARY_MAGIC "LIRB"
+//! Data is written to device once there is this much of it
+#define BINARY_BLOCK_SIZE 65536
+//! Objects and lists nested deeper than this are considered broken
+#define BINARY_MAX_DEPTH 64
+
+#define BINARY_TYPE_NULL      0
+#define BINARY_TYPE_FALSE     1
+#define BINARY_TYPE_TRUE      2
+#define BINARY_TYPE_INT       3
+#define BINARY_TYPE_UINT      4
+#define BINARY_TYPE_LONGLONG  5
+#define BINARY_TYPE_ULONGLONG 6
+#define BINARY_TYPE_DOUBLE    7
+#define BINARY_TYPE_STRING    8
+#define BINARY_TYPE_CHAR      9
+#define BINARY_TYPE_LIST      10
+#define BINARY_TYPE_OBJECT    11
+#define BINARY_TYPE_DATETIME  12
+#define BINARY_TYPE_BYTEARRAY 13
+//! Any other QVariant stored using QDataStream, it's no longer written and reader skips it, because QDataStream
+//! would construct any type that is registered in the process from untrusted data
+#define BINARY_TYPE_VARIANT   14
+
+#define BINARY_FIELD_END          0
+//! Field name that is not in schema follows as string, it gets next dynamic number
+#define BINARY_FIELD_DEFINE       1
+#define BINARY_FIELD_SCHEMA_FIRST 2
+#define BINARY_FIELD_DYNAMIC_FIRST 1024
+
+//! Names of fields used by ToHash() of libirc and libircclient, position in this list is their number in the stream,
+//! so new names can be only appended to the end, never removed or reordered
+static const char *schema[] =
+{
+    "__rpc_id",
+    // User
+    "_username", "_nick", "_ident", "_host", "_realname", "ChannelPrefixes", "CUModes", "ServerName", "IsAway", "AwayMs",
+    // Channel
+    "_name", "_topic", "_topicTime", "_topicUser", "_localModeDateTime", "localMode", "_localPModes", "users",
+    // Modes
+    "Parameter", "included_modes", "excluded_modes", "mode", "valid", "including", "SetBy", "SetOn",
+    // Server
+    "_ssl", "_version", "_port", "_password", "_suffix", "_valid", "_original",
+    // Network
+    "networkName", "CModes", "CCModes", "CPModes", "CRModes", "STATUSMSG_Modes", "channelUserPrefixes", "awayMessage",
+    "hostname", "port", "pingTimeout", "pingRate", "defaultQuit", "_enableCap", "autoRejoin", "autoIdentify",
+    "identifyString", "password", "alternateNick", "_capabilitiesSupported", "_capabilitiesSubscribed",
+    "_capabilitiesRequested", "localUserMode", "channelPrefix", "server", "localUser", "lastPing", "channels",
+    "encoding", "caseMapping",
+    nullptr
+};
+
+static QHash<QString, int> createSchemaIds()
+{
+    QHash<QString, int> ids;
+    for (int i = 0; schema[i]; i++)
+        ids.insert(QString(schema[i]), BINARY_FIELD_SCHEMA_FIRST + i);
+    return ids;
+}
+
+static const QHash<QString, int> &schemaIds()
+{
+    static const QHash<QString, int> ids = createSchemaIds();
+    return ids;
+}
+
+static int schemaSize()
+{
+    int size = 0;
+    while (schema[size])
+        size++;
+    return size;
+}
+
+static bool schemaNameLess(int a, int b)
+{
+    return strcmp(schema[a], schema[b]) < 0;
+}
+
+static QList<int> createSchemaOrder()
+{
+    QList<int> order;
+    for (int i = 0; schema[i]; i++)
+        order.append(i);
+    std::sort(order.begin(), order.end(), schemaNameLess);
+    return order;
+}
+
+//! Returns number of field in schema or -1, names are compared as they are, so that no string needs to be created
+static int schemaId(const char *name)
+{
+    // Positions in schema sorted by name
+    static const QList<int> order = createSchemaOrder();
+    int low = 0;
+    int high = order.size() - 1;
+    while (low <= high)
+    {
+        int middle = (low + high) / 2;
+        int result = strcmp(name, schema[order.at(middle)]);
+        if (result == 0)
+            return BINARY_FIELD_SCHEMA_FIRST + order.at(middle);
+        if (result < 0)
+            high = middle - 1;
+        else
+            low = middle + 1;
+    }
+    return -1;
+}
+
+BinaryWriter::BinaryWriter(QIODevice *device)
+{
+    this->device = device;
+    this->buffer.reserve(BINARY_BLOCK_SIZE);
+}
+
+BinaryWriter::~BinaryWriter()
+{
+    this->Flush();
+}
+
+void BinaryWriter::WriteHeader()
+{
+    this->writeBytes(BINARY_MAGIC, 4);
+    this->writeVarint(LIBIRC_BINARY_VERSION);
+}
+
+void BinaryWriter::WriteValue(const QVariant &value)
+{
+    if (!value.isValid())
+    {
+        this->writeType(BINARY_TYPE_NULL);
+        return;
+    }
+    switch (value.userType())
+    {
+        case QMetaType::Bool:
+            this->writeType(value.toBool() ? BINARY_TYPE_TRUE : BINARY_TYPE_FALSE);
+            return;
+        case QMetaType::Int:
+        {
+            qint64 number = value.toInt();
+            this->writeType(BINARY_TYPE_INT);
+            // Zig-zag encoding, so that small negative numbers are short too
+            this->writeVarint((static_cast<quint64>(number) << 1) ^ static_cast<quint64>(number >> 63));
+            return;
+        }
+        case QMetaType::UInt:
+            this->writeType(BINARY_TYPE_UINT);
+            this->writeVarint(value.toUInt());
+            return;
+        case QMetaType::LongLong:
+        {
+            qint64 number = value.toLongLong();
+            this->writeType(BINARY_TYPE_LONGLONG);
+            this->writeVarint((static_cast<quint64>(number) << 1) ^ static_cast<quint64>(number >> 63));
+            return;
+        }
+        case QMetaType::ULongLong:
+            this->writeType(BINARY_TYPE_ULONGLONG);
+            this->writeVarint(value.toULongLong());
+            return;
+        case QMetaType::Double:
+        {
+            double number = value.toDouble();
+            quint64 bits;
+            memcpy(&bits, &number, sizeof(bits));
+            this->writeType(BINARY_TYPE_DOUBLE);
+            char data[8];
+            for (int i = 0; i < 8; i++)
+                data[i] = static_cast<char>((bits >> (i * 8)) & 0xff);
+            this->writeBytes(data, 8);
+            return;
+        }
+        case QMetaType::QString:
+            this->WriteString(value.toString());
+            return;
+        case QMetaType::QChar:
+            this->WriteChar(value.toChar());
+            return;
+        case QMetaType::QByteArray:
+        {
+            QByteArray data = value.toByteArray();
+            this->writeType(BINARY_TYPE_BYTEARRAY);
+            this->writeVarint(static_cast<quint64>(data.size()));
+            this->writeBytes(data.constData(), data.size());
+            return;
+        }
+        case QMetaType::QDateTime:
+        {
+            QDateTime time = value.toDateTime();
+            if (!time.isValid())
+            {
+                this->writeType(BINARY_TYPE_NULL);
+                return;
+            }
+            qint64 ms = time.toMSecsSinceEpoch();
+            this->writeType(BINARY_TYPE_DATETIME);
+            this->writeVarint((static_cast<quint64>(ms) << 1) ^ static_cast<quint64>(ms >> 63));
+            return;
+        }
+        case QMetaType::QVariantList:
+        {
+            QList<QVariant> list = value.toList();
+            this->BeginList(list.size());
+            foreach (QVariant item, list)
+                this->WriteValue(item);
+            return;
+        }
+        case QMetaType::QStringList:
+        {
+            QStringList list = value.toStringList();
+            this->BeginList(list.size());
+            foreach (QString item, list)
+                this->WriteString(item);
+            return;
+        }
+        case QMetaType::QVariantHash:
+            this->WriteHash(value.toHash());
+            return;
+        default:
+            // ToHash() doesn't produce other types, but if it does, they are kept at least as text
+            if (value.canConvert<QString>())
+                this->WriteString(value.toString());
+            else
+                this->writeType(BINARY_TYPE_NULL);
+            return;
+    }
+}
+
+void BinaryWriter::WriteHash(const QHash<QString, QVariant> &hash)
+{
+    this->BeginObject();
+    QHash<QString, QVariant>::const_iterator field = hash.constBegin();
+    for (; field != hash.constEnd(); ++field)
+    {
+        this->WriteField(field.key());
+        this->WriteValue(field.value());
+    }
+    this->EndObject();
+}
+
+void BinaryWriter::BeginObject()
+{
+    this->writeType(BINARY_TYPE_OBJECT);
+}
+
+void BinaryWriter::WriteField(const char *name)
+{
+    // Almost all fields are written by SERIALIZE_BINARY with names from schema, only the rest is converted
+    int id = schemaId(name);
+    if (id >= 0)
+    {
+        this->writeVarint(static_cast<quint64>(id));
+        return;
+    }
+    this->WriteField(QString(name));
+}
+
+void BinaryWriter::WriteField(const QString &name)
+{
+    int id = schemaIds().value(name, -1);
+    if (id < 0)
+        id = this->dynamicFields.value(name, -1);
+    if (id >= 0)
+    {
+        this->writeVarint(static_cast<quint64>(id));
+        return;
+    }
+    this->dynamicFields.insert(name, BINARY_FIELD_DYNAMIC_FIRST + this->dynamicFields.size());
+    QByteArray data = name.toUtf8();
+    this->writeVarint(BINARY_FIELD_DEFINE);
+    this->writeVarint(static_cast<quint64>(data.size()));
+    this->writeBytes(data.constData(), data.size());
+}
+
+void BinaryWriter::EndObject()
+{
+    this->writeVarint(BINARY_FIELD_END);
+}
+
+void BinaryWriter::BeginList(int count)
+{
+    this->writeType(BINARY_TYPE_LIST);
+    this->writeVarint(static_cast<quint64>(count));
+}
+
+void BinaryWriter::WriteString(const QString &string)
+{
+    QByteArray data = string.toUtf8();
+    this->writeType(BINARY_TYPE_STRING);
+    this->writeVarint(static_cast<quint64>(data.size()));
+    this->writeBytes(data.constData(), data.size());
+}
+
+void BinaryWriter::WriteChar(QChar c)
+{
+    this->writeType(BINARY_TYPE_CHAR);
+    this->writeVarint(c.unicode());
+}
+
+void BinaryWriter::WriteCharList(const QList<char> &list)
+{
+    this->BeginList(list.size());
+    foreach (char c, list)
+        this->WriteChar(QChar(c));
+}
+
+void BinaryWriter::Flush()
+{
+    if (this->buffer.isEmpty())
+        return;
+    this->device->write(this->buffer);
+    this->buffer.resize(0);
+}
+
+void BinaryWriter::writeType(int type)
+{
+    this->buffer.append(static_cast<char>(type));
+}
+
+void BinaryWriter::writeVarint(quint64 value)
+{
+    char data[10];
+    int size = 0;
+    while (value >= 0x80)
+    {
+        data[size++] = static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    data[size++] = static_cast<char>(value);
+    this->writeBytes(data, size);
+}
+
+void BinaryWriter::writeBytes(const char *data, int size)
+{
+    this->buffer.append(data, size);
+    if (this->buffer.size() >= BINARY_BLOCK_SIZE)
+        this->Flush();
+}
+
+BinaryReader::BinaryReader(QIODevice *device)
+{
+    this->device = device;
+    this->position = 0;
+    this->version = 0;
+    this->error = false;
+}
+
+bool BinaryReader::ReadHeader()
+{
+    if (!this->ensure(4) || memcmp(this->buffer.constData() + this->position, BINARY_MAGIC, 4) != 0)
+    {
+        this->error = true;
+        return false;
+    }
+    this->position += 4;
+    quint64 version = this->readVarint();
+    if (this->error || version < 1 || version > LIBIRC_BINARY_VERSION)
+    {
+        this->error = true;
+        return false;
+    }
+    this->version = static_cast<int>(version);
+    return true;
+}
+
+int BinaryReader::GetVersion() const
+{
+    return this->version;
+}
+
+bool BinaryReader::HasError() const
+{
+    return this->error;
+}
+
+QVariant BinaryReader::ReadValue()
+{
+    int type = this->readByte();
+    if (type < 0)
+        return QVariant();
+    return this->readValue(type, 0);
+}
+
+QHash<QString, QVariant> BinaryReader::ReadHash()
+{
+    return this->ReadValue().toHash();
+}
+
+bool BinaryReader::BeginObject()
+{
+    int type = this->readByte();
+    if (type == BINARY_TYPE_OBJECT)
+        return true;
+    if (type >= 0)
+    {
+        // Whatever it is, it's not what caller expects, so we skip it
+        this->readValue(type, 0);
+    }
+    return false;
+}
+
+QString BinaryReader::ReadField()
+{
+    quint64 id = this->readVarint();
+    if (this->error || id == BINARY_FIELD_END)
+        return QString();
+    return this->readFieldName(id);
+}
+
+void BinaryReader::SkipValue()
+{
+    this->ReadValue();
+}
+
+bool BinaryReader::ensure(int size)
+{
+    if (this->error)
+        return false;
+    int available = this->buffer.size() - this->position;
+    if (available >= size)
+        return true;
+    // Drop what was already read and append more data from device
+    this->buffer.remove(0, this->position);
+    this->position = 0;
+    while (this->buffer.size() < size)
+    {
+        QByteArray data = this->device->read(qMax(size - int(this->buffer.size()), BINARY_BLOCK_SIZE));
+        if (data.isEmpty())
+        {
+            this->error = true;
+            return false;
+        }
+        this->buffer.append(data);
+    }
+    return true;
+}
+
+int BinaryReader::readByte()
+{
+    if (!this->ensure(1))
+        return -1;
+    return static_cast<unsigned char>(this->buffer.at(this->position++));
+}
+
+quint64 BinaryReader::readVarint()
+{
+    quint64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = this->readByte();
+        if (byte < 0)
+            return 0;
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    this->error = true;
+    return 0;
+}
+
+static qint64 zigZagDecode(quint64 value)
+{
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+QVariant BinaryReader::readValue(int type, int depth)
+{
+    if (depth > BINARY_MAX_DEPTH)
+    {
+        this->error = true;
+        return QVariant();
+    }
+    switch (type)
+    {
+        case BINARY_TYPE_NULL:
+            return QVariant();
+        case BINARY_TYPE_FALSE:
+            return QVariant(false);
+        case BINARY_TYPE_TRUE:
+            return QVariant(true);
+        case BINARY_TYPE_INT:
+            return QVariant(static_cast<int>(zigZagDecode(this->readVarint())));
+        case BINARY_TYPE_UINT:
+            return QVariant(static_cast<uint>(this->readVarint()));
+        case BINARY_TYPE_LONGLONG:
+            return QVariant(static_cast<qlonglong>(zigZagDecode(this->readVarint())));
+        case BINARY_TYPE_ULONGLONG:
+            return QVariant(static_cast<qulonglong>(this->readVarint()));
+        case BINARY_TYPE_DOUBLE:
+        {
+            if (!this->ensure(8))
+                return QVariant();
+            quint64 bits = 0;
+            for (int i = 0; i < 8; i++)
+                bits |= static_cast<quint64>(static_cast<unsigned char>(this->buffer.at(this->position++))) << (i * 8);
+            double number;
+            memcpy(&number, &bits, sizeof(number));
+            return QVariant(number);
+        }
+        case BINARY_TYPE_STRING:
+        case BINARY_TYPE_BYTEARRAY:
+        case BINARY_TYPE_VARIANT:
+        {
+            quint64 size = this->readVarint();
+            if (this->error || size > INT_MAX || !this->ensure(static_cast<int>(size)))
+            {
+                this->error = true;
+                return QVariant();
+            }
+            const char *data = this->buffer.constData() + this->position;
+            this->position += static_cast<int>(size);
+            if (type == BINARY_TYPE_STRING)
+                return QVariant(QString::fromUtf8(data, static_cast<int>(size)));
+            if (type == BINARY_TYPE_BYTEARRAY)
+                return QVariant(QByteArray(data, static_cast<int>(size)));
+            // Length is known, so the rest of stream can still be read
+            return QVariant();
+        }
+        case BINARY_TYPE_CHAR:
+            return QVariant(QChar(static_cast<ushort>(this->readVarint())));
+        case BINARY_TYPE_DATETIME:
+            return QVariant(QDateTime::fromMSecsSinceEpoch(zigZagDecode(this->readVarint())));
+        case BINARY_TYPE_LIST:
+        {
+            quint64 count = this->readVarint();
+            QList<QVariant> list;
+            for (quint64 i = 0; i < count && !this->error; i++)
+            {
+                int item_type = this->readByte();
+                if (item_type < 0)
+                    break;
+                list.append(this->readValue(item_type, depth + 1));
+            }
+            return QVariant(list);
+        }
+        case BINARY_TYPE_OBJECT:
+        {
+            QHash<QString, QVariant> hash;
+            while (!this->error)
+            {
+                quint64 id = this->readVarint();
+                if (this->error || id == BINARY_FIELD_END)
+                    break;
+                QString name = this->readFieldName(id);
+                int value_type = this->readByte();
+                if (value_type < 0)
+                    break;
+                hash.insert(name, this->readValue(value_type, depth + 1));
+            }
+            return QVariant(hash);
+        }
+    }
+    // Unknown type, we can't tell how long it is, so the rest of stream can't be read
+    this->error = true;
+    return QVariant();
+}
+
+QString BinaryReader::readFieldName(quint64 id)
+{
+    if (id == BINARY_FIELD_DEFINE)
+    {
+        quint64 size = this->readVarint();
+        if (this->error || size > INT_MAX || !this->ensure(static_cast<int>(size)))
+        {
+            this->error = true;
+            return QString();
+        }
+        QString name = QString::fromUtf8(this->buffer.constData() + this->position, static_cast<int>(size));
+        this->position += static_cast<int>(size);
+        this->dynamicFields.append(name);
+        return name;
+    }
+    if (id >= BINARY_FIELD_SCHEMA_FIRST && id < static_cast<quint64>(BINARY_FIELD_SCHEMA_FIRST + schemaSize()))
+        return QString(schema[id - BINARY_FIELD_SCHEMA_FIRST]);
+    if (id >= BINARY_FIELD_DYNAMIC_FIRST && id - BINARY_FIELD_DYNAMIC_FIRST < static_cast<quint64>(this->dynamicFields.size()))
+        return this->dynamicFields.at(static_cast<int>(id - BINARY_FIELD_DYNAMIC_FIRST));
+    this->error = true;
+    return QString();
+}
@@ -0,0 +1,117 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef BINARYSERIALIZER_H
+#define BINARYSERIALIZER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVariant>
+#include "libirc_global.h"
+
+class QIODevice;
+
+//! Version of binary format that is written, readers accept this and all older versions
+#define LIBIRC_BINARY_VERSION 1
+
+// Same as SERIALIZE macros, but for binary writer, they expect variable named writer
+#define SERIALIZE_BINARY(variable_name)          writer.WriteField(#variable_name); writer.WriteValue(QVariant(variable_name))
+#define SERIALIZE_BINARY_CCHAR(variable_name)    writer.WriteField(#variable_name); writer.WriteChar(QChar(variable_name))
+#define SERIALIZE_BINARY_CHARLIST(variable_name) writer.WriteField(#variable_name); writer.WriteCharList(variable_name)
+
+namespace libirc
+{
+    /*!
+     * \brief Writes values and serializable items in compact binary form to a QIODevice
+     *
+     * Every value is a type byte followed by its data, integers are varints, strings are UTF-8 with their length
+     * in front. Objects (what ToHash() would produce) are lists of fields terminated by field 0, names of fields
+     * that are part of the schema in binaryserializer.cpp are written as small numbers, other names are written
+     * only once per stream and then referred to by number as well.
+     *
+     * Data is buffered and written to device in large blocks, call Flush() (or destroy the writer) when done.
+     */
+    class LIBIRCSHARED_EXPORT BinaryWriter
+    {
+        public:
+            BinaryWriter(QIODevice *device);
+            ~BinaryWriter();
+            //! Writes magic and version, it needs to be at start of the stream
+            void WriteHeader();
+            void WriteValue(const QVariant &value);
+            //! Writes a hash as one object, this is the bridge for items that only implement ToHash()
+            void WriteHash(const QHash<QString, QVariant> &hash);
+            void BeginObject();
+            //! Writes a name of field, it must be followed by exactly one value
+            void WriteField(const char *name);
+            void WriteField(const QString &name);
+            void EndObject();
+            //! Starts a list of count values
+            void BeginList(int count);
+            void WriteString(const QString &string);
+            void WriteChar(QChar c);
+            //! Writes a list of chars the same way as SERIALIZE_CHARLIST does in hash form
+            void WriteCharList(const QList<char> &list);
+            void Flush();
+
+        private:
+            void writeType(int type);
+            void writeVarint(quint64 value);
+            void writeBytes(const char *data, int size);
+            QIODevice *device;
+            QByteArray buffer;
+            //! Names of fields that are not in schema, they get numbers as they are written
+            QHash<QString, int> dynamicFields;
+    };
+
+    /*!
+     * \brief Reads data written by BinaryWriter
+     *
+     * All data need to be readable from the device, reader doesn't wait for more data to arrive. When the data is
+     * broken the reader stops, HasError() returns true and all following reads return null values.
+     */
+    class LIBIRCSHARED_EXPORT BinaryReader
+    {
+        public:
+            BinaryReader(QIODevice *device);
+            //! Reads and verifies magic and version, returns false if the stream isn't in supported format
+            bool ReadHeader();
+            int GetVersion() const;
+            bool HasError() const;
+            QVariant ReadValue();
+            //! Reads an object into hash form, this is the bridge for items that only implement LoadHash()
+            QHash<QString, QVariant> ReadHash();
+            //! Starts reading an object, returns false if next value isn't an object
+            bool BeginObject();
+            //! Returns name of next field of current object, or null string when the object ends
+            QString ReadField();
+            //! Skips value of field that is not needed
+            void SkipValue();
+
+        private:
+            bool ensure(int size);
+            int readByte();
+            quint64 readVarint();
+            QVariant readValue(int type, int depth);
+            QString readFieldName(quint64 id);
+            QIODevice *device;
+            QByteArray buffer;
+            int position;
+            int version;
+            bool error;
+            QList<QString> dynamicFields;
+    };
+}
+
+#endif // BINARYSERIALIZER_H
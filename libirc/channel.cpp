@@ -11,6 +11,7 @@
 // Copyright (c) Petr Bena 2015 - 2019
 
 #include "channel.h"
+#include "binaryserializer.h"
 
 using namespace libirc;
 
@@ -31,7 +32,7 @@ QString Channel::GetTopic() const
 
 void Channel::SetTopicTime(const QDateTime &time)
 {
-    this->_topicTime = time;
+    SERIALIZED_SET(_topicTime, time);
 }
 
 QDateTime Channel::GetTopicTime() const
@@ -46,7 +47,7 @@ QString Channel::GetTopicUser() const
 
 void Channel::SetTopicUser(const QString &user)
 {
-    this->_topicUser = user;
+    SERIALIZED_SET(_topicUser, user);
 }
 
 void Channel::LoadHash(const QHash<QString, QVariant> &hash)
@@ -67,13 +68,21 @@ QHash<QString, QVariant> Channel::ToHash()
     return hash;
 }
 
+void Channel::writeBinaryFields(BinaryWriter &writer)
+{
+    SERIALIZE_BINARY(_topic);
+    SERIALIZE_BINARY(_topicTime);
+    SERIALIZE_BINARY(_topicUser);
+    SERIALIZE_BINARY(_name);
+}
+
 void Channel::SetName(const QString &name)
 {
-    this->_name = name;
+    SERIALIZED_SET(_name, name);
 }
 
 void Channel::SetTopic(const QString &topic)
 {
-    this->_topic = topic;
+    SERIALIZED_SET(_topic, topic);
 }
 
@@ -35,6 +35,7 @@ namespace libirc
             QHash<QString, QVariant> ToHash() override;
 
         protected:
+            void writeBinaryFields(BinaryWriter &writer) override;
             QString _name;
             QString _topic;
             QDateTime _topicTime;
@@ -19,7 +19,9 @@ SOURCES += network.cpp \
     mode.cpp \
     channel.cpp \
     serializableitem.cpp \
-    serveraddress.cpp
+    serveraddress.cpp \
+    modeset.cpp \
+    binaryserializer.cpp
 
 HEADERS += network.h\
         libirc_global.h \
@@ -30,7 +32,9 @@ HEADERS += network.h\
     error_code.h \
     serializableitem.h \
     serveraddress.h \
-    irc_standards.h
+    irc_standards.h \
+    modeset.h \
+    binaryserializer.h
 
 unix {
     target.path = /usr/lib
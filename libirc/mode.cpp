@@ -15,35 +15,71 @@
 
 using namespace libirc;
 
-QList<SingleMode> SingleMode::ToModeList(const QString &mode_string, QList<QString> parameters, const QList<char> &parameter_modes)
+//! Returned by ModeIterator for modes with no parameter
+static const QString noParameter;
+
+QList<SingleMode> SingleMode::ToModeList(const QString &mode_string, const QList<QString> &parameters, const QList<char> &parameter_modes)
+{
+    return ToModeList(mode_string, parameters, ModeSet(parameter_modes));
+}
+
+QList<SingleMode> SingleMode::ToModeList(const QString &mode_string, const QList<QString> &parameters, const ModeSet &parameter_modes,
+                                         const ModeSet &set_parameter_modes)
 {
     QList<SingleMode> modes;
-    int position = 0;
-    char prefix = MODE_INCLUDE;
-    while (position < mode_string.size())
+    ModeIterator iterator(mode_string, parameters, parameter_modes, set_parameter_modes);
+    while (iterator.Next())
+        modes.append(SingleMode(iterator.Get(), iterator.IsIncluding(), iterator.GetParameter()));
+    if (iterator.IsBroken())
+        qDebug() << "Invalid mode: " + mode_string + " missing parameters";
+    return modes;
+}
+
+ModeIterator::ModeIterator(const QString &mode_string, const QList<QString> &parameters, const ModeSet &parameter_modes,
+                           const ModeSet &set_parameter_modes, int first_parameter) : modeString(mode_string), parameters(parameters)
+{
+    this->parameterModes = parameter_modes;
+    this->setParameterModes = set_parameter_modes;
+    this->position = 0;
+    this->nextParameter = first_parameter;
+    this->parameter = nullptr;
+    this->mode = 0;
+    this->including = true;
+    this->broken = false;
+}
+
+bool ModeIterator::Next()
+{
+    this->parameter = nullptr;
+    while (this->position < this->modeString.size())
     {
-        char sx = mode_string.at(position++).toLatin1();
+        char sx = this->modeString.at(this->position++).toLatin1();
         if (sx == MODE_EXCLUDE || sx == MODE_INCLUDE)
         {
-            prefix = sx;
+            this->including = sx == MODE_INCLUDE;
+            continue;
         }
-        else if (parameter_modes.contains(sx))
+        this->mode = sx;
+        if (this->parameterModes.Contains(sx) || (this->including && this->setParameterModes.Contains(sx)))
         {
-            if (parameters.isEmpty())
+            if (this->nextParameter >= this->parameters.size())
             {
-                qDebug() << "Invalid mode: " + mode_string + " missing parameters";
-                return modes;
+                this->broken = true;
+                this->position = this->modeString.size();
+                return false;
             }
-            SingleMode mode(QString(QChar(prefix)) + QString(QChar(sx)));
-            mode.Parameter = parameters.first();
-            parameters.removeAt(0);
-            modes.append(mode);
-        } else
-        {
-            modes.append(SingleMode((QString(QChar(prefix)) + QString(QChar(sx)))));
+            this->parameter = &this->parameters.at(this->nextParameter++);
         }
+        return true;
     }
-    return modes;
+    return false;
+}
+
+const QString &ModeIterator::GetParameter() const
+{
+    if (!this->parameter)
+        return noParameter;
+    return *this->parameter;
 }
 
 Mode::Mode(const QString &mode_string)
@@ -75,59 +111,78 @@ void Mode::SetMode(const QString &mode_string, bool reset)
     }
 }
 
-bool Mode::Includes(char mode)
+bool Mode::Includes(char mode) const
 {
-    return this->included_modes.contains(mode);
+    return this->included_modes.Contains(mode);
 }
 
-bool Mode::Excludes(char mode)
+bool Mode::Excludes(char mode) const
 {
-    return this->excluded_modes.contains(mode);
+    return this->excluded_modes.Contains(mode);
 }
 
-bool Mode::IsEmpty()
+bool Mode::IsEmpty() const
 {
-    return (this->excluded_modes.isEmpty() && this->included_modes.isEmpty());
+    return (this->excluded_modes.IsEmpty() && this->included_modes.IsEmpty());
 }
 
 void Mode::IncludeMode(char mode)
 {
-    if (this->included_modes.contains(mode))
+    if (this->included_modes.Contains(mode))
         return;
-    if (this->excluded_modes.contains(mode))
-        this->excluded_modes.removeAll(mode);
-    this->included_modes.append(mode);
+    this->excluded_modes.Remove(mode);
+    this->included_modes.Insert(mode);
+    this->markModesChanged();
 }
 
 void Mode::ExcludeMode(char mode)
 {
-    if (this->excluded_modes.contains(mode))
+    if (this->excluded_modes.Contains(mode))
         return;
-    if (this->included_modes.contains(mode))
-        this->included_modes.removeAll(mode);
-    this->excluded_modes.append(mode);
+    this->included_modes.Remove(mode);
+    this->excluded_modes.Insert(mode);
+    this->markModesChanged();
 }
 
 void Mode::ResetMode(char mode)
 {
-    if (this->included_modes.contains(mode))
-        this->included_modes.removeOne(mode);
-    if (this->excluded_modes.contains(mode))
-        this->excluded_modes.removeOne(mode);
+    if (!this->included_modes.Contains(mode) && !this->excluded_modes.Contains(mode))
+        return;
+    this->included_modes.Remove(mode);
+    this->excluded_modes.Remove(mode);
+    this->markModesChanged();
 }
 
 void Mode::ResetModes(QList<char> modes)
 {
-    foreach (char mode, modes)
-        this->ResetMode(mode);
+    this->ResetModes(ModeSet(modes));
+}
+
+void Mode::ResetModes(const ModeSet &modes)
+{
+    if ((this->included_modes & modes).IsEmpty() && (this->excluded_modes & modes).IsEmpty())
+        return;
+    this->included_modes -= modes;
+    this->excluded_modes -= modes;
+    this->markModesChanged();
 }
 
 QList<char> Mode::GetExcluding()
 {
-    return this->excluded_modes;
+    return this->excluded_modes.ToList();
 }
 
 QList<char> Mode::GetIncluding()
+{
+    return this->included_modes.ToList();
+}
+
+const ModeSet &Mode::GetExcludingSet() const
+{
+    return this->excluded_modes;
+}
+
+const ModeSet &Mode::GetIncludingSet() const
 {
     return this->included_modes;
 }
@@ -135,16 +190,16 @@ QList<char> Mode::GetIncluding()
 QString Mode::ToString()
 {
     QString mode;
-    if (!this->included_modes.isEmpty())
+    if (!this->included_modes.IsEmpty())
     {
         mode += MODE_INCLUDE;
-        foreach (char sx, this->included_modes)
+        foreach (char sx, this->included_modes.ToList())
             mode += sx;
     }
-    if (!this->excluded_modes.isEmpty())
+    if (!this->excluded_modes.IsEmpty())
     {
         mode += MODE_EXCLUDE;
-        foreach (char sx, this->excluded_modes)
+        foreach (char sx, this->excluded_modes.ToList())
             mode += sx;
     }
     return mode;
@@ -155,12 +210,12 @@ void Mode::LoadHash(const QHash<QString, QVariant> &hash)
     if (hash.contains("excluded_modes"))
     {
         foreach (QVariant mx, hash["excluded_modes"].toList())
-            this->excluded_modes.append(mx.toChar().toLatin1());
+            this->excluded_modes.Insert(mx.toChar().toLatin1());
     }
     if (hash.contains("included_modes"))
     {
         foreach (QVariant mx, hash["included_modes"].toList())
-            this->included_modes.append(mx.toChar().toLatin1());
+            this->included_modes.Insert(mx.toChar().toLatin1());
     }
     UNSERIALIZE_STRING(Parameter);
 }
@@ -170,15 +225,31 @@ QHash<QString, QVariant> Mode::ToHash()
     QHash<QString, QVariant> hash = SerializableItem::ToHash();
     QList<QVariant> included, excluded;
     SERIALIZE(Parameter);
-    foreach (char m, this->included_modes)
+    foreach (char m, this->included_modes.ToList())
         included.append(QVariant(m));
-    foreach (char m, this->excluded_modes)
+    foreach (char m, this->excluded_modes.ToList())
         excluded.append(QVariant(m));
     hash.insert("included_modes", QVariant(included));
     hash.insert("excluded_modes", QVariant(excluded));
     return hash;
 }
 
+void Mode::ApplyDelta(const QHash<QString, QVariant> &delta)
+{
+    if (delta.contains("included_modes"))
+        this->included_modes.Clear();
+    if (delta.contains("excluded_modes"))
+        this->excluded_modes.Clear();
+    this->LoadHash(delta);
+}
+
+void Mode::markModesChanged()
+{
+    // Including a mode may remove it from excluded ones and vice versa, so both lists are always sent
+    this->MarkChanged("included_modes");
+    this->MarkChanged("excluded_modes");
+}
+
 SingleMode::SingleMode(QString mode)
 {
     if (mode.size() > 2)
@@ -207,6 +278,14 @@ SingleMode::SingleMode(QString mode)
     }
 }
 
+SingleMode::SingleMode(char mode, bool including, const QString &parameter)
+{
+    this->Parameter = parameter;
+    this->valid = true;
+    this->including = including;
+    this->mode = mode;
+}
+
 SingleMode::SingleMode(const QHash<QString, QVariant> &hash)
 {
     this->including = false;
@@ -14,6 +14,7 @@
 #define LIBMODE_H
 
 #include "serializableitem.h"
+#include "modeset.h"
 
 #define MODE_INCLUDE '+'
 #define MODE_EXCLUDE '-'
@@ -23,9 +24,13 @@ namespace libirc
     class LIBIRCSHARED_EXPORT SingleMode : public SerializableItem
     {
         public:
-            static QList<SingleMode> ToModeList(const QString &mode_string, QList<QString> parameters, const QList<char> &parameter_modes);
+            static QList<SingleMode> ToModeList(const QString &mode_string, const QList<QString> &parameters, const QList<char> &parameter_modes);
+            //! Same as ModeIterator, but every mode is copied to the list, prefer ModeIterator when you only need to walk over them
+            static QList<SingleMode> ToModeList(const QString &mode_string, const QList<QString> &parameters, const ModeSet &parameter_modes,
+                                                const ModeSet &set_parameter_modes = ModeSet());
 
             SingleMode(QString mode);
+            SingleMode(char mode, bool including, const QString &parameter = QString());
             SingleMode(const QHash<QString, QVariant> &hash);
              ~SingleMode() override=default;
             bool IsIncluding();
@@ -42,6 +47,45 @@ namespace libirc
             char mode;
     };
 
+    /*!
+     * \brief Walks over a mode string such as +ov-b and pairs the modes with their parameters
+     *
+     * Nothing is copied, the parameter is a reference to an item of the list the iterator was created with,
+     * so both the mode string and the list of parameters must outlive the iterator.
+     */
+    class LIBIRCSHARED_EXPORT ModeIterator
+    {
+        public:
+            /*!
+             * \param parameter_modes Modes that always take a parameter (for example +b, +o or +k)
+             * \param set_parameter_modes Modes that take a parameter only when they are being set (for example +l)
+             * \param first_parameter Index of item in parameters that belongs to the first mode that takes a parameter
+             */
+            ModeIterator(const QString &mode_string, const QList<QString> &parameters, const ModeSet &parameter_modes,
+                         const ModeSet &set_parameter_modes = ModeSet(), int first_parameter = 0);
+            //! Moves to next mode, returns false at the end of mode string or when a parameter is missing, see IsBroken()
+            bool Next();
+            bool IsIncluding() const { return this->including; }
+            char Get() const { return this->mode; }
+            bool HasParameter() const { return this->parameter != nullptr; }
+            //! Parameter of current mode, empty string if it has none
+            const QString &GetParameter() const;
+            //! True if iteration stopped because mode string requires more parameters than there are
+            bool IsBroken() const { return this->broken; }
+
+        private:
+            const QString &modeString;
+            const QList<QString> &parameters;
+            ModeSet parameterModes;
+            ModeSet setParameterModes;
+            int position;
+            int nextParameter;
+            const QString *parameter;
+            char mode;
+            bool including;
+            bool broken;
+    };
+
     class LIBIRCSHARED_EXPORT Mode : public SerializableItem
     {
         public:
@@ -54,23 +98,31 @@ namespace libirc
              * \param reset If true the modes after MODE_EXCLUDE sign will be reset, instead of append to exluding modes
              */
             void SetMode(const QString &mode_string, bool reset = false);
-            bool Includes(char mode);
-            bool Excludes(char mode);
-            bool IsEmpty();
+            bool Includes(char mode) const;
+            bool Excludes(char mode) const;
+            bool IsEmpty() const;
             void IncludeMode(char mode);
             void ExcludeMode(char mode);
             void ResetMode(char mode);
             void ResetModes(QList<char> modes);
+            void ResetModes(const ModeSet &modes);
             QList<char> GetExcluding();
             QList<char> GetIncluding();
+            const ModeSet &GetExcludingSet() const;
+            const ModeSet &GetIncludingSet() const;
             QString ToString();
             void LoadHash(const QHash<QString, QVariant> &hash) override;
             QHash<QString, QVariant> ToHash() override;
+            //! Lists of modes in delta replace current ones, LoadHash() only appends to them
+            void ApplyDelta(const QHash<QString, QVariant> &delta) override;
             QString Parameter;
 
         protected:
-            QList<char> included_modes;
-            QList<char> excluded_modes;
+            ModeSet included_modes;
+            ModeSet excluded_modes;
+
+        private:
+            void markModesChanged();
     };
 }
 
@@ -0,0 +1,137 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "modeset.h"
+#include <cstring>
+
+using namespace libirc;
+
+static int popCount(quint64 value)
+{
+    value = value - ((value >> 1) & Q_UINT64_C(0x5555555555555555));
+    value = (value & Q_UINT64_C(0x3333333333333333)) + ((value >> 2) & Q_UINT64_C(0x3333333333333333));
+    value = (value + (value >> 4)) & Q_UINT64_C(0x0f0f0f0f0f0f0f0f);
+    return static_cast<int>((value * Q_UINT64_C(0x0101010101010101)) >> 56);
+}
+
+ModeSet::ModeSet(const QList<char> &modes)
+{
+    this->bits[0] = 0;
+    this->bits[1] = 0;
+    foreach (char mode, modes)
+        this->Insert(mode);
+}
+
+ModeSet ModeSet::FromString(const QString &modes)
+{
+    ModeSet set;
+    foreach (QChar mode, modes)
+        set.Insert(mode.toLatin1());
+    return set;
+}
+
+int ModeSet::Count() const
+{
+    return popCount(this->bits[0]) + popCount(this->bits[1]);
+}
+
+int ModeSet::Rank(char mode) const
+{
+    if (!this->Contains(mode))
+        return -1;
+    unsigned char c = static_cast<unsigned char>(mode);
+    quint64 below = (Q_UINT64_C(1) << (c & 63)) - 1;
+    if (c < 64)
+        return popCount(this->bits[0] & below);
+    return popCount(this->bits[0]) + popCount(this->bits[1] & below);
+}
+
+QList<char> ModeSet::ToList() const
+{
+    QList<char> result;
+    for (int c = 0; c < 128; c++)
+    {
+        if (this->bits[c >> 6] & (Q_UINT64_C(1) << (c & 63)))
+            result.append(static_cast<char>(c));
+    }
+    return result;
+}
+
+ModeSet ModeSet::operator|(const ModeSet &other) const
+{
+    ModeSet result = *this;
+    result |= other;
+    return result;
+}
+
+ModeSet ModeSet::operator&(const ModeSet &other) const
+{
+    ModeSet result;
+    result.bits[0] = this->bits[0] & other.bits[0];
+    result.bits[1] = this->bits[1] & other.bits[1];
+    return result;
+}
+
+ModeSet &ModeSet::operator|=(const ModeSet &other)
+{
+    this->bits[0] |= other.bits[0];
+    this->bits[1] |= other.bits[1];
+    return *this;
+}
+
+ModeSet &ModeSet::operator-=(const ModeSet &other)
+{
+    this->bits[0] &= ~other.bits[0];
+    this->bits[1] &= ~other.bits[1];
+    return *this;
+}
+
+RankedModeSet::RankedModeSet()
+{
+    this->Clear();
+}
+
+RankedModeSet::RankedModeSet(const QList<char> &modes)
+{
+    this->Set(modes);
+}
+
+void RankedModeSet::Set(const QList<char> &modes)
+{
+    this->Clear();
+    foreach (char mode, modes)
+    {
+        unsigned char c = static_cast<unsigned char>(mode);
+        if (c >= 128 || this->set.Contains(mode))
+            continue;
+        this->set.Insert(mode);
+        this->ranks[c] = static_cast<signed char>(this->count);
+        this->modes[this->count++] = mode;
+    }
+}
+
+void RankedModeSet::Clear()
+{
+    this->set.Clear();
+    this->count = 0;
+    memset(this->modes, 0, sizeof(this->modes));
+    memset(this->ranks, -1, sizeof(this->ranks));
+}
+
+QList<char> RankedModeSet::ToList() const
+{
+    QList<char> result;
+    result.reserve(this->count);
+    for (int i = 0; i < this->count; i++)
+        result.append(this->modes[i]);
+    return result;
+}
@@ -0,0 +1,106 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef MODESET_H
+#define MODESET_H
+
+#include "libirc_global.h"
+#include <QList>
+#include <QString>
+
+namespace libirc
+{
+    /*!
+     * \brief Set of mode characters stored as 128 bit mask, one bit for every ASCII character
+     *
+     * All operations are constant time and never allocate, characters outside of ASCII are never members.
+     * ToList() returns the modes in ASCII order.
+     */
+    class LIBIRCSHARED_EXPORT ModeSet
+    {
+        public:
+            static ModeSet FromString(const QString &modes);
+
+            ModeSet() { this->bits[0] = 0; this->bits[1] = 0; }
+            ModeSet(const QList<char> &modes);
+            bool Contains(char mode) const
+            {
+                unsigned char c = static_cast<unsigned char>(mode);
+                return c < 128 && (this->bits[c >> 6] & (Q_UINT64_C(1) << (c & 63)));
+            }
+            void Insert(char mode)
+            {
+                unsigned char c = static_cast<unsigned char>(mode);
+                if (c < 128)
+                    this->bits[c >> 6] |= Q_UINT64_C(1) << (c & 63);
+            }
+            void Remove(char mode)
+            {
+                unsigned char c = static_cast<unsigned char>(mode);
+                if (c < 128)
+                    this->bits[c >> 6] &= ~(Q_UINT64_C(1) << (c & 63));
+            }
+            void Clear() { this->bits[0] = 0; this->bits[1] = 0; }
+            bool IsEmpty() const { return !this->bits[0] && !this->bits[1]; }
+            int Count() const;
+            //! Returns number of modes in the set that are lower than this mode, or -1 if mode is not in the set
+            int Rank(char mode) const;
+            QList<char> ToList() const;
+            ModeSet operator|(const ModeSet &other) const;
+            ModeSet operator&(const ModeSet &other) const;
+            ModeSet &operator|=(const ModeSet &other);
+            //! Removes all modes of other set from this one
+            ModeSet &operator-=(const ModeSet &other);
+            bool operator==(const ModeSet &other) const { return this->bits[0] == other.bits[0] && this->bits[1] == other.bits[1]; }
+            bool operator!=(const ModeSet &other) const { return !(*this == other); }
+
+        private:
+            quint64 bits[2];
+    };
+
+    /*!
+     * \brief Set of mode characters that remembers their order, used for modes that are ranked, such as channel user modes
+     *
+     * Rank of a mode is its position in the list the set was created from, so for PREFIX=(qaohv) mode q has rank 0.
+     * Both lookups are constant time table reads.
+     */
+    class LIBIRCSHARED_EXPORT RankedModeSet
+    {
+        public:
+            RankedModeSet();
+            RankedModeSet(const QList<char> &modes);
+            //! Replaces content of the set, duplicates and characters outside of ASCII are skipped
+            void Set(const QList<char> &modes);
+            void Clear();
+            bool Contains(char mode) const { return this->set.Contains(mode); }
+            //! Returns position of mode, or -1 if it's not in the set
+            int Rank(char mode) const
+            {
+                unsigned char c = static_cast<unsigned char>(mode);
+                return c < 128 ? this->ranks[c] : -1;
+            }
+            //! Returns mode with this rank, or 0 if there is no such rank
+            char At(int rank) const { return (rank >= 0 && rank < this->count) ? this->modes[rank] : 0; }
+            int Count() const { return this->count; }
+            bool IsEmpty() const { return this->count == 0; }
+            const ModeSet &GetSet() const { return this->set; }
+            QList<char> ToList() const;
+
+        private:
+            ModeSet set;
+            int count;
+            char modes[128];
+            signed char ranks[128];
+    };
+}
+
+#endif // MODESET_H
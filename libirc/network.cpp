@@ -11,6 +11,7 @@
 // Copyright (c) Petr Bena 2015 - 2018
 
 #include "network.h"
+#include "binaryserializer.h"
 
 using namespace libirc;
 
@@ -31,6 +32,11 @@ QHash<QString, QVariant> Network::ToHash()
     return hash;
 }
 
+void Network::writeBinaryFields(BinaryWriter &writer)
+{
+    SERIALIZE_BINARY(networkName);
+}
+
 QString Network::GetNetworkName()
 {
     return this->networkName;
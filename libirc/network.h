@@ -27,6 +27,7 @@ namespace libirc
             QHash<QString, QVariant> ToHash() override;
             QString GetNetworkName();
 		protected:
+            void writeBinaryFields(BinaryWriter &writer) override;
             QString networkName;
     };
 }
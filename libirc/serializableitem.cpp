@@ -11,14 +11,37 @@
 // Copyright (c) Petr Bena 2015 - 2019
 
 #include "serializableitem.h"
+#include "binaryserializer.h"
+#include <QMutex>
+#include <cstring>
 #include <limits>
 
+// Number of independent parts of RPC registry, ids are spread over them by their lowest bits
+#define RPC_REGISTRY_SHARDS 16
+
 using namespace libirc;
 
 const unsigned long long SerializableItem::LIBIRC_UNKNOWN_RPC_ID = std::numeric_limits<unsigned long long>::max();
-unsigned long long SerializableItem::__rpc_currentID = 0;
-QMutex SerializableItem::__rpc_lock;
-QHash<unsigned long long, SerializableItem*> SerializableItem::__rpc_cache;
+std::atomic<unsigned long long> SerializableItem::__rpc_currentID(0);
+static std::atomic<quint64> currentGeneration(0);
+
+namespace
+{
+    // Each shard is on its own cache line, so that threads working with different shards don't slow each other
+    struct alignas(64) RPCRegistryShard
+    {
+        QMutex Lock;
+        QHash<unsigned long long, SerializableItem*> Items;
+    };
+}
+
+static RPCRegistryShard rpcRegistry[RPC_REGISTRY_SHARDS];
+static thread_local RPCRegistrationBatch *rpcBatch = nullptr;
+
+static RPCRegistryShard &rpcShard(unsigned long long id)
+{
+    return rpcRegistry[id % RPC_REGISTRY_SHARDS];
+}
 
 QList<int> SerializableItem::DeserializeList_int(const QVariant &list)
 {
@@ -59,17 +82,28 @@ QList<QVariant> SerializableItem::CCharListToVariantList(const QList<char> &list
 SerializableItem::SerializableItem()
 {
     this->__rpc_id = LIBIRC_UNKNOWN_RPC_ID;
+    // Temporary items are created all the time on every thread, so construction doesn't increment the shared counter,
+    // item is still newer than any GetCurrentGeneration() taken before, because that one does increment it
+    this->__createdGeneration = currentGeneration.load(std::memory_order_relaxed) + 1;
+    this->__generation = this->__createdGeneration;
 }
 
 libirc::SerializableItem::~SerializableItem()
 {
     if (this->__rpc_id == SerializableItem::LIBIRC_UNKNOWN_RPC_ID)
         return;
-    // remove this instance from cache if there is some
-    __rpc_lock.lock();
-    if (__rpc_cache.contains(this->__rpc_id))
-        __rpc_cache.remove(this->__rpc_id);
-    __rpc_lock.unlock();
+    // remove this instance from registry if it's there, copies of items have same id, but they are not registered
+    if (rpcBatch && rpcBatch->items.value(this->__rpc_id) == this)
+    {
+        rpcBatch->items.remove(this->__rpc_id);
+        return;
+    }
+    RPCRegistryShard &shard = rpcShard(this->__rpc_id);
+    shard.Lock.lock();
+    QHash<unsigned long long, SerializableItem*>::iterator item = shard.Items.find(this->__rpc_id);
+    if (item != shard.Items.end() && item.value() == this)
+        shard.Items.erase(item);
+    shard.Lock.unlock();
 }
 
 QHash<QString, QVariant> SerializableItem::ToHash()
@@ -89,9 +123,7 @@ void SerializableItem::LoadHash(QHash<QString, QVariant> hash)
     if (!hash.contains("__rpc_id"))
         return;
     UNSERIALIZE_ULONGLONG(__rpc_id);
-    __rpc_lock.lock();
-    __rpc_cache.insert(__rpc_id, this);
-    __rpc_lock.unlock();
+    this->registerRPC();
 }
 
 void SerializableItem::LoadHash(const QHash<QString, QVariant> &hash)
@@ -99,9 +131,122 @@ void SerializableItem::LoadHash(const QHash<QString, QVariant> &hash)
     if (!hash.contains("__rpc_id"))
         return;
     UNSERIALIZE_ULONGLONG(__rpc_id);
-    __rpc_lock.lock();
-    __rpc_cache.insert(__rpc_id, this);
-    __rpc_lock.unlock();
+    this->registerRPC();
+}
+
+void SerializableItem::ToBinary(BinaryWriter &writer)
+{
+    writer.BeginObject();
+    this->writeBinaryFields(writer);
+    writer.EndObject();
+}
+
+void SerializableItem::LoadBinary(BinaryReader &reader)
+{
+    // There are two overloads of LoadHash(), subclasses override the one that takes a reference
+    void (SerializableItem::*load_hash)(const QHash<QString, QVariant>&) = &SerializableItem::LoadHash;
+    (this->*load_hash)(reader.ReadHash());
+}
+
+void SerializableItem::SaveBinary(QIODevice *device)
+{
+    BinaryWriter writer(device);
+    writer.WriteHeader();
+    this->ToBinary(writer);
+    writer.Flush();
+}
+
+bool SerializableItem::LoadBinary(QIODevice *device)
+{
+    BinaryReader reader(device);
+    if (!reader.ReadHeader())
+        return false;
+    RPCRegistrationBatch rpc_batch;
+    this->LoadBinary(reader);
+    return !reader.HasError();
+}
+
+void SerializableItem::writeBinaryFields(BinaryWriter &writer)
+{
+    QHash<QString, QVariant> hash = this->ToHash();
+    QHash<QString, QVariant>::const_iterator field = hash.constBegin();
+    for (; field != hash.constEnd(); ++field)
+    {
+        writer.WriteField(field.key());
+        writer.WriteValue(field.value());
+    }
+}
+
+quint64 SerializableItem::GetCurrentGeneration()
+{
+    return nextGeneration();
+}
+
+quint64 SerializableItem::GetCreatedGeneration() const
+{
+    return this->__createdGeneration;
+}
+
+quint64 SerializableItem::GetGeneration() const
+{
+    return this->__generation;
+}
+
+void SerializableItem::MarkChanged(const char *field)
+{
+    this->__generation = nextGeneration();
+    for (int i = 0; i < this->__changedFields.size(); i++)
+    {
+        // Names are usually the same literals, so pointers are compared first
+        ChangedField &changed = this->__changedFields[i];
+        if (changed.Name == field || !std::strcmp(changed.Name, field))
+        {
+            changed.Generation = this->__generation;
+            return;
+        }
+    }
+    ChangedField changed;
+    changed.Name = field;
+    changed.Generation = this->__generation;
+    this->__changedFields.append(changed);
+}
+
+QList<QString> SerializableItem::GetChangedFields(quint64 since_generation) const
+{
+    QList<QString> fields;
+    if (this->__generation <= since_generation)
+        return fields;
+    foreach (ChangedField changed, this->__changedFields)
+    {
+        if (changed.Generation > since_generation)
+            fields.append(QString(changed.Name));
+    }
+    return fields;
+}
+
+QHash<QString, QVariant> SerializableItem::ToDelta(quint64 since_generation)
+{
+    if (this->__createdGeneration > since_generation)
+        return this->ToHash();
+    QHash<QString, QVariant> delta;
+    QList<QString> fields = this->GetChangedFields(since_generation);
+    if (fields.isEmpty())
+        return delta;
+    QHash<QString, QVariant> hash = this->ToHash();
+    foreach (QString field, fields)
+        delta.insert(field, hash.value(field));
+    return delta;
+}
+
+void SerializableItem::ApplyDelta(const QHash<QString, QVariant> &delta)
+{
+    void (SerializableItem::*load_hash)(const QHash<QString, QVariant>&) = &SerializableItem::LoadHash;
+    (this->*load_hash)(delta);
+}
+
+quint64 SerializableItem::nextGeneration()
+{
+    return ++currentGeneration;
 }
 
 void SerializableItem::RPC(int function, const QList<QVariant> &parameters)
@@ -114,11 +259,60 @@ unsigned long long SerializableItem::__rpc_GetID()
 {
     if (this->__rpc_id == SerializableItem::LIBIRC_UNKNOWN_RPC_ID)
     {
-        __rpc_lock.lock();
         this->__rpc_id = SerializableItem::__rpc_currentID++;
-        __rpc_cache.insert(__rpc_id, this);
-        __rpc_lock.unlock();
+        this->registerRPC();
     }
     return this->__rpc_id;
 }
 
+SerializableItem *SerializableItem::GetItemByRPCID(unsigned long long id)
+{
+    if (rpcBatch && rpcBatch->items.contains(id))
+        return rpcBatch->items.value(id);
+    RPCRegistryShard &shard = rpcShard(id);
+    shard.Lock.lock();
+    SerializableItem *item = shard.Items.value(id, nullptr);
+    shard.Lock.unlock();
+    return item;
+}
+
+void SerializableItem::registerRPC()
+{
+    if (rpcBatch)
+    {
+        rpcBatch->items.insert(this->__rpc_id, this);
+        return;
+    }
+    RPCRegistryShard &shard = rpcShard(this->__rpc_id);
+    shard.Lock.lock();
+    shard.Items.insert(this->__rpc_id, this);
+    shard.Lock.unlock();
+}
+
+RPCRegistrationBatch::RPCRegistrationBatch()
+{
+    this->outermost = !rpcBatch;
+    if (this->outermost)
+        rpcBatch = this;
+}
+
+RPCRegistrationBatch::~RPCRegistrationBatch()
+{
+    if (!this->outermost)
+        return;
+    rpcBatch = nullptr;
+    QList<SerializableItem*> shard_items[RPC_REGISTRY_SHARDS];
+    QHash<unsigned long long, SerializableItem*>::const_iterator item = this->items.constBegin();
+    for (; item != this->items.constEnd(); ++item)
+        shard_items[item.key() % RPC_REGISTRY_SHARDS].append(item.value());
+    for (int i = 0; i < RPC_REGISTRY_SHARDS; i++)
+    {
+        if (shard_items[i].isEmpty())
+            continue;
+        rpcRegistry[i].Lock.lock();
+        foreach (SerializableItem *registered, shard_items[i])
+            rpcRegistry[i].Items.insert(registered->__rpc_id, registered);
+        rpcRegistry[i].Lock.unlock();
+    }
+}
+
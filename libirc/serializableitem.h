@@ -16,9 +16,11 @@
 #include <QVariant>
 #include <QHash>
 #include <QString>
-#include <QMutex>
+#include <atomic>
 #include "libirc_global.h"
 
+class QIODevice;
+
 #define SERIALIZE(variable_name)          hash.insert(#variable_name, QVariant(variable_name))
 #define SERIALIZE_CCHAR(variable_name)    hash.insert(#variable_name, QVariant(QChar(variable_name)))
 #define SERIALIZE_CHARLIST(variable_name) hash.insert(#variable_name, ::libirc::SerializableItem::CCharListToVariantList(variable_name))
@@ -33,9 +35,18 @@
 #define UNSERIALIZE_ULONGLONG(variable_name)  if (hash.contains(#variable_name)) { variable_name = hash[#variable_name].toULongLong(); }
 #define UNSERIALIZE_STRINGLIST(list)          if (hash.contains(#list)) { list = ::libirc::SerializableItem::DeserializeList_QString(hash[#list]); }
 #define UNSERIALIZE_CHARLIST(list)            if (hash.contains(#list)) { list = ::libirc::SerializableItem::DeserializeList_char(hash[#list]); }
+// Changes serialized member and marks it as changed for ToDelta(), if the value is different, value is evaluated
+// only once and converted to type of the member before it's compared
+#define SERIALIZED_SET(variable_name, value)  do { decltype(variable_name) serialized_value = (value); \
+                                                   if (variable_name != serialized_value) \
+                                                   { variable_name = serialized_value; this->MarkChanged(#variable_name); } } while (0)
 
 namespace libirc
 {
+    class BinaryWriter;
+    class BinaryReader;
+    class RPCRegistrationBatch;
+
     class LIBIRCSHARED_EXPORT SerializableItem
     {
         public:
@@ -50,15 +61,81 @@ namespace libirc
             virtual QHash<QString, QVariant> ToHash();
             virtual void LoadHash(QHash<QString, QVariant> hash);
             virtual void LoadHash(const QHash<QString, QVariant> &hash);
+            //! Writes this item as one object, by default it's the output of ToHash() converted to binary form
+            virtual void ToBinary(BinaryWriter &writer);
+            //! Reads object written by ToBinary(), by default it's converted to hash form and passed to LoadHash()
+            virtual void LoadBinary(BinaryReader &reader);
+            //! Writes complete binary stream (header and this item) to device
+            void SaveBinary(QIODevice *device);
+            //! Reads complete binary stream from device, returns false if it isn't valid
+            bool LoadBinary(QIODevice *device);
+            //! Returns generation of newest change of any item, pass it to ToDelta() later to get only changes made after now
+            static quint64 GetCurrentGeneration();
+            //! Generation in which this item was created, all fields of item are new to anyone who knows older state
+            quint64 GetCreatedGeneration() const;
+            //! Generation of the last change of this item
+            quint64 GetGeneration() const;
+            //! Marks a field as changed, the name must be same as in ToHash(). Setters do this on their own, public
+            //! members need to be marked by whoever changes them.
+            void MarkChanged(const char *field);
+            //! Returns names of fields that were changed after given generation
+            QList<QString> GetChangedFields(quint64 since_generation) const;
+            /*!
+             * \brief ToDelta returns only fields that changed after given generation, in same form as ToHash()
+             * \param since_generation Result of GetCurrentGeneration() from the time the other side got its state
+             * \return Changed fields, whole ToHash() if item was created later, empty hash if nothing changed
+             */
+            virtual QHash<QString, QVariant> ToDelta(quint64 since_generation);
+            //! Applies result of ToDelta(), by default it's passed to LoadHash() which only touches fields in the hash
+            virtual void ApplyDelta(const QHash<QString, QVariant> &delta);
             virtual void RPC(int function, const QList<QVariant> &parameters);
             virtual bool SupportsRPC() { return false; }
             virtual unsigned long long __rpc_GetID();
+            //! Returns item with this RPC id, or nullptr if there is none
+            static SerializableItem *GetItemByRPCID(unsigned long long id);
         protected:
-            static QHash<unsigned long long, SerializableItem*> __rpc_cache;
-            static QMutex __rpc_lock;
-
-            static unsigned long long __rpc_currentID;
+            //! Writes fields of this item without the object they are in, override this together with ToHash() so that
+            //! binary form doesn't need to create the hash first, the names of fields should be same as in the hash
+            virtual void writeBinaryFields(BinaryWriter &writer);
+            //! Creates new generation, use it to stamp changes that are not fields of item (removed children...)
+            static quint64 nextGeneration();
+            static std::atomic<unsigned long long> __rpc_currentID;
             unsigned long long __rpc_id;
+            quint64 __createdGeneration;
+            quint64 __generation;
+
+        private:
+            friend class RPCRegistrationBatch;
+            //! Inserts this item to registry of RPC ids, or to batch of current thread if there is one
+            void registerRPC();
+            struct ChangedField
+            {
+                const char *Name;
+                quint64 Generation;
+            };
+            //! Fields changed since the item was created, with generation of their last change
+            QList<ChangedField> __changedFields;
+    };
+
+    /*!
+     * \brief Defers registration of RPC ids of items loaded on current thread until the batch is destroyed
+     *
+     * Registry of RPC ids is split to shards with their own locks and an item normally takes lock of its shard when it
+     * gets an id. When many items are loaded at once, for example whole network, create this object on stack before
+     * calling LoadHash() and all items are registered at the end with one lock per shard. Batches can be nested, only
+     * the outermost one registers the items.
+     */
+    class LIBIRCSHARED_EXPORT RPCRegistrationBatch
+    {
+        public:
+            RPCRegistrationBatch();
+            ~RPCRegistrationBatch();
+
+        private:
+            friend class SerializableItem;
+            //! True if there was no other batch on this thread when this one was created
+            bool outermost;
+            QHash<unsigned long long, SerializableItem*> items;
     };
 }
 
@@ -11,6 +11,7 @@
 // Copyright (c) Petr Bena 2015
 
 #include "user.h"
+#include "binaryserializer.h"
 
 using namespace libirc;
 
@@ -59,12 +60,12 @@ QString User::GetIdent() const
 
 void User::SetIdent(const QString &ident)
 {
-    this->_ident = ident;
+    SERIALIZED_SET(_ident, ident);
 }
 
 void User::SetHost(const QString &host)
 {
-    this->_host = host;
+    SERIALIZED_SET(_host, host);
 }
 
 QString User::GetNick() const
@@ -74,7 +75,7 @@ QString User::GetNick() const
 
 void User::SetNick(const QString &nick)
 {
-    this->_nick = nick;
+    SERIALIZED_SET(_nick, nick);
 }
 
 QString libirc::User::ToString() const
@@ -84,7 +85,7 @@ QString libirc::User::ToString() const
 
 void User::SetRealname(const QString &user)
 {
-    this->_username = user;
+    SERIALIZED_SET(_username, user);
 }
 
 QString User::GetRealname() const
@@ -114,3 +115,11 @@ QHash<QString, QVariant> User::ToHash()
     SERIALIZE(_host);
     return hash;
 }
+
+void User::writeBinaryFields(BinaryWriter &writer)
+{
+    SERIALIZE_BINARY(_username);
+    SERIALIZE_BINARY(_nick);
+    SERIALIZE_BINARY(_ident);
+    SERIALIZE_BINARY(_host);
+}
@@ -41,6 +41,7 @@ namespace libirc
             QHash<QString, QVariant> ToHash() override;
 
         protected:
+            void writeBinaryFields(BinaryWriter &writer) override;
             QString _host;
             QString _ident;
             QString _nick;
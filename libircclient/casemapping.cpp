@@ -0,0 +1,91 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "casemapping.h"
+
+using namespace libircclient;
+
+CaseMapping libircclient::CaseMappingFromString(const QString &name)
+{
+    if (name == "ascii")
+        return CaseMappingASCII;
+    if (name == "strict-rfc1459")
+        return CaseMappingStrictRFC1459;
+    return CaseMappingRFC1459;
+}
+
+static inline ushort foldCharacter(ushort c, CaseMapping mapping)
+{
+    // Upper case characters are always 32 positions before their lower case, rfc1459 only extends the
+    // range from A-Z to A-^ and strict-rfc1459 to A-]
+    ushort last = 'Z';
+    if (mapping == CaseMappingRFC1459)
+        last = '^';
+    else if (mapping == CaseMappingStrictRFC1459)
+        last = ']';
+    if (c >= 'A' && c <= last)
+        return static_cast<ushort>(c + ('a' - 'A'));
+    return c;
+}
+
+QString NickKey::Fold(const QString &name, CaseMapping mapping)
+{
+    const QChar *data = name.constData();
+    int size = name.size();
+    int position = 0;
+    // Names without any upper case characters don't need a copy
+    while (position < size && foldCharacter(data[position].unicode(), mapping) == data[position].unicode())
+        position++;
+    if (position == size)
+        return name;
+    QString result = name;
+    QChar *target = result.data();
+    for (; position < size; position++)
+        target[position] = QChar(foldCharacter(target[position].unicode(), mapping));
+    return result;
+}
+
+NickKey::NickKey()
+{
+    this->hash = 0;
+}
+
+NickKey::NickKey(const QString &name, CaseMapping mapping)
+{
+    this->folded = NickKey::Fold(name, mapping);
+    this->hash = static_cast<uint>(qHash(this->folded));
+}
+
+QString NickKey::GetFolded() const
+{
+    return this->folded;
+}
+
+uint NickKey::GetHash() const
+{
+    return this->hash;
+}
+
+bool NickKey::IsEmpty() const
+{
+    return this->folded.isEmpty();
+}
+
+bool NickKey::operator==(const NickKey &other) const
+{
+    return this->hash == other.hash && this->folded == other.folded;
+}
+
+bool NickKey::operator!=(const NickKey &other) const
+{
+    return !(*this == other);
+}
@@ -0,0 +1,72 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef CASEMAPPING_H
+#define CASEMAPPING_H
+
+#include <QString>
+#include <QHash>
+#include "libircclient_global.h"
+
+namespace libircclient
+{
+    //! How are nicknames and channel names compared, as announced by CASEMAPPING token of ISUPPORT
+    enum CaseMapping
+    {
+        //! Only A-Z are folded to a-z
+        CaseMappingASCII = 0,
+        //! Like ASCII, plus {}|~ are lower case of []\^, this is the default if server doesn't say otherwise
+        CaseMappingRFC1459 = 1,
+        //! Like RFC1459, but ~ and ^ are different characters
+        CaseMappingStrictRFC1459 = 2
+    };
+
+    //! Converts value of CASEMAPPING token to enum, unknown mappings are treated as rfc1459
+    LIBIRCCLIENTSHARED_EXPORT CaseMapping CaseMappingFromString(const QString &name);
+
+    /*!
+     * \brief The NickKey class is a case folded nickname (or channel name) that can be used as hash key
+     *
+     * Folding and hashing is done only once when the key is created, comparison of two keys first compares
+     * the hashes, so unlike toLower() it doesn't allocate anything on lookup. Names that are already folded
+     * share the data with original string.
+     */
+    class LIBIRCCLIENTSHARED_EXPORT NickKey
+    {
+        public:
+            //! Returns the name folded by given case mapping, non ASCII characters are never folded
+            static QString Fold(const QString &name, CaseMapping mapping);
+
+            NickKey();
+            NickKey(const QString &name, CaseMapping mapping);
+            QString GetFolded() const;
+            uint GetHash() const;
+            bool IsEmpty() const;
+            bool operator==(const NickKey &other) const;
+            bool operator!=(const NickKey &other) const;
+
+        private:
+            QString folded;
+            uint hash;
+    };
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    inline size_t qHash(const NickKey &key, size_t seed = 0)
+#else
+    inline uint qHash(const NickKey &key, uint seed = 0)
+#endif
+    {
+        return key.GetHash() ^ seed;
+    }
+}
+
+#endif // CASEMAPPING_H
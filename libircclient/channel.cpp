@@ -13,18 +13,21 @@
 #include "channel.h"
 #include "user.h"
 #include "network.h"
+#include "../libirc/binaryserializer.h"
 
 using namespace libircclient;
 
 Channel::Channel(const QHash<QString, QVariant> &hash) : libirc::Channel("")
 {
     this->_net = nullptr;
+    this->_shared = false;
     this->LoadHash(hash);
 }
 
 Channel::Channel(const QString &name, Network *network) : libirc::Channel(name)
 {
     this->_net = network;
+    this->_shared = false;
     this->_localModeDateTime = QDateTime::currentDateTime();
 }
 
@@ -40,57 +43,81 @@ Channel::Channel(const Channel &channel) : libirc::Channel(channel._name)
 
 Channel::~Channel()
 {
-    qDeleteAll(this->_users.values());
-    this->_users.clear();
+    this->ClearUsers();
+}
+
+// Channel user modes are letters, each of them has its own bit
+static inline int cuModeBit(char mode)
+{
+    if (mode >= 'a' && mode <= 'z')
+        return mode - 'a';
+    if (mode >= 'A' && mode <= 'Z')
+        return 26 + (mode - 'A');
+    return -1;
 }
 
 User *Channel::InsertUser(User *user)
 {
-    User *ux;
+    return this->InsertUser(user, user->CUModes);
+}
 
-    QString luser = user->GetNick().toLower();
+User *Channel::InsertUser(User *user, const QList<char> &cu_modes)
+{
+    NickKey key = this->GetNickKey(user->GetNick());
+    quint64 modes = this->cuModesFromList(cu_modes);
 
-    if (this->_users.contains(luser))
-    {
-        ux = this->_users[luser];
-        ux->ChannelPrefixes = user->ChannelPrefixes;
-        ux->CUModes = user->CUModes;
-        ux->SetHost(user->GetHost());
-        ux->SetIdent(user->GetIdent());
-        ux->ServerName = user->ServerName;
-        ux->IsAway = user->IsAway;
-        ux->AwayMs = user->AwayMs;
-        ux->SetRealname(user->GetRealname());
-    }
-    else
+    ChannelMemberTable::Entry *member = this->_users.Find(key);
+    this->MarkChanged("users");
+    if (member)
     {
-        ux = new User(user);
-        this->_users.insert(luser, ux);
+        member->CUModes = modes;
+        member->Record->UpdateFrom(user);
+        //emit this->Event_UserInserted(member->Record);
+        return member->Record;
     }
 
-    //emit this->Event_UserInserted(ux);
-    return ux;
+    member = this->_users.Insert(key, this->acquireUser(key, user), modes);
+    //emit this->Event_UserInserted(member->Record);
+    return member->Record;
 }
 
 void Channel::RemoveUser(QString user)
 {
-    user = user.toLower();
-    if (!this->_users.contains(user))
+    this->RemoveUser(this->GetNickKey(user));
+}
+
+void Channel::RemoveUser(const NickKey &user)
+{
+    ChannelMemberTable::Entry *member = this->_users.Find(user);
+    if (!member)
         return;
-    delete this->_users[user];
-    this->_users.remove(user);
+    User *record = member->Record;
+    this->_users.Remove(user);
+    this->releaseUser(user, record);
+    this->MarkChanged("users");
 }
 
 void Channel::ChangeNick(const QString &old_nick, const QString &new_nick)
 {
-    User *user = this->GetUser(old_nick);
-    if (!user)
+    NickKey old_key = this->GetNickKey(old_nick);
+    ChannelMemberTable::Entry *member = this->_users.Find(old_key);
+    if (!member)
         return;
 
     //emit this->Event_NickChanged(old_nick, new_nick);
-    user->SetNick(new_nick);
-    this->_users.remove(old_nick.toLower());
-    this->_users.insert(new_nick.toLower(), user);
+    NickKey new_key = this->GetNickKey(new_nick);
+    User *record = member->Record;
+    quint64 modes = member->CUModes;
+    record->SetNick(new_nick);
+    this->_users.Remove(old_key);
+    this->_users.Insert(new_key, record, modes);
+    this->MarkChanged("users");
+    // Record is shared, so network index needs to be changed only by first channel that renames it
+    if (this->_shared && old_key != new_key && this->_net->userIndex.value(old_key) == record)
+    {
+        this->_net->userIndex.remove(old_key);
+        this->_net->userIndex.insert(new_key, record);
+    }
 }
 
 void Channel::ChangeHost(const QString &nick, const QString &new_host, const QString &new_ident)
@@ -104,7 +131,12 @@ void Channel::ChangeHost(const QString &nick, const QString &new_host, const QSt
 
 bool Channel::ContainsUser(const QString &user)
 {
-    return this->_users.contains(user.toLower());
+    return this->_users.Find(this->GetNickKey(user)) != nullptr;
+}
+
+bool Channel::ContainsUser(const NickKey &user)
+{
+    return this->_users.Find(user) != nullptr;
 }
 
 void Channel::LoadHash(const QHash<QString, QVariant> &hash)
@@ -115,21 +147,19 @@ void Channel::LoadHash(const QHash<QString, QVariant> &hash)
     {
         QList<QVariant> mode_list = hash["_localPModes"].toList();
         foreach (QVariant mode, mode_list)
-        {
-#ifdef LIBIRC_HASH
-            this->_localPModes.insert(ChannelPMode(mode.toHash()));
-#else
-            this->_localPModes.append(ChannelPMode(mode.toHash()));
-#endif
-        }
+            this->_localPModes.Insert(ChannelPMode(mode.toHash()));
     }
     if (hash.contains("localMode"))
         this->_localMode = CMode(hash["localMode"].toHash());
     if (hash.contains("users"))
     {
+        // Keys are created again from nicks, because they were lower case in older versions
         QHash<QString, QVariant> users_x = hash["users"].toHash();
-        foreach (QString user, users_x.keys())
-            this->_users.insert(user, new User(users_x[user].toHash()));
+        foreach (QVariant user, users_x.values())
+        {
+            User ux(user.toHash());
+            this->InsertUser(&ux);
+        }
     }
 }
 
@@ -141,18 +171,80 @@ QHash<QString, QVariant> Channel::ToHash()
     // We don't prefix some of the variables here because they weren't prefixed in previous
     // versions
     hash.insert("localMode", QVariant(this->_localMode.ToHash()));
-    if (!this->_localPModes.isEmpty())
+    if (!this->_localPModes.IsEmpty())
+        hash.insert("_localPModes", this->pModesToVariant());
+    hash.insert("users", this->usersToVariant());
+    return hash;
+}
+
+QHash<QString, QVariant> Channel::ToDelta(quint64 since_generation)
+{
+    if (this->GetCreatedGeneration() > since_generation)
+        return this->ToHash();
+    QHash<QString, QVariant> delta;
+    QList<QString> fields = this->GetChangedFields(since_generation);
+    bool pmodes_changed = fields.removeAll("_localPModes") > 0;
+    bool users_changed = fields.removeAll("users") > 0;
+    if (!fields.isEmpty())
     {
-        QList<QVariant> mode_list;
-        foreach (ChannelPMode xx, this->_localPModes)
-            mode_list.append(QVariant(xx.ToHash()));
-        hash.insert("_localPModes", QVariant(mode_list));
+        QHash<QString, QVariant> hash = libirc::Channel::ToHash();
+        SERIALIZE(_localModeDateTime);
+        foreach (QString field, fields)
+            delta.insert(field, hash.value(field));
     }
-    QHash<QString, QVariant> users_l;
-    foreach (QString user, this->_users.keys())
-        users_l.insert(user, this->_users[user]->ToHash());
-    hash.insert("users", QVariant(users_l));
-    return hash;
+    if (this->_localMode.GetGeneration() > since_generation)
+        delta.insert("localMode", QVariant(this->_localMode.ToHash()));
+    if (pmodes_changed)
+        delta.insert("_localPModes", this->pModesToVariant());
+    // User records are shared with other channels and change on their own, for example when user goes away
+    for (int slot = 0; !users_changed && slot < this->_users.Capacity(); slot++)
+    {
+        const ChannelMemberTable::Entry *member = this->_users.At(slot);
+        users_changed = member && member->Record->GetGeneration() > since_generation;
+    }
+    if (users_changed)
+        delta.insert("users", this->usersToVariant());
+    return delta;
+}
+
+void Channel::ApplyDelta(const QHash<QString, QVariant> &delta)
+{
+    // LoadHash() only inserts users and modes, lists in delta are complete
+    if (delta.contains("_localPModes"))
+        this->_localPModes.Clear();
+    if (delta.contains("users"))
+        this->ClearUsers();
+    this->LoadHash(delta);
+}
+
+void Channel::writeBinaryFields(libirc::BinaryWriter &writer)
+{
+    // Same fields as ToHash(), but written directly, so that no temporary hashes are created for users and modes
+    libirc::Channel::writeBinaryFields(writer);
+    SERIALIZE_BINARY(_localModeDateTime);
+    writer.WriteField("localMode");
+    this->_localMode.ToBinary(writer);
+    if (!this->_localPModes.IsEmpty())
+    {
+        QList<ChannelPMode> modes = this->_localPModes.GetAll();
+        writer.WriteField("_localPModes");
+        writer.BeginList(modes.size());
+        for (int i = 0; i < modes.size(); i++)
+            modes[i].ToBinary(writer);
+    }
+    writer.WriteField("users");
+    writer.BeginObject();
+    for (int slot = 0; slot < this->_users.Capacity(); slot++)
+    {
+        const ChannelMemberTable::Entry *member = this->_users.At(slot);
+        if (!member)
+            continue;
+        writer.WriteField(member->Key.GetFolded());
+        writer.BeginObject();
+        member->Record->writeMemberFields(writer, this->cuModesToList(member->CUModes), this->cuPrefixesToList(member->CUModes));
+        writer.EndObject();
+    }
+    writer.EndObject();
 }
 
 void Channel::SendMessage(QString text)
@@ -165,31 +257,175 @@ void Channel::SendMessage(QString text)
 void Channel::SetNetwork(Network *network)
 {
     this->_net = network;
+    // Network may use different case mapping than the default one
+    this->UpdateUserKeys();
 }
 
 void Channel::ClearUsers()
 {
-    qDeleteAll(this->_users);
-    this->_users.clear();
+    ChannelMemberTable users = this->_users;
+    this->_users.Clear();
+    this->MarkChanged("users");
+    for (int slot = 0; slot < users.Capacity(); slot++)
+    {
+        const ChannelMemberTable::Entry *member = users.At(slot);
+        if (member)
+            this->releaseUser(member->Key, member->Record);
+    }
 }
 
 QHash<QString, User *> Channel::GetUsers() const
 {
-    return this->_users;
+    QHash<QString, User *> users;
+    users.reserve(this->_users.Size());
+    for (int slot = 0; slot < this->_users.Capacity(); slot++)
+    {
+        const ChannelMemberTable::Entry *member = this->_users.At(slot);
+        if (member)
+            users.insert(member->Key.GetFolded(), member->Record);
+    }
+    return users;
+}
+
+int Channel::GetUserSlotCount() const
+{
+    return this->_users.Capacity();
+}
+
+User *Channel::GetUserAt(int slot) const
+{
+    const ChannelMemberTable::Entry *member = this->_users.At(slot);
+    if (!member)
+        return nullptr;
+    return member->Record;
 }
 
 int Channel::GetUserCount()
 {
-    return this->_users.count();
+    return this->_users.Size();
+}
+
+qint64 Channel::GetMembershipMemoryUsage() const
+{
+    return this->_users.GetMemoryUsage();
 }
 
 User *Channel::GetUser(QString user)
 {
-    user = user.toLower();
-    if (this->_users.contains(user))
-        return this->_users[user];
+    return this->GetUser(this->GetNickKey(user));
+}
+
+User *Channel::GetUser(const NickKey &user) const
+{
+    const ChannelMemberTable::Entry *member = this->_users.Find(user);
+    if (!member)
+        return nullptr;
+    return member->Record;
+}
+
+QList<char> Channel::GetUserCUModes(const QString &user) const
+{
+    return this->GetUserCUModes(this->GetNickKey(user));
+}
+
+QList<char> Channel::GetUserCUModes(const NickKey &user) const
+{
+    const ChannelMemberTable::Entry *member = this->_users.Find(user);
+    if (!member)
+        return QList<char>();
+    return this->cuModesToList(member->CUModes);
+}
+
+QList<char> Channel::GetUserPrefixes(const QString &user) const
+{
+    return this->GetUserPrefixes(this->GetNickKey(user));
+}
+
+QList<char> Channel::GetUserPrefixes(const NickKey &user) const
+{
+    const ChannelMemberTable::Entry *member = this->_users.Find(user);
+    if (!member)
+        return QList<char>();
+    return this->cuPrefixesToList(member->CUModes);
+}
+
+char Channel::GetHighestCUMode(const QString &user) const
+{
+    return this->GetHighestCUMode(this->GetNickKey(user));
+}
+
+char Channel::GetHighestCUMode(const NickKey &user) const
+{
+    const ChannelMemberTable::Entry *member = this->_users.Find(user);
+    if (!member || !member->CUModes)
+        return 0;
+    quint64 modes = member->CUModes;
+    // Network keeps the modes sorted from highest to lowest
+    const libirc::RankedModeSet &cumodes = this->networkCUModes();
+    for (int rank = 0; rank < cumodes.Count(); rank++)
+    {
+        int bit = cuModeBit(cumodes.At(rank));
+        if (bit >= 0 && (modes & (Q_UINT64_C(1) << bit)))
+            return cumodes.At(rank);
+    }
+    return 0;
+}
+
+QString Channel::GetPrefixedNick(const QString &user) const
+{
+    return this->GetPrefixedNick(this->GetNickKey(user));
+}
 
-    return nullptr;
+QString Channel::GetPrefixedNick(const NickKey &user) const
+{
+    User *record = this->GetUser(user);
+    if (!record)
+        return QString();
+    QList<char> prefixes = this->GetUserPrefixes(user);
+    if (prefixes.isEmpty())
+        return record->GetNick();
+    return QChar(prefixes[0]) + record->GetNick();
+}
+
+bool Channel::SetUserCUMode(const NickKey &user, char mode, bool set)
+{
+    int bit = cuModeBit(mode);
+    if (bit < 0)
+        return false;
+    ChannelMemberTable::Entry *member = this->_users.Find(user);
+    if (!member)
+        return false;
+    quint64 modes = member->CUModes;
+    if (set)
+        modes |= Q_UINT64_C(1) << bit;
+    else
+        modes &= ~(Q_UINT64_C(1) << bit);
+    if (modes == member->CUModes)
+        return false;
+    member->CUModes = modes;
+    this->MarkChanged("users");
+    return true;
+}
+
+NickKey Channel::GetNickKey(const QString &nick) const
+{
+    if (!this->_net)
+        return NickKey(nick, CaseMappingRFC1459);
+    return this->_net->GetNickKey(nick);
+}
+
+void Channel::UpdateUserKeys()
+{
+    this->_localPModes.SetCaseMapping(this->_net ? this->_net->GetCaseMapping() : CaseMappingRFC1459);
+    ChannelMemberTable users;
+    users.Reserve(this->_users.Size());
+    for (int slot = 0; slot < this->_users.Capacity(); slot++)
+    {
+        const ChannelMemberTable::Entry *member = this->_users.At(slot);
+        if (member)
+            users.Insert(this->GetNickKey(member->Record->GetNick()), member->Record, member->CUModes);
+    }
+    this->_users = users;
 }
 
 QDateTime Channel::GetMTime()
@@ -199,7 +435,7 @@ QDateTime Channel::GetMTime()
 
 void Channel::SetMTime(QDateTime tm)
 {
-    this->_localModeDateTime = tm;
+    SERIALIZED_SET(_localModeDateTime, tm);
 }
 
 QList<ChannelPMode> Channel::GetBans()
@@ -212,66 +448,47 @@ QList<ChannelPMode> Channel::GetExceptions()
     return this->filteredList('e');
 }
 
+QList<ChannelPMode> Channel::GetPModes(char mode)
+{
+    return this->filteredList(mode);
+}
+
+QString Channel::MatchPMode(char mode, const QString &nick, const QString &ident, const QString &host) const
+{
+    return this->_localPModes.Match(mode, nick, ident, host);
+}
+
+QString Channel::MatchBan(const QString &nick, const QString &ident, const QString &host) const
+{
+    QString ban = this->_localPModes.Match('b', nick, ident, host);
+    if (ban.isNull() || !this->_localPModes.Match('e', nick, ident, host).isNull())
+        return QString();
+    return ban;
+}
+
 bool Channel::RemovePMode(libirc::SingleMode mode)
 {
-    int ix = 0;
-    foreach (ChannelPMode mode_, this->_localPModes)
-    {
-        if (mode_.Get() == mode.Get() && mode_.Parameter == mode.Parameter)
-        {
-#ifdef LIBIRC_HASH
-            this->_localPModes.remove(mode_);
-#else
-            this->_localPModes.removeAt(ix);
-#endif
-            return true;
-        }
-        ix++;
-    }
-    return false;
+    if (!this->_localPModes.Remove(mode.Get(), mode.Parameter))
+        return false;
+    this->MarkChanged("_localPModes");
+    return true;
 }
 
 bool Channel::RemovePMode(ChannelPMode mode)
 {
-#ifdef LIBIRC_HASH
-    if (this->_localPModes.contains(mode))
-    {
-        this->_localPModes.remove(mode);
-        return true;
-    }
-    return false;
-#else
-    int ix = 0;
-    foreach (ChannelPMode mode_, this->_localPModes)
-    {
-        if (mode_.Get() == mode.Get() && mode_.Parameter == mode.Parameter)
-        {
-            this->_localPModes.removeAt(ix);
-            return true;
-        }
-        ix++;
-    }
-    return false;
-#endif
+    if (!this->_localPModes.Remove(mode.Get(), mode.Parameter))
+        return false;
+    this->MarkChanged("_localPModes");
+    return true;
 }
 
 bool Channel::SetPMode(ChannelPMode mode)
 {
-#ifdef LIBIRC_HASH
-    if (this->_localPModes.contains(mode))
-        return false;
-    this->_localPModes.insert(mode);
-    return true;
-#else
     // If there is already same mode set, we skip
-    foreach (ChannelPMode mode_, this->_localPModes)
-    {
-        if (mode_.Get() == mode.Get() && mode_.Parameter == mode.Parameter)
-            return false;
-    }
-    this->_localPModes.append(mode);
+    if (!this->_localPModes.Insert(mode))
+        return false;
+    this->MarkChanged("_localPModes");
     return true;
-#endif
 }
 
 CMode Channel::GetMode()
@@ -292,13 +509,7 @@ void Channel::Part()
 
 QList<ChannelPMode> Channel::filteredList(char filter)
 {
-    QList<ChannelPMode> result;
-    foreach(ChannelPMode mode, this->_localPModes)
-    {
-        if (mode.Get() == filter)
-            result.append(mode);
-    }
-    return result;
+    return this->_localPModes.GetList(filter);
 }
 
 void Channel::deepCopy(const Channel *source)
@@ -310,9 +521,163 @@ void Channel::deepCopy(const Channel *source)
     this->_localModeDateTime = source->_localModeDateTime;
     this->_topicUser = source->_topicUser;
     this->_localMode = source->_localMode;
-    foreach (QString user, source->_users.keys())
-        this->_users.insert(user, new User(source->_users[user]));
+    // Copy of channel is never shared with network, so it gets its own user records
+    this->_shared = false;
+    this->_users.Reserve(source->_users.Size());
+    for (int slot = 0; slot < source->_users.Capacity(); slot++)
+    {
+        const ChannelMemberTable::Entry *member = source->_users.At(slot);
+        if (!member)
+            continue;
+        User *record = new User(member->Record);
+        record->channels.append(this);
+        this->_users.Insert(member->Key, record, member->CUModes);
+    }
     // Modes
     this->_localPModes = source->_localPModes;
 }
 
+User *Channel::acquireUser(const NickKey &key, User *source)
+{
+    User *record = nullptr;
+    if (this->_shared)
+        record = this->_net->userIndex.value(key, nullptr);
+    if (record)
+    {
+        record->UpdateFrom(source);
+    } else
+    {
+        record = new User(source);
+        // Channel specific information is never stored in record
+        record->CUModes.clear();
+        record->ChannelPrefixes.clear();
+        if (this->_shared)
+            this->_net->userIndex.insert(key, record);
+    }
+    record->channels.append(this);
+    return record;
+}
+
+void Channel::releaseUser(const NickKey &key, User *record)
+{
+    record->channels.removeOne(this);
+    if (!record->channels.isEmpty())
+        return;
+    if (this->_shared && this->_net->userIndex.value(key) == record)
+        this->_net->userIndex.remove(key);
+    delete record;
+}
+
+void Channel::shareUsers()
+{
+    if (this->_shared || !this->_net)
+        return;
+    this->_shared = true;
+    // Replace our own records with these that network already has for other channels
+    for (int slot = 0; slot < this->_users.Capacity(); slot++)
+    {
+        ChannelMemberTable::Entry *member = this->_users.At(slot);
+        if (!member)
+            continue;
+        User *own = member->Record;
+        User *record = this->_net->userIndex.value(member->Key, nullptr);
+        if (!record)
+        {
+            this->_net->userIndex.insert(member->Key, own);
+            continue;
+        }
+        if (record == own)
+            continue;
+        record->UpdateFrom(own);
+        record->channels.append(this);
+        member->Record = record;
+        own->channels.removeOne(this);
+        if (own->channels.isEmpty())
+            delete own;
+    }
+}
+
+quint64 Channel::cuModesFromList(const QList<char> &modes) const
+{
+    quint64 result = 0;
+    foreach (char mode, modes)
+    {
+        int bit = cuModeBit(mode);
+        if (bit >= 0)
+            result |= Q_UINT64_C(1) << bit;
+    }
+    return result;
+}
+
+QVariant Channel::pModesToVariant() const
+{
+    QList<QVariant> mode_list;
+    foreach (ChannelPMode xx, this->_localPModes.GetAll())
+        mode_list.append(QVariant(xx.ToHash()));
+    return QVariant(mode_list);
+}
+
+QVariant Channel::usersToVariant() const
+{
+    // Channel user modes are stored together with the user, same as in older versions where every channel had its own users
+    QHash<QString, QVariant> users_l;
+    for (int slot = 0; slot < this->_users.Capacity(); slot++)
+    {
+        const ChannelMemberTable::Entry *member = this->_users.At(slot);
+        if (!member)
+            continue;
+        User user(member->Record);
+        user.CUModes = this->cuModesToList(member->CUModes);
+        user.ChannelPrefixes = this->GetUserPrefixes(member->Key);
+        users_l.insert(member->Key.GetFolded(), user.ToHash());
+    }
+    return QVariant(users_l);
+}
+
+QList<char> Channel::cuModesToList(quint64 modes) const
+{
+    QList<char> result;
+    if (!modes)
+        return result;
+    const libirc::RankedModeSet &cumodes = this->networkCUModes();
+    for (int rank = 0; rank < cumodes.Count(); rank++)
+    {
+        int bit = cuModeBit(cumodes.At(rank));
+        if (bit >= 0 && (modes & (Q_UINT64_C(1) << bit)))
+            result.append(cumodes.At(rank));
+    }
+    return result;
+}
+
+QList<char> Channel::cuPrefixesToList(quint64 modes) const
+{
+    QList<char> result;
+    if (!modes)
+        return result;
+    const libirc::RankedModeSet &cumodes = this->networkCUModes();
+    const libirc::RankedModeSet &prefixes = this->networkPrefixes();
+    for (int rank = 0; rank < cumodes.Count() && rank < prefixes.Count(); rank++)
+    {
+        int bit = cuModeBit(cumodes.At(rank));
+        if (bit >= 0 && (modes & (Q_UINT64_C(1) << bit)))
+            result.append(prefixes.At(rank));
+    }
+    return result;
+}
+
+const libirc::RankedModeSet &Channel::networkCUModes() const
+{
+    static const libirc::RankedModeSet modes(QList<char>() << 'q' << 'a' << 'o' << 'h' << 'v');
+    if (this->_net)
+        return this->_net->CUModes;
+    return modes;
+}
+
+const libirc::RankedModeSet &Channel::networkPrefixes() const
+{
+    static const libirc::RankedModeSet prefixes(QList<char>() << '~' << '&' << '@' << '%' << '+');
+    if (this->_net)
+        return this->_net->channelUserPrefixes;
+    return prefixes;
+}
+
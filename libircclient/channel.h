@@ -13,16 +13,14 @@
 #ifndef CHANNEL_H
 #define CHANNEL_H
 
-// This feature is extremely experimental and known to be bugged due to some internal bugs in Qt
-#ifdef LIBIRC_HASH
-#undef LIBIRC_HASH
-#endif
-
 #include "libircclient_global.h"
 #include <QString>
 #include <QSet>
 #include <QList>
 #include "mode.h"
+#include "casemapping.h"
+#include "channelmembertable.h"
+#include "channelpmodetable.h"
 #include "../libirc/channel.h"
 
 namespace libircclient
@@ -40,26 +38,70 @@ namespace libircclient
             /*!
              * \brief InsertUser Use this to insert a new user to channel, if user already exists it's updated according to information for new user
              * \param user Pointer to user object, this function creates a copy, so the object passed here can be temporary
-             * \return Pointer to newly created user or existing user in case there is already this user in a channel
+             * \param cu_modes Channel user modes of the user in this channel (such as o or v), they replace modes the user had
+             * \return Pointer to user record, for channels that belong to network this record is shared with other channels
+             *         the user is in, so it doesn't hold any channel specific information, use GetUserCUModes() for these
              */
+            User *InsertUser(User *user, const QList<char> &cu_modes);
+            //! Inserts user with channel user modes that were loaded together with it (see ToHash() of channel),
+            //! users created by hand have none
             User *InsertUser(User *user);
             void RemoveUser(QString user);
+            void RemoveUser(const NickKey &user);
             void ChangeNick(const QString &old_nick, const QString &new_nick);
             //! Changes a hostname or ident of user in channel
             void ChangeHost(const QString &nick, const QString &new_host, const QString &new_ident);
             bool ContainsUser(const QString &user);
+            bool ContainsUser(const NickKey &user);
             void LoadHash(const QHash<QString, QVariant> &hash) override;
             QHash<QString, QVariant> ToHash() override;
+            //! Users are included when membership changed or when any of their records changed
+            QHash<QString, QVariant> ToDelta(quint64 since_generation) override;
+            //! Users and list modes in delta replace current ones
+            void ApplyDelta(const QHash<QString, QVariant> &delta) override;
             void SendMessage(QString text);
             void SetNetwork(Network *network);
             void ClearUsers();
+            //! Returns users of this channel, keys are nicknames folded by case mapping of network
+            //! This builds a new hash on every call, so it's O(n), use GetUserSlotCount() and GetUserAt() to iterate users
             QHash<QString, User *> GetUsers() const;
+            //! Returns number of slots for GetUserAt(), some of them are empty, so it's not the same as GetUserCount()
+            int GetUserSlotCount() const;
+            //! Returns user in this slot or nullptr if slot is empty
+            User *GetUserAt(int slot) const;
             int GetUserCount();
+            //! Returns number of bytes used to store membership of users in this channel (without the user records)
+            qint64 GetMembershipMemoryUsage() const;
             User *GetUser(QString user);
+            User *GetUser(const NickKey &user) const;
+            //! Returns channel user modes (such as o or v) of user, sorted from highest to lowest
+            QList<char> GetUserCUModes(const QString &user) const;
+            QList<char> GetUserCUModes(const NickKey &user) const;
+            //! Returns symbols of channel user modes (such as @ or +) of user, sorted from highest to lowest
+            QList<char> GetUserPrefixes(const QString &user) const;
+            QList<char> GetUserPrefixes(const NickKey &user) const;
+            //! Returns highest channel user mode of user or 0 if user has none
+            char GetHighestCUMode(const QString &user) const;
+            char GetHighestCUMode(const NickKey &user) const;
+            //! Returns nick prefixed with symbol of highest channel user mode, for example @nick
+            QString GetPrefixedNick(const QString &user) const;
+            QString GetPrefixedNick(const NickKey &user) const;
+            //! Gives or takes channel user mode, returns false if user is not in channel or already was in that state
+            bool SetUserCUMode(const NickKey &user, char mode, bool set);
+            //! Creates a key for nick using case mapping of network this channel belongs to
+            NickKey GetNickKey(const QString &nick) const;
+            //! Needs to be called when case mapping of network changes, so that users can be found again
+            void UpdateUserKeys();
             QDateTime GetMTime();
             void SetMTime(QDateTime tm);
             QList<ChannelPMode> GetBans();
             QList<ChannelPMode> GetExceptions();
+            //! Returns all list modes of this letter (for example I for invites), in order they were set in
+            QList<ChannelPMode> GetPModes(char mode);
+            //! Returns mask of list mode of this letter that matches the user, or null string if there is none
+            QString MatchPMode(char mode, const QString &nick, const QString &ident, const QString &host) const;
+            //! Returns mask of ban that matches the user, or null string if user isn't banned or matches an exception
+            QString MatchBan(const QString &nick, const QString &ident, const QString &host) const;
             bool RemovePMode(libirc::SingleMode mode);
             bool RemovePMode(ChannelPMode mode);
             bool SetPMode(ChannelPMode mode);
@@ -71,18 +113,33 @@ namespace libircclient
             void Event_UserRemoved(QString user);
             void Event_NickChanged(QString old_nick, QString new_nick); */
         protected:
+            void writeBinaryFields(libirc::BinaryWriter &writer) override;
             QList<ChannelPMode> filteredList(char filter);
-#ifdef LIBIRC_HASH
-            QSet<ChannelPMode> _localPModes;
-#else
-            QList<ChannelPMode> _localPModes;
-#endif
+            ChannelPModeTable _localPModes;
             CMode _localMode;
             QDateTime _localModeDateTime;
-            QHash<QString, User*> _users;
+            //! Membership of users in this channel, the user records may be shared with other channels
+            ChannelMemberTable _users;
             Network *_net;
+            //! True if user records are shared with other channels of network, this is only the case for channels that
+            //! network has in its own list, copies of these channels always have their own records
+            bool _shared;
         private:
+            friend class Network;
             void deepCopy(const Channel *source);
+            //! Returns user record for this key, it's either created or taken from network if it's already there
+            User *acquireUser(const NickKey &key, User *source);
+            //! Removes this channel from user record and deletes it, if it's not in any other channel
+            void releaseUser(const NickKey &key, User *record);
+            //! Starts sharing user records with other channels of network, called when network adds the channel to its list
+            void shareUsers();
+            QVariant pModesToVariant() const;
+            QVariant usersToVariant() const;
+            quint64 cuModesFromList(const QList<char> &modes) const;
+            QList<char> cuModesToList(quint64 modes) const;
+            QList<char> cuPrefixesToList(quint64 modes) const;
+            const libirc::RankedModeSet &networkCUModes() const;
+            const libirc::RankedModeSet &networkPrefixes() const;
     };
 }
 
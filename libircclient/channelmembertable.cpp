@@ -0,0 +1,155 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "channelmembertable.h"
+
+using namespace libircclient;
+
+//! Size of table that is allocated when first member is inserted, it must be a power of 2
+#define CHANNELMEMBERTABLE_MIN_CAPACITY 8
+
+ChannelMemberTable::ChannelMemberTable()
+{
+    this->count = 0;
+    this->mask = -1;
+}
+
+ChannelMemberTable::Entry *ChannelMemberTable::Find(const NickKey &key)
+{
+    int slot = this->findSlot(key);
+    if (slot < 0 || !this->entries[slot].Record)
+        return nullptr;
+    return &this->entries[slot];
+}
+
+const ChannelMemberTable::Entry *ChannelMemberTable::Find(const NickKey &key) const
+{
+    int slot = this->findSlot(key);
+    if (slot < 0 || !this->entries[slot].Record)
+        return nullptr;
+    return &this->entries[slot];
+}
+
+ChannelMemberTable::Entry *ChannelMemberTable::Insert(const NickKey &key, User *record, quint64 cu_modes)
+{
+    // Table is never more than 3/4 full, so that probe sequences stay short
+    if ((this->count + 1) * 4 > this->entries.size() * 3)
+        this->rehash(qMax(CHANNELMEMBERTABLE_MIN_CAPACITY, this->Capacity() * 2));
+    int slot = this->findSlot(key);
+    Entry &entry = this->entries[slot];
+    if (!entry.Record)
+    {
+        entry.Key = key;
+        this->count++;
+    }
+    entry.Record = record;
+    entry.CUModes = cu_modes;
+    return &entry;
+}
+
+bool ChannelMemberTable::Remove(const NickKey &key)
+{
+    int slot = this->findSlot(key);
+    if (slot < 0 || !this->entries[slot].Record)
+        return false;
+    // Move following entries of same probe sequence back, so that lookups don't stop at the hole
+    int hole = slot;
+    int next = slot;
+    while (true)
+    {
+        next = (next + 1) & this->mask;
+        Entry &entry = this->entries[next];
+        if (!entry.Record)
+            break;
+        int ideal = static_cast<int>(entry.Key.GetHash() & static_cast<uint>(this->mask));
+        // Entry can be moved to hole only if hole lies between its ideal slot and its current slot
+        bool movable = (hole <= next) ? (ideal <= hole || ideal > next) : (ideal <= hole && ideal > next);
+        if (movable)
+        {
+            this->entries[hole] = entry;
+            hole = next;
+        }
+    }
+    this->entries[hole] = Entry();
+    this->count--;
+    return true;
+}
+
+void ChannelMemberTable::Clear()
+{
+    this->entries.clear();
+    this->count = 0;
+    this->mask = -1;
+}
+
+void ChannelMemberTable::Reserve(int size)
+{
+    int capacity = CHANNELMEMBERTABLE_MIN_CAPACITY;
+    while (capacity * 3 < size * 4)
+        capacity *= 2;
+    if (capacity > this->Capacity())
+        this->rehash(capacity);
+}
+
+int ChannelMemberTable::Size() const
+{
+    return this->count;
+}
+
+int ChannelMemberTable::Capacity() const
+{
+    return this->entries.size();
+}
+
+ChannelMemberTable::Entry *ChannelMemberTable::At(int slot)
+{
+    if (!this->entries[slot].Record)
+        return nullptr;
+    return &this->entries[slot];
+}
+
+const ChannelMemberTable::Entry *ChannelMemberTable::At(int slot) const
+{
+    if (!this->entries[slot].Record)
+        return nullptr;
+    return &this->entries[slot];
+}
+
+qint64 ChannelMemberTable::GetMemoryUsage() const
+{
+    return static_cast<qint64>(sizeof(ChannelMemberTable)) + static_cast<qint64>(this->entries.capacity()) * static_cast<qint64>(sizeof(Entry));
+}
+
+int ChannelMemberTable::findSlot(const NickKey &key) const
+{
+    if (this->entries.isEmpty())
+        return -1;
+    // Capacity is power of 2 and there is always at least one empty slot, so this loop always ends
+    int slot = static_cast<int>(key.GetHash() & static_cast<uint>(this->mask));
+    while (this->entries[slot].Record && this->entries[slot].Key != key)
+        slot = (slot + 1) & this->mask;
+    return slot;
+}
+
+void ChannelMemberTable::rehash(int capacity)
+{
+    QVector<Entry> old = this->entries;
+    this->entries = QVector<Entry>(capacity);
+    this->mask = capacity - 1;
+    this->count = 0;
+    for (int i = 0; i < old.size(); i++)
+    {
+        const Entry &entry = old.at(i);
+        if (entry.Record)
+            this->Insert(entry.Key, entry.Record, entry.CUModes);
+    }
+}
@@ -0,0 +1,71 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef CHANNELMEMBERTABLE_H
+#define CHANNELMEMBERTABLE_H
+
+#include <QVector>
+#include "libircclient_global.h"
+#include "casemapping.h"
+
+namespace libircclient
+{
+    class User;
+
+    /*!
+     * \brief The ChannelMemberTable class stores users of a single channel
+     *
+     * It's an open addressing hash table with linear probing, every member is one entry in single flat array,
+     * so there is no allocation per member and lookup touches only few neighbouring entries. Removal shifts
+     * following entries back, so there are no tombstones and table doesn't degrade with JOIN / PART churn.
+     * Empty slots have no Record.
+     */
+    class LIBIRCCLIENTSHARED_EXPORT ChannelMemberTable
+    {
+        public:
+            struct Entry
+            {
+                NickKey Key;
+                //! Shared user data, nullptr for empty slot
+                User *Record = nullptr;
+                //! One bit for every channel user mode letter
+                quint64 CUModes = 0;
+            };
+
+            ChannelMemberTable();
+            Entry *Find(const NickKey &key);
+            const Entry *Find(const NickKey &key) const;
+            //! Inserts a member, if there is already member with same key it's overwritten, record must not be nullptr
+            Entry *Insert(const NickKey &key, User *record, quint64 cu_modes);
+            bool Remove(const NickKey &key);
+            void Clear();
+            //! Makes sure that table can hold this many members without growing
+            void Reserve(int size);
+            int Size() const;
+            //! Number of slots, members can be iterated using At() with indices from 0 to capacity
+            int Capacity() const;
+            //! Returns entry in slot or nullptr if the slot is empty
+            Entry *At(int slot);
+            const Entry *At(int slot) const;
+            //! Number of bytes used by the table itself, strings of keys are shared with user records in most cases
+            qint64 GetMemoryUsage() const;
+
+        private:
+            int findSlot(const NickKey &key) const;
+            void rehash(int capacity);
+            QVector<Entry> entries;
+            int count;
+            int mask;
+    };
+}
+
+#endif // CHANNELMEMBERTABLE_H
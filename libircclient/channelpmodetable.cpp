@@ -0,0 +1,151 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "channelpmodetable.h"
+
+using namespace libircclient;
+
+bool ChannelPModeTable::Insert(const ChannelPMode &mode)
+{
+    QHash<char, Letter>::iterator letter = this->letters.find(mode.Get());
+    if (letter == this->letters.end())
+    {
+        letter = this->letters.insert(mode.Get(), Letter());
+        letter.value().Matcher.SetCaseMapping(this->caseMapping);
+    } else if (letter.value().Index.contains(mode.Parameter))
+    {
+        return false;
+    }
+    letter.value().Index.insert(mode.Parameter, letter.value().Slots.size());
+    letter.value().Slots.append(Slot(mode));
+    letter.value().Matcher.Insert(mode.Parameter);
+    return true;
+}
+
+bool ChannelPModeTable::Remove(char mode, const QString &parameter)
+{
+    QHash<char, Letter>::iterator letter = this->letters.find(mode);
+    if (letter == this->letters.end())
+        return false;
+    QHash<QString, int>::iterator position = letter.value().Index.find(parameter);
+    if (position == letter.value().Index.end())
+        return false;
+    int slot = position.value();
+    letter.value().Index.erase(position);
+    letter.value().Matcher.Remove(parameter);
+    if (letter.value().Index.isEmpty())
+    {
+        this->letters.erase(letter);
+        return true;
+    }
+    letter.value().Slots[slot].Removed = true;
+    letter.value().Holes++;
+    // Holes at the end can be dropped right away
+    while (letter.value().Slots.last().Removed)
+    {
+        letter.value().Slots.removeLast();
+        letter.value().Holes--;
+    }
+    if (letter.value().Holes > letter.value().Index.size())
+        compact(letter.value());
+    return true;
+}
+
+bool ChannelPModeTable::Contains(char mode, const QString &parameter) const
+{
+    QHash<char, Letter>::const_iterator letter = this->letters.constFind(mode);
+    if (letter == this->letters.constEnd())
+        return false;
+    return letter.value().Index.contains(parameter);
+}
+
+QList<ChannelPMode> ChannelPModeTable::GetList(char mode) const
+{
+    QList<ChannelPMode> result;
+    QHash<char, Letter>::const_iterator letter = this->letters.constFind(mode);
+    if (letter == this->letters.constEnd())
+        return result;
+    result.reserve(letter.value().Index.size());
+    foreach (const Slot &slot, letter.value().Slots)
+    {
+        if (!slot.Removed)
+            result.append(slot.Mode);
+    }
+    return result;
+}
+
+QList<ChannelPMode> ChannelPModeTable::GetAll() const
+{
+    QList<ChannelPMode> result;
+    result.reserve(this->Count());
+    QHash<char, Letter>::const_iterator letter = this->letters.constBegin();
+    for (; letter != this->letters.constEnd(); ++letter)
+        result.append(this->GetList(letter.key()));
+    return result;
+}
+
+int ChannelPModeTable::Count() const
+{
+    int count = 0;
+    foreach (const Letter &letter, this->letters)
+        count += letter.Index.size();
+    return count;
+}
+
+int ChannelPModeTable::Count(char mode) const
+{
+    QHash<char, Letter>::const_iterator letter = this->letters.constFind(mode);
+    if (letter == this->letters.constEnd())
+        return 0;
+    return letter.value().Index.size();
+}
+
+bool ChannelPModeTable::IsEmpty() const
+{
+    return this->letters.isEmpty();
+}
+
+void ChannelPModeTable::Clear()
+{
+    this->letters.clear();
+}
+
+QString ChannelPModeTable::Match(char mode, const QString &nick, const QString &ident, const QString &host) const
+{
+    QHash<char, Letter>::const_iterator letter = this->letters.constFind(mode);
+    if (letter == this->letters.constEnd())
+        return QString();
+    return letter.value().Matcher.Match(nick, ident, host);
+}
+
+void ChannelPModeTable::SetCaseMapping(CaseMapping mapping)
+{
+    this->caseMapping = mapping;
+    QHash<char, Letter>::iterator letter = this->letters.begin();
+    for (; letter != this->letters.end(); ++letter)
+        letter.value().Matcher.SetCaseMapping(mapping);
+}
+
+void ChannelPModeTable::compact(Letter &letter)
+{
+    QList<Slot> compacted;
+    compacted.reserve(letter.Index.size());
+    foreach (const Slot &slot, letter.Slots)
+    {
+        if (slot.Removed)
+            continue;
+        letter.Index[slot.Mode.Parameter] = compacted.size();
+        compacted.append(slot);
+    }
+    letter.Slots = compacted;
+    letter.Holes = 0;
+}
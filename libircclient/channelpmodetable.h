@@ -0,0 +1,74 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef CHANNELPMODETABLE_H
+#define CHANNELPMODETABLE_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include "libircclient_global.h"
+#include "mode.h"
+#include "maskmatcher.h"
+
+namespace libircclient
+{
+    /*!
+     * \brief The ChannelPModeTable class stores list modes of a channel (bans, exceptions, invites...)
+     *
+     * Every mode letter has its own list, which keeps the modes in order they were set in, and index of parameters,
+     * so that adding, removing and looking up a mode is constant time and listing of one letter doesn't touch others.
+     * Removed modes leave a hole in the list, the list is compacted once there are more holes than modes.
+     *
+     * Parameters of each letter are also compiled to a MaskMatcher, so that it's cheap to tell which ban matches a user.
+     */
+    class LIBIRCCLIENTSHARED_EXPORT ChannelPModeTable
+    {
+        public:
+            //! Inserts a mode, returns false if there already is a mode with same letter and parameter
+            bool Insert(const ChannelPMode &mode);
+            bool Remove(char mode, const QString &parameter);
+            bool Contains(char mode, const QString &parameter) const;
+            //! Returns all modes of this letter in order they were set in
+            QList<ChannelPMode> GetList(char mode) const;
+            QList<ChannelPMode> GetAll() const;
+            int Count() const;
+            int Count(char mode) const;
+            bool IsEmpty() const;
+            void Clear();
+            //! Returns parameter of mode of this letter that matches the user, or null string if there is none
+            QString Match(char mode, const QString &nick, const QString &ident, const QString &host) const;
+            //! Case mapping that is used to match masks, it should be same as mapping of network
+            void SetCaseMapping(CaseMapping mapping);
+
+        private:
+            struct Slot
+            {
+                Slot(const ChannelPMode &mode) : Mode(mode), Removed(false) {}
+                ChannelPMode Mode;
+                bool Removed;
+            };
+            struct Letter
+            {
+                QList<Slot> Slots;
+                //! Position of each parameter in Slots
+                QHash<QString, int> Index;
+                int Holes = 0;
+                MaskMatcher Matcher;
+            };
+            static void compact(Letter &letter);
+            QHash<char, Letter> letters;
+            CaseMapping caseMapping = CaseMappingRFC1459;
+    };
+}
+
+#endif // CHANNELPMODETABLE_H
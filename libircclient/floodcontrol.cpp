@@ -0,0 +1,102 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "floodcontrol.h"
+
+using namespace libircclient;
+
+FloodControl FloodControl::GetProfile(const QString &ircd)
+{
+    // InspIRCd default connect class has threshold of 10 with command rate of 1 per second
+    if (ircd.startsWith("InspIRCd"))
+        return FloodControl(10, 1000);
+    // Ratbox derived servers (charybdis, ircd-seven, solanum) and hybrid let clients send a burst
+    // of few lines and then about one per second before they start to throttle them
+    if (ircd.startsWith("ircd-seven") || ircd.startsWith("solanum") || ircd.startsWith("charybdis") ||
+        ircd.startsWith("ircd-ratbox") || ircd.startsWith("hybrid"))
+        return FloodControl(5, 1000);
+    // Unreal and everything else, one line per 800 ms is the pace libircclient always used for all servers
+    return FloodControl();
+}
+
+FloodControl::FloodControl(int burst, int interval)
+{
+    this->burst = 1;
+    this->interval = 0;
+    this->budget = 0;
+    // Setters refill the budget, so the clock needs to run already
+    this->clock.start();
+    this->SetBurst(burst);
+    this->SetInterval(interval);
+    this->Reset();
+}
+
+int FloodControl::GetBurst() const
+{
+    return this->burst;
+}
+
+void FloodControl::SetBurst(int burst)
+{
+    if (burst < 1)
+        burst = 1;
+    this->burst = burst;
+    this->refill();
+}
+
+int FloodControl::GetInterval() const
+{
+    return this->interval;
+}
+
+void FloodControl::SetInterval(int interval)
+{
+    if (interval < 0)
+        interval = 0;
+    this->interval = interval;
+    this->refill();
+}
+
+void FloodControl::Reset()
+{
+    this->budget = static_cast<qint64>(this->burst) * this->interval;
+    this->clock.start();
+}
+
+bool FloodControl::TryConsume()
+{
+    if (this->interval == 0)
+        return true;
+    this->refill();
+    if (this->budget < this->interval)
+        return false;
+    this->budget -= this->interval;
+    return true;
+}
+
+int FloodControl::GetDelay()
+{
+    if (this->interval == 0)
+        return 0;
+    this->refill();
+    if (this->budget >= this->interval)
+        return 0;
+    return static_cast<int>(this->interval - this->budget);
+}
+
+void FloodControl::refill()
+{
+    qint64 maximum = static_cast<qint64>(this->burst) * this->interval;
+    this->budget += this->clock.restart();
+    if (this->budget > maximum)
+        this->budget = maximum;
+}
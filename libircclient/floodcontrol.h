@@ -0,0 +1,61 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef FLOODCONTROL_H
+#define FLOODCONTROL_H
+
+#include <QString>
+#include <QElapsedTimer>
+#include "libircclient_global.h"
+
+namespace libircclient
+{
+    /*!
+     * \brief The FloodControl class is a token bucket that decides when next line can be sent to server
+     *
+     * Bucket holds up to Burst lines, every line takes one and one is returned each Interval milliseconds.
+     * This lets client send short bursts (joining channels, pasting text) immediately, while long streams
+     * of data are still sent at rate that server tolerates. It's measured using monotonic clock, so
+     * changes of system time don't affect it.
+     */
+    class LIBIRCCLIENTSHARED_EXPORT FloodControl
+    {
+        public:
+            //! Returns settings that are known to work with given ircd (as reported in 004), falls back to
+            //! defaults if ircd is not known
+            static FloodControl GetProfile(const QString &ircd);
+
+            FloodControl(int burst = 5, int interval = 800);
+            int GetBurst() const;
+            //! Number of lines that can be sent at once before we need to wait
+            void SetBurst(int burst);
+            int GetInterval() const;
+            //! How many milliseconds it takes to get one more line to the bucket, 0 disables the flood control
+            void SetInterval(int interval);
+            //! Fills the bucket, this should be called when connection is established
+            void Reset();
+            //! Takes one line from bucket, returns false if bucket is empty and line needs to wait
+            bool TryConsume();
+            //! Returns number of milliseconds until next line can be sent, 0 if it can be sent now
+            int GetDelay();
+
+        private:
+            void refill();
+            int burst;
+            int interval;
+            //! Budget we have in milliseconds, each line costs one interval, it never exceeds burst * interval
+            qint64 budget;
+            QElapsedTimer clock;
+    };
+}
+
+#endif // FLOODCONTROL_H
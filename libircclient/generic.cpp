@@ -11,6 +11,10 @@
 // Copyright (c) Petr Bena 2015
 
 #include "generic.h"
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 QString libircclient::Generic::ErrorCode2String(QAbstractSocket::SocketError type)
 {
@@ -80,3 +84,32 @@ QList<QString> libircclient::Generic::UniqueMerge(QList<QString> a, QList<QStrin
     }
     return x;
 }
+
+bool libircclient::Generic::IsASCII(const char *data, int size)
+{
+    int position = 0;
+#ifdef __SSE2__
+    // Check 16 bytes at once, movemask collects the highest bit of each byte
+    while (position + 16 <= size)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+        if (_mm_movemask_epi8(chunk) != 0)
+            return false;
+        position += 16;
+    }
+#endif
+    while (position + 8 <= size)
+    {
+        quint64 chunk;
+        memcpy(&chunk, data + position, sizeof(chunk));
+        if (chunk & Q_UINT64_C(0x8080808080808080))
+            return false;
+        position += 8;
+    }
+    while (position < size)
+    {
+        if (static_cast<unsigned char>(data[position++]) & 0x80)
+            return false;
+    }
+    return true;
+}
@@ -25,6 +25,8 @@ namespace libircclient
         LIBIRCCLIENTSHARED_EXPORT QString ErrorCode2String(QAbstractSocket::SocketError type);
         //! Merge unique items in 2 lists
         LIBIRCCLIENTSHARED_EXPORT QList<QString> UniqueMerge(QList<QString> a, QList<QString> b);
+        //! Returns true if none of the bytes has the highest bit set, such data can be widened to QString directly
+        LIBIRCCLIENTSHARED_EXPORT bool IsASCII(const char *data, int size);
     }
 }
 
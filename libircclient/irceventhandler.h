@@ -13,17 +13,154 @@
 #ifndef IRCEVENTHANDLER_H
 #define IRCEVENTHANDLER_H
 
+#include <QAbstractSocket>
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QSslError>
+#include <QString>
 #include "libircclient_global.h"
+#include "mode.h"
 
 namespace libircclient
 {
+    class Network;
+    class Parser;
+    class Channel;
+    class User;
+
+    /*!
+     * \brief The IRCEventHandler class receives events of networks through plain virtual calls
+     *
+     * There is one function for every signal of Network, with same name and parameters, except that the network is
+     * passed as first parameter, so that one handler can serve many networks. Network calls the handler directly from
+     * its own thread right before it emits the signal, so there is no meta object lookup, no copying of parameters and
+     * no queueing, which makes it cheaper than signals for applications with many networks (bots). Signals are still
+     * emitted, so both can be used at once.
+     *
+     * Handler of network is set with Network::SetEventHandler(), networks that don't have own handler use the global
+     * EventHandler if it's set. All functions do nothing by default, so only the needed ones have to be overridden.
+     */
     class LIBIRCCLIENTSHARED_EXPORT IRCEventHandler
     {
         public:
+            //! Handler used by networks that don't have their own
             static IRCEventHandler *EventHandler;
             IRCEventHandler();
             virtual ~IRCEventHandler();
 
+            // Primitives
+            virtual void Event_RawOutgoing(Network * /*network*/, const QByteArray & /*data*/) {}
+            virtual void Event_RawIncoming(Network * /*network*/, const QByteArray & /*data*/) {}
+            virtual void Event_Invalid(Network * /*network*/, const QByteArray & /*data*/) {}
+            virtual void Event_ConnectionFailure(Network * /*network*/, QAbstractSocket::SocketError /*reason*/) {}
+            virtual void Event_ConnectionError(Network * /*network*/, const QString & /*error*/, int /*code*/) {}
+            virtual void Event_Parse(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_SSLFailure(Network * /*network*/, const QList<QSslError> & /*error_l*/, bool * /*fail*/) {}
+            //! Server gave us some unknown command
+            virtual void Event_Unknown(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_Timeout(Network * /*network*/) {}
+            virtual void Event_Connected(Network * /*network*/) {}
+            virtual void Event_Disconnected(Network * /*network*/) {}
+            virtual void Event_Broken(Network * /*network*/, Parser * /*parser*/, const QString & /*reason*/) {}
+            virtual void Event_NetworkFailure(Network * /*network*/, const QString & /*reason*/, int /*failure*/) {}
+            //! Called when server sent us IRC_NUMERIC_UNKNOWN
+            virtual void Event_NUMERIC_UNKNOWN(Network * /*network*/, Parser * /*parser*/) {}
+
+            // Channel related
+            virtual void Event_SelfJoin(Network * /*network*/, Channel * /*chan*/) {}
+            virtual void Event_Join(Network * /*network*/, Parser * /*parser*/, User * /*user*/, Channel * /*chan*/) {}
+            /*!
+             * \brief Event_PerChannelQuit Called when a user quit the network for every single channel this user was in
+             *                             so that it's extremely simple to render the information in related scrollbacks
+             * \param parser   Pointer to parser of IRC raw message
+             * \param chan     Pointer to channel this user just left
+             */
+            virtual void Event_PerChannelQuit(Network * /*network*/, Parser * /*parser*/, Channel * /*chan*/) {}
+            virtual void Event_Quit(Network * /*network*/, Parser * /*parser*/) {}
+            //! Called before the channel is removed from memory on part of a channel you were in
+            virtual void Event_SelfPart(Network * /*network*/, Parser * /*parser*/, Channel * /*chan*/) {}
+            virtual void Event_Part(Network * /*network*/, Parser * /*parser*/, Channel * /*chan*/) {}
+            virtual void Event_SelfKick(Network * /*network*/, Parser * /*parser*/, Channel * /*chan*/) {}
+            virtual void Event_Kick(Network * /*network*/, Parser * /*parser*/, Channel * /*chan*/) {}
+            //! Called when someone changes the topic
+            virtual void Event_TOPIC(Network * /*network*/, Parser * /*parser*/, Channel * /*chan*/, const QString & /*old_topic*/) {}
+            //! Retrieved after channel is joined as part of info
+            virtual void Event_TOPICInfo(Network * /*network*/, Parser * /*parser*/, Channel * /*chan*/) {}
+            virtual void Event_TOPICWhoTime(Network * /*network*/, Parser * /*parser*/, Channel * /*chan*/) {}
+            virtual void Event_ModeInfo(Network * /*network*/, Parser * /*parser*/, Channel * /*channel*/) {}
+            //! When user's channel mode was changed, but the changed mode was lower priority than the one which
+            //! user already possesed.
+            //! This change is very minor and probably doesn't reflect any real change
+
+            //! Exampe: user who had owner ~ and halfop % (effectively being ~%) had halfop removed
+            virtual void Event_ChannelUserSubmodeChanged(Network * /*network*/, Parser * /*parser*/, Channel * /*channel*/, User * /*user*/) {}
+            virtual void Event_ChannelModeChanged(Network * /*network*/, Parser * /*parser*/, Channel * /*channel*/) {}
+            virtual void Event_ChannelUserModeChanged(Network * /*network*/, Parser * /*parser*/, Channel * /*channel*/, User * /*user*/) {}
+            virtual void Event_CreationTime(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_EndOfBans(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_EndOfExcepts(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_EndOfInvites(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_CPMInserted(Network * /*network*/, Parser * /*parser*/, const ChannelPMode & /*mode*/, Channel * /*channel*/) {}
+            virtual void Event_CPMRemoved(Network * /*network*/, Parser * /*parser*/, const ChannelPMode & /*mode*/, Channel * /*channel*/) {}
+            virtual void Event_INVITE(Network * /*network*/, Parser * /*parser*/) {}
+
+            // Server related
+            virtual void Event_PONG(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_EndOfNames(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_ServerMode(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_MOTDEnd(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_MOTDBegin(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_MOTD(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_Mode(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_NickCollision(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_INFO(Network * /*network*/, Parser * /*parser*/) {}
+            //! IRC_NUMERIC_MYINFO
+            virtual void Event_MyInfo(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_Welcome(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_ISUPPORT(Network * /*network*/, Parser * /*parser*/) {}
+
+            // Whois
+            //! Called for all WHOIS events, in case you don't want to attach to individual replies
+            virtual void Event_WhoisGeneric(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisUser(Network * /*network*/, Parser * /*parser*/, User * /*user*/) {}
+            virtual void Event_WhoisOperator(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisIdle(Network * /*network*/, Parser * /*parser*/, unsigned int /*seconds_idle*/, const QDateTime & /*signon_time*/) {}
+            virtual void Event_WhoisRegNick(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisChannels(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisServer(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisEnd(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisSpecial(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisAccount(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisSecure(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisHost(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_WhoisModes(Network * /*network*/, Parser * /*parser*/) {}
+
+            // Messaging
+            virtual void Event_PRIVMSG(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_CTCP(Network * /*network*/, Parser * /*parser*/, const QString & /*ctcp*/, const QString & /*parameters*/) {}
+            virtual void Event_NOTICE(Network * /*network*/, Parser * /*parser*/) {}
+
+            // Users
+            virtual void Event_UserAwayStatusChange(Network * /*network*/, Parser * /*parser*/, Channel * /*channel*/, User * /*user*/) {}
+            virtual void Event_NICK(Network * /*network*/, Parser * /*parser*/, const QString & /*old_nick*/, const QString & /*new_nick*/) {}
+            virtual void Event_SelfNICK(Network * /*network*/, Parser * /*parser*/, const QString & /*old_nick*/, const QString & /*new_nick*/) {}
+            virtual void Event_WHO(Network * /*network*/, Parser * /*parser*/, Channel * /*channel*/, User * /*user*/) {}
+            virtual void Event_EndOfWHO(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_PMode(Network * /*network*/, Parser * /*parser*/, char /*mode*/) {}
+            virtual void Event_UnAway(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_NowAway(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_AWAY(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_RplAway(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_SelfCHGHOST(Network * /*network*/, Parser * /*parser*/, const QString & /*old_host*/, const QString & /*old_ident*/, const QString & /*new_host*/, const QString & /*new_ident*/) {}
+            virtual void Event_CHGHOST(Network * /*network*/, Parser * /*parser*/, const QString & /*old_host*/, const QString & /*old_ident*/, const QString & /*new_host*/, const QString & /*new_ident*/) {}
+
+            // IRCv3
+            virtual void Event_CAP(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_CAP_ACK(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_CAP_NAK(Network * /*network*/, Parser * /*parser*/) {}
+            virtual void Event_CAP_Timeout(Network * /*network*/) {}
+            virtual void Event_CAP_RequestedCapNotSupported(Network * /*network*/, const QString & /*name*/) {}
     };
 }
 
@@ -19,8 +19,15 @@ SOURCES += user.cpp \
     mode.cpp \
     server.cpp \
     network.cpp \
+    networkpool.cpp \
     parser.cpp \
-    generic.cpp
+    generic.cpp \
+    floodcontrol.cpp \
+    casemapping.cpp \
+    channelmembertable.cpp \
+    channelpmodetable.cpp \
+    maskmatcher.cpp \
+    timerwheel.cpp
 
 HEADERS += user.h\
         libircclient_global.h \
@@ -29,9 +36,19 @@ HEADERS += user.h\
     mode.h \
     server.h \
     network.h \
+    networkpool.h \
     parser.h \
     generic.h \
-    priority.h
+    priority.h \
+    encoding.h \
+    networkstatistics.h \
+    floodcontrol.h \
+    mpscqueue.h \
+    casemapping.h \
+    channelmembertable.h \
+    channelpmodetable.h \
+    maskmatcher.h \
+    timerwheel.h
 
 unix {
     target.path = /usr/lib
@@ -0,0 +1,344 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "maskmatcher.h"
+
+using namespace libircclient;
+
+static bool isWildcard(QChar c)
+{
+    return c == '*' || c == '?';
+}
+
+bool MaskMatcher::WildcardMatch(const QString &pattern, const QString &text)
+{
+    const QChar *p = pattern.constData();
+    const QChar *t = text.constData();
+    int p_size = pattern.size();
+    int t_size = text.size();
+    int pi = 0, ti = 0;
+    // Position of last star and of text it was matched against, if rest fails we let that star eat one more char
+    int star = -1, star_text = 0;
+    while (ti < t_size)
+    {
+        if (pi < p_size && (p[pi] == '?' || p[pi] == t[ti]))
+        {
+            pi++;
+            ti++;
+        } else if (pi < p_size && p[pi] == '*')
+        {
+            star = pi++;
+            star_text = ti;
+        } else if (star >= 0)
+        {
+            pi = star + 1;
+            ti = ++star_text;
+        } else
+        {
+            return false;
+        }
+    }
+    while (pi < p_size && p[pi] == '*')
+        pi++;
+    return pi == p_size;
+}
+
+MaskMatcher::MaskMatcher(CaseMapping mapping)
+{
+    this->caseMapping = mapping;
+}
+
+void MaskMatcher::SetCaseMapping(CaseMapping mapping)
+{
+    if (mapping == this->caseMapping)
+        return;
+    QList<QString> masks = this->GetMasks();
+    this->Clear();
+    this->caseMapping = mapping;
+    foreach (QString mask, masks)
+        this->Insert(mask);
+}
+
+CaseMapping MaskMatcher::GetCaseMapping() const
+{
+    return this->caseMapping;
+}
+
+bool MaskMatcher::Insert(const QString &mask)
+{
+    if (mask.isEmpty() || this->ids.contains(mask))
+        return false;
+    int id;
+    if (!this->freeIds.isEmpty())
+    {
+        id = this->freeIds.takeLast();
+    } else
+    {
+        id = this->masks.size();
+        this->masks.append(Compiled());
+    }
+    Compiled &compiled = this->masks[id];
+    compiled.Mask = mask;
+    compiled.Used = true;
+    this->compile(compiled);
+    this->ids.insert(mask, id);
+    this->file(id);
+    return true;
+}
+
+bool MaskMatcher::Remove(const QString &mask)
+{
+    QHash<QString, int>::iterator item = this->ids.find(mask);
+    if (item == this->ids.end())
+        return false;
+    int id = item.value();
+    this->ids.erase(item);
+    Compiled &compiled = this->masks[id];
+    switch (compiled.Type)
+    {
+        case AnchorNone:
+            this->unanchored.removeOne(id);
+            break;
+        case AnchorHostSuffix:
+            this->hostSuffixes[compiled.Node].Masks.removeOne(id);
+            break;
+        case AnchorHostPrefix:
+            this->hostPrefixes[compiled.Node].Masks.removeOne(id);
+            break;
+        case AnchorNickPrefix:
+            this->nickPrefixes[compiled.Node].Masks.removeOne(id);
+            break;
+        case AnchorExtended:
+            break;
+    }
+    compiled = Compiled();
+    this->freeIds.append(id);
+    // Tries keep their nodes when masks are removed, so once the list is empty we drop them
+    if (this->ids.isEmpty())
+        this->Clear();
+    return true;
+}
+
+bool MaskMatcher::Contains(const QString &mask) const
+{
+    return this->ids.contains(mask);
+}
+
+int MaskMatcher::Count() const
+{
+    return this->ids.size();
+}
+
+void MaskMatcher::Clear()
+{
+    this->masks.clear();
+    this->freeIds.clear();
+    this->ids.clear();
+    this->unanchored.clear();
+    this->hostSuffixes.clear();
+    this->hostPrefixes.clear();
+    this->nickPrefixes.clear();
+}
+
+QList<QString> MaskMatcher::GetMasks() const
+{
+    return this->ids.keys();
+}
+
+QString MaskMatcher::Match(const QString &nick, const QString &ident, const QString &host) const
+{
+    if (this->ids.isEmpty())
+        return QString();
+    QString folded_nick = NickKey::Fold(nick, this->caseMapping);
+    QString folded_host = NickKey::Fold(host, this->caseMapping);
+    QString text = folded_nick + "!" + NickKey::Fold(ident, this->caseMapping) + "@" + folded_host;
+    QList<int> candidates;
+    this->collect(folded_nick, folded_host, candidates);
+    foreach (int id, candidates)
+    {
+        if (WildcardMatch(this->masks.at(id).Pattern, text))
+            return this->masks.at(id).Mask;
+    }
+    return QString();
+}
+
+QList<QString> MaskMatcher::MatchAll(const QString &nick, const QString &ident, const QString &host) const
+{
+    QList<QString> result;
+    if (this->ids.isEmpty())
+        return result;
+    QString folded_nick = NickKey::Fold(nick, this->caseMapping);
+    QString folded_host = NickKey::Fold(host, this->caseMapping);
+    QString text = folded_nick + "!" + NickKey::Fold(ident, this->caseMapping) + "@" + folded_host;
+    QList<int> candidates;
+    this->collect(folded_nick, folded_host, candidates);
+    foreach (int id, candidates)
+    {
+        if (WildcardMatch(this->masks.at(id).Pattern, text))
+            result.append(this->masks.at(id).Mask);
+    }
+    return result;
+}
+
+int MaskMatcher::trieInsert(QVector<TrieNode> &trie, const QString &literal, bool reversed)
+{
+    if (trie.isEmpty())
+        trie.append(TrieNode());
+    int node = 0;
+    for (int i = 0; i < literal.size(); i++)
+    {
+        ushort c = literal.at(reversed ? literal.size() - 1 - i : i).unicode();
+        int child = trie.at(node).Children.value(c, -1);
+        if (child < 0)
+        {
+            child = trie.size();
+            trie.append(TrieNode());
+            trie[node].Children.insert(c, child);
+        }
+        node = child;
+    }
+    return node;
+}
+
+void MaskMatcher::compile(Compiled &compiled) const
+{
+    compiled.Node = 0;
+    QString mask = NickKey::Fold(compiled.Mask, this->caseMapping);
+    if (mask.startsWith('~') || mask.startsWith('$'))
+    {
+        compiled.Pattern = mask;
+        compiled.Type = AnchorExtended;
+        return;
+    }
+    // Complete the mask the same way servers do, nick -> nick!*@*, ident@host -> *!ident@host
+    int exclamation = mask.indexOf('!');
+    int at = mask.indexOf('@', exclamation < 0 ? 0 : exclamation);
+    QString nick, ident, host;
+    if (exclamation < 0 && at < 0)
+    {
+        nick = mask;
+        ident = "*";
+        host = "*";
+    } else if (exclamation < 0)
+    {
+        nick = "*";
+        ident = mask.left(at);
+        host = mask.mid(at + 1);
+    } else if (at < 0)
+    {
+        nick = mask.left(exclamation);
+        ident = mask.mid(exclamation + 1);
+        host = "*";
+    } else
+    {
+        nick = mask.left(exclamation);
+        ident = mask.mid(exclamation + 1, at - exclamation - 1);
+        host = mask.mid(at + 1);
+    }
+    compiled.Pattern = nick + "!" + ident + "@" + host;
+
+    // Pick the longest literal part, that gives the smallest group of masks to check
+    int host_suffix = 0;
+    while (host_suffix < host.size() && !isWildcard(host.at(host.size() - 1 - host_suffix)))
+        host_suffix++;
+    int host_prefix = 0;
+    while (host_prefix < host.size() && !isWildcard(host.at(host_prefix)))
+        host_prefix++;
+    int nick_prefix = 0;
+    while (nick_prefix < nick.size() && !isWildcard(nick.at(nick_prefix)))
+        nick_prefix++;
+    compiled.Type = AnchorNone;
+    int best = 0;
+    if (host_suffix > best)
+    {
+        compiled.Type = AnchorHostSuffix;
+        best = host_suffix;
+    }
+    if (host_prefix > best)
+    {
+        compiled.Type = AnchorHostPrefix;
+        best = host_prefix;
+    }
+    if (nick_prefix > best)
+        compiled.Type = AnchorNickPrefix;
+}
+
+void MaskMatcher::file(int id)
+{
+    Compiled &compiled = this->masks[id];
+    const QString &pattern = compiled.Pattern;
+    int exclamation = pattern.indexOf('!');
+    int at = pattern.indexOf('@', exclamation);
+    QString host = pattern.mid(at + 1);
+    int length = 0;
+    switch (compiled.Type)
+    {
+        case AnchorNone:
+            this->unanchored.append(id);
+            break;
+        case AnchorHostSuffix:
+            while (length < host.size() && !isWildcard(host.at(host.size() - 1 - length)))
+                length++;
+            compiled.Node = trieInsert(this->hostSuffixes, host.right(length), true);
+            this->hostSuffixes[compiled.Node].Masks.append(id);
+            break;
+        case AnchorHostPrefix:
+            while (length < host.size() && !isWildcard(host.at(length)))
+                length++;
+            compiled.Node = trieInsert(this->hostPrefixes, host.left(length), false);
+            this->hostPrefixes[compiled.Node].Masks.append(id);
+            break;
+        case AnchorNickPrefix:
+            while (length < exclamation && !isWildcard(pattern.at(length)))
+                length++;
+            compiled.Node = trieInsert(this->nickPrefixes, pattern.left(length), false);
+            this->nickPrefixes[compiled.Node].Masks.append(id);
+            break;
+        case AnchorExtended:
+            break;
+    }
+}
+
+void MaskMatcher::collect(const QString &nick, const QString &host, QList<int> &candidates) const
+{
+    candidates.append(this->unanchored);
+    if (!this->hostSuffixes.isEmpty())
+    {
+        int node = 0;
+        for (int i = host.size() - 1; i >= 0 && node >= 0; i--)
+        {
+            node = this->hostSuffixes.at(node).Children.value(host.at(i).unicode(), -1);
+            if (node >= 0)
+                candidates.append(this->hostSuffixes.at(node).Masks);
+        }
+    }
+    if (!this->hostPrefixes.isEmpty())
+    {
+        int node = 0;
+        for (int i = 0; i < host.size() && node >= 0; i++)
+        {
+            node = this->hostPrefixes.at(node).Children.value(host.at(i).unicode(), -1);
+            if (node >= 0)
+                candidates.append(this->hostPrefixes.at(node).Masks);
+        }
+    }
+    if (!this->nickPrefixes.isEmpty())
+    {
+        int node = 0;
+        for (int i = 0; i < nick.size() && node >= 0; i++)
+        {
+            node = this->nickPrefixes.at(node).Children.value(nick.at(i).unicode(), -1);
+            if (node >= 0)
+                candidates.append(this->nickPrefixes.at(node).Masks);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef MASKMATCHER_H
+#define MASKMATCHER_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "libircclient_global.h"
+#include "casemapping.h"
+
+namespace libircclient
+{
+    /*!
+     * \brief The MaskMatcher class finds which of many nick!ident@host masks (such as bans) match a user
+     *
+     * Masks are compiled when they are inserted, they are completed to full nick!ident@host form and folded using
+     * case mapping of network. Each mask is then filed under its longest literal part, which is either end of host
+     * (*!*@*.example.org), start of host (*!*@10.0.*) or start of nick (troll*!*@*), in a trie of such parts. Matching
+     * walks the tries along the host and nick of user, so only masks that share the literal part are checked with
+     * full wildcard matching, the rest of the list is never touched.
+     *
+     * Extended bans (for example ~a:account or $a:account) can't be evaluated on client side and never match.
+     */
+    class LIBIRCCLIENTSHARED_EXPORT MaskMatcher
+    {
+        public:
+            //! Wildcard matching with * and ?, both strings need to be folded already
+            static bool WildcardMatch(const QString &pattern, const QString &text);
+
+            MaskMatcher(CaseMapping mapping = CaseMappingRFC1459);
+            //! Changes case mapping, all masks are compiled again
+            void SetCaseMapping(CaseMapping mapping);
+            CaseMapping GetCaseMapping() const;
+            //! Inserts a mask, returns false if it's already there
+            bool Insert(const QString &mask);
+            bool Remove(const QString &mask);
+            bool Contains(const QString &mask) const;
+            int Count() const;
+            void Clear();
+            QList<QString> GetMasks() const;
+            //! Returns one of the masks that match this user, or null string if none of them do
+            QString Match(const QString &nick, const QString &ident, const QString &host) const;
+            //! Returns all masks that match this user
+            QList<QString> MatchAll(const QString &nick, const QString &ident, const QString &host) const;
+
+        private:
+            enum Anchor
+            {
+                //! Mask has no literal part that could be indexed (*!*@*), it's checked every time
+                AnchorNone,
+                AnchorHostSuffix,
+                AnchorHostPrefix,
+                AnchorNickPrefix,
+                //! Extended ban, never matches
+                AnchorExtended
+            };
+            struct Compiled
+            {
+                QString Mask;
+                //! Folded mask in full nick!ident@host form
+                QString Pattern;
+                Anchor Type = AnchorNone;
+                int Node = 0;
+                bool Used = false;
+            };
+            struct TrieNode
+            {
+                QHash<ushort, int> Children;
+                //! Masks whose literal part ends in this node
+                QList<int> Masks;
+            };
+            static int trieInsert(QVector<TrieNode> &trie, const QString &literal, bool reversed);
+            void compile(Compiled &compiled) const;
+            void file(int id);
+            void collect(const QString &nick, const QString &host, QList<int> &candidates) const;
+            CaseMapping caseMapping;
+            QVector<Compiled> masks;
+            //! Ids of unused items of masks, these are reused first
+            QList<int> freeIds;
+            QHash<QString, int> ids;
+            QList<int> unanchored;
+            QVector<TrieNode> hostSuffixes;
+            QVector<TrieNode> hostPrefixes;
+            QVector<TrieNode> nickPrefixes;
+    };
+}
+
+#endif // MASKMATCHER_H
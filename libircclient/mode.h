@@ -61,8 +61,6 @@ namespace libircclient
             bool operator!=(const ChannelPMode& m) const { return !m.EqualTo(*this); }
             bool EqualTo(const ChannelPMode& m) const;
     };
-
-    uint qHash(const ChannelPMode& mode, uint seed = 0);
 }
 
 #endif // MODE_H
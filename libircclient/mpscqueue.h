@@ -0,0 +1,87 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace libircclient
+{
+    /*!
+     * \brief Lock-free FIFO with any number of producers and a single consumer
+     *
+     * Push() can be called from any thread and never blocks, it's just one atomic exchange. Pop(), IsEmpty()
+     * and Clear() may be only called from one thread (the consumer). An item that is being pushed right
+     * now may not be visible to consumer yet, so producer needs to wake up consumer after Push() returns.
+     */
+    template <typename T>
+    class MPSCQueue
+    {
+        public:
+            MPSCQueue()
+            {
+                this->tail = new Node();
+                this->head.store(this->tail, std::memory_order_relaxed);
+            }
+            ~MPSCQueue()
+            {
+                this->Clear();
+                delete this->tail;
+            }
+            MPSCQueue(const MPSCQueue&) = delete;
+            MPSCQueue &operator=(const MPSCQueue&) = delete;
+            void Push(const T &item)
+            {
+                Node *node = new Node(item);
+                Node *previous = this->head.exchange(node, std::memory_order_acq_rel);
+                previous->next.store(node, std::memory_order_release);
+            }
+            //! Removes the oldest item from queue and stores it to item, returns false if there is nothing
+            bool Pop(T &item)
+            {
+                Node *next = this->tail->next.load(std::memory_order_acquire);
+                if (!next)
+                    return false;
+                item = std::move(next->value);
+                delete this->tail;
+                // Node we just took the value from becomes new stub
+                this->tail = next;
+                return true;
+            }
+            bool IsEmpty() const
+            {
+                return this->tail->next.load(std::memory_order_acquire) == nullptr;
+            }
+            void Clear()
+            {
+                T item;
+                while (this->Pop(item));
+            }
+
+        private:
+            struct Node
+            {
+                Node() : next(nullptr) {}
+                Node(const T &item) : value(item), next(nullptr) {}
+                T value;
+                std::atomic<Node*> next;
+            };
+            //! Last pushed node, producers swap it
+            std::atomic<Node*> head;
+            //! Stub node preceding the oldest item, only touched by consumer
+            Node *tail;
+    };
+}
+
+#endif // MPSCQUEUE_H
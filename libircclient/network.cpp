@@ -13,22 +13,51 @@
 #include <QtNetwork>
 #include <QAbstractSocket>
 #include <QDebug>
+#include <QMetaMethod>
 #include "network.h"
 #include "server.h"
 #include "channel.h"
 #include "parser.h"
 #include "networkmodehelp.h"
 #include "generic.h"
+#include "irceventhandler.h"
+#include "../libirc/binaryserializer.h"
 #include "../libirc/serveraddress.h"
 #include "../libirc/error_code.h"
 #include <algorithm> // Add this include for std::sort
+#include <cstring>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <QStringDecoder>
 #define fromTime_t fromSecsSinceEpoch
+#else
+#include <QTextCodec>
 #endif
 
+// Events are first passed to event handler of network and then emitted as signal of same name, arguments are
+// evaluated only once by fireEvent(), so that temporaries are not created twice
+#define IRC_EVENT(event, ...)  fireEvent(this, this->getEventHandler(), &IRCEventHandler::event, &Network::event, true, __VA_ARGS__)
+#define IRC_EVENT0(event)      do { IRCEventHandler *event_handler = this->getEventHandler(); \
+                                    if (event_handler) event_handler->event(this); \
+                                    emit this->event(); } while (0)
+// Same as IRC_EVENT, but signal is emitted only if something is connected to it
+// Arguments are not evaluated at all when there is neither handler nor listener
+#define IRC_EVENT_LISTENED(listener, event, ...) do { IRCEventHandler *event_handler = this->getEventHandler(); \
+                                                      bool event_listened = this->HasListener(listener); \
+                                                      if (event_handler || event_listened) \
+                                                          fireEvent(this, event_handler, &IRCEventHandler::event, &Network::event, event_listened, __VA_ARGS__); } while (0)
+
 using namespace libircclient;
 
+template <typename... HandlerParams, typename... SignalParams, typename... Args>
+static void fireEvent(Network *network, IRCEventHandler *handler, void (IRCEventHandler::*handler_event)(Network*, HandlerParams...),
+                      void (Network::*signal)(SignalParams...), bool emit_signal, const Args&... args)
+{
+    if (handler)
+        (handler->*handler_event)(network, args...);
+    if (emit_signal)
+        (network->*signal)(args...);
+}
+
 Network::Network(libirc::ServerAddress &server, const QString &name, const Encoding &enc) : libirc::Network(name)
 {
     this->initialize();
@@ -71,6 +100,7 @@ Network::~Network()
     delete this->server;
     this->deleteTimers();
     delete this->socket;
+    delete this->decoder;
     this->freemm();
 }
 
@@ -83,12 +113,18 @@ void Network::Connect()
     this->_loggedIn = false;
     //delete this->network_thread;
     delete this->socket;
+    // Drop whatever was left from previous connection
+    this->receiveGeneration++;
+    this->receivePending = 0;
+    this->sendBuffer.resize(0);
+    this->sendBufferLines = 0;
 
     //this->network_thread = new NetworkThread(this);
+    // Socket is a child so that it's moved together with network to another thread
     if (!this->IsSSL())
-        this->socket = new QTcpSocket();
+        this->socket = new QTcpSocket(this);
     else
-        this->socket = new QSslSocket();
+        this->socket = new QSslSocket(this);
 
 #ifdef QT6_BUILD
     connect(this->socket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)), this, SLOT(OnError(QAbstractSocket::SocketError)));
@@ -113,7 +149,7 @@ void Network::Connect()
             this->closeError("SSL handshake failed: " + this->socket->errorString(), EHANDSHAKE);
         }*/
     }
-    this->senderTimer.start(this->MSDelayOnEmpty);
+    this->floodControl.Reset();
 }
 
 void Network::Reconnect()
@@ -157,7 +193,7 @@ bool Network::IsConnected()
 
 void libircclient::Network::SetAway(bool away, const QString &message)
 {
-    this->awayMessage = message;
+    SERIALIZED_SET(awayMessage, message);
     if (!away)
     {
         this->TransferRaw("AWAY");
@@ -225,16 +261,17 @@ void Network::TransferRaw(QString raw, libircclient::Priority priority)
     raw.replace("\r", "").replace("\n", "");
 
     QByteArray data = QString(raw + "\n").toUtf8();
-    emit this->Event_RawOutgoing(data);
+    IRC_EVENT_LISTENED(Listener_RawOutgoing, Event_RawOutgoing, data);
     if (this->scheduling)
     {
         this->scheduleDelivery(data, priority);
     }
     else
     {
-        this->bytesSent += data.size();
-        this->socket->write(data);
-        this->socket->flush();
+        // We are not scheduling only when socket is about to be closed, so it must go out right now,
+        // together with whatever is still waiting in the outgoing buffer
+        this->appendOutgoing(data);
+        this->flushOutgoing();
     }
 }
 
@@ -316,24 +353,26 @@ bool libircclient::Network::SupportsIRCv3() const
 
 void Network::EnableIRCv3Support()
 {
-    this->_enableCap = true;
+    SERIALIZED_SET(_enableCap, true);
 }
 
 void Network::DisableIRCv3Support()
 {
-    this->_enableCap = false;
+    SERIALIZED_SET(_enableCap, false);
 }
 
 void Network::RequestCapability(const QString &capability)
 {
-    if (!this->_capabilitiesRequested.contains(capability))
-        this->_capabilitiesRequested.append(capability);
+    if (this->_capabilitiesRequested.contains(capability))
+        return;
+    this->_capabilitiesRequested.append(capability);
+    this->MarkChanged("_capabilitiesRequested");
 }
 
 void Network::DisableCapability(const QString &capability)
 {
-    if (this->_capabilitiesRequested.contains(capability))
-        this->_capabilitiesRequested.removeAll(capability);
+    if (this->_capabilitiesRequested.removeAll(capability))
+        this->MarkChanged("_capabilitiesRequested");
 }
 
 bool Network::CapabilityRequested(const QString &capability)
@@ -402,17 +441,20 @@ void Network::SetHelpForMode(char mode, const QString &message)
 
 void Network::OnPing()
 {
-    // Check ping timeout
-    if (QDateTime::currentDateTime() > this->lastPing.addSecs(this->pingTimeout))
+    // Receiving data doesn't touch the timer, so when it fires we check if there was anything since it was started
+    qint64 deadline = this->lastActivity + static_cast<qint64>(this->pingTimeout) * 1000;
+    if (TimerWheel::GetTime() >= deadline)
     {
-        emit this->Event_Timeout();
+        IRC_EVENT0(Event_Timeout);
         this->closeError("Timeout", ETIMEDOUT);
+        return;
     }
+    this->timerPingTimeout.StartAt(deadline);
 }
 
 void Network::SetPassword(const QString &Password)
 {
-    this->password = Password;
+    SERIALIZED_SET(password, Password);
 }
 
 void Network::RequestJoin(const QString &name, Priority priority)
@@ -423,22 +465,53 @@ void Network::RequestJoin(const QString &name, Priority priority)
 void Network::OnPingSend()
 {
     this->TransferRaw("PING :" + QString::number(QDateTime::currentDateTime().toMSecsSinceEpoch()), libircclient::Priority_RealTime);
+    this->timerPingSend.Start(this->pingRate);
 }
 
 void Network::OnCapSupportTimeout()
 {
     // Prevent this from running multiple times
-    this->capTimeout.stop();
-    emit this->Event_CAP_Timeout();
+    this->capTimeout.Stop();
+    IRC_EVENT0(Event_CAP_Timeout);
     this->DisableIRCv3Support();
 }
 
+void Network::resumeTimers()
+{
+    this->timerPingSend.Resume();
+    this->timerPingTimeout.Resume();
+    this->capTimeout.Resume();
+    this->senderTimer.Resume();
+}
+
+bool Network::event(QEvent *event)
+{
+    if (event->type() == QEvent::ThreadChange)
+    {
+        // Timers are in wheel of the thread we are leaving, the queued call is delivered in the new thread
+        // where they are started again with same deadlines
+        this->timerPingSend.Suspend();
+        this->timerPingTimeout.Suspend();
+        this->capTimeout.Suspend();
+        this->senderTimer.Suspend();
+        QMetaObject::invokeMethod(this, "resumeTimers", Qt::QueuedConnection);
+    }
+    return libirc::Network::event(event);
+}
+
+QDateTime Network::lastPingTime() const
+{
+    if (!this->lastActivity)
+        return QDateTime();
+    return QDateTime::currentDateTime().addMSecs(this->lastActivity - TimerWheel::GetTime());
+}
+
 void Network::OnReceive(const QByteArray &data)
 {
     if (data.length() == 0)
         return;
 
-    emit this->Event_RawIncoming(data);
+    IRC_EVENT_LISTENED(Listener_RawIncoming, Event_RawIncoming, data);
 
     this->processIncomingRawData(data);
 }
@@ -455,33 +528,29 @@ void Network::closeError(const QString &error, int code)
     temp->close();
     temp->deleteLater();
     this->deleteTimers();
-    emit this->Event_NetworkFailure(error, code);
-    emit this->Event_Disconnected();
+    IRC_EVENT(Event_NetworkFailure, error, code);
+    IRC_EVENT0(Event_Disconnected);
 }
 
 void Network::updateSelfAway(Parser *parser, bool status, const QString &text)
 {
-    // we need to scan all channels and update the status
-    foreach (Channel *channel, this->channels)
-    {
-        if (channel->ContainsUser(this->GetNick()))
-        {
-            User *user = channel->GetUser(this->GetNick());
-            if (user->IsAway != status)
-            {
-                user->IsAway = status;
-                user->AwayMs = text;
-                emit this->Event_UserAwayStatusChange(parser, channel, user);
-            }
-        }
-    }
+    // our record is shared by all channels we are in
+    User *user = this->userIndex.value(this->localNickKey(), nullptr);
+    if (!user || user->IsAway == status)
+        return;
+    user->IsAway = status;
+    user->AwayMs = text;
+    user->MarkChanged("IsAway");
+    user->MarkChanged("AwayMs");
+    foreach (Channel *channel, user->GetChannels())
+        IRC_EVENT(Event_UserAwayStatusChange, parser, channel, user);
 }
 
 void Network::OnError(QAbstractSocket::SocketError er)
 {
     if (this->socket == nullptr)
         return;
-    emit this->Event_ConnectionFailure(er);
+    IRC_EVENT(Event_ConnectionFailure, er);
     this->closeError(Generic::ErrorCode2String(er), 1);
 }
 
@@ -489,19 +558,54 @@ void Network::OnReceive()
 {
     if (!this->IsConnected())
         return;
+    // If some handler spins the event loop, we would get here again while the buffer is still being processed,
+    // the outer call keeps reading until socket is empty, so there is nothing to do
+    if (this->receiving)
+        return;
+    this->receiving = true;
+    this->receiveWakeups.fetch_add(1, std::memory_order_relaxed);
     // We need to keep checking if socket is not NULL because following calls from
     // processIncomingRawData can initiate disconnect, which would delete it and change
-    // it to NULL
-    while (this->socket && this->socket->canReadLine())
-    {
-        QByteArray line = this->socket->readLine();
-        if (line.length() == 0)
-            return;
-
-        emit this->Event_RawIncoming(line);
-
-        this->processIncomingRawData(line);
+    // it to NULL, or even reconnect, which replaces it with new socket
+    while (this->socket && this->socket->bytesAvailable() > 0)
+    {
+        unsigned int generation = this->receiveGeneration;
+        // Read everything there is into the buffer right after the incomplete line from previous read
+        int available = static_cast<int>(this->socket->bytesAvailable());
+        if (this->receiveBuffer.size() < this->receivePending + available)
+            this->receiveBuffer.resize(this->receivePending + available);
+        qint64 received = this->socket->read(this->receiveBuffer.data() + this->receivePending, available);
+        if (received <= 0)
+            break;
+        this->bytesRcvd.fetch_add(static_cast<unsigned long long>(received), std::memory_order_relaxed);
+        int size = this->receivePending + static_cast<int>(received);
+        const char *buffer = this->receiveBuffer.constData();
+        int position = 0;
+        while (this->socket && this->receiveGeneration == generation && position < size)
+        {
+            const char *newline = static_cast<const char*>(memchr(buffer + position, '\n', static_cast<size_t>(size - position)));
+            if (!newline)
+                break;
+            int line_length = static_cast<int>(newline - buffer) - position + 1;
+            // Parser gets only a view into the buffer, the signal needs a real copy because it may be queued
+            QByteArray line = QByteArray::fromRawData(buffer + position, line_length);
+            position += line_length;
+            this->linesRcvd.fetch_add(1, std::memory_order_relaxed);
+            if (this->getEventHandler() || this->HasListener(Listener_RawIncoming))
+            {
+                QByteArray raw_line(line.constData(), line_length);
+                IRC_EVENT_LISTENED(Listener_RawIncoming, Event_RawIncoming, raw_line);
+            }
+            this->processIncomingRawData(line);
+        }
+        // Socket was closed or replaced by one of handlers, remaining data belonged to old connection
+        if (!this->socket || this->receiveGeneration != generation)
+            continue;
+        this->receivePending = size - position;
+        if (this->receivePending > 0 && position > 0)
+            memmove(this->receiveBuffer.data(), buffer + position, static_cast<size_t>(this->receivePending));
     }
+    this->receiving = false;
 }
 
 void Network::OnDisconnect()
@@ -518,38 +622,28 @@ char Network::StartsWithCUPrefix(QString user_name)
 {
     if (user_name.isEmpty())
         return 0;
-    char first_symbol = user_name[0].toLatin1();
-    if (this->channelUserPrefixes.contains(first_symbol))
-    {
-        int index = this->channelUserPrefixes.indexOf(first_symbol);
-        if (index < this->CUModes.count())
-            return this->CUModes[index];
-    }
-    return 0;
+    return this->CUModes.At(this->channelUserPrefixes.Rank(user_name[0].toLatin1()));
 }
 
 int Network::PositionOfUCPrefix(char prefix)
 {
-    // Check if there is such a prefix
-    if (!this->channelUserPrefixes.contains(prefix))
-        return -1;
-
-    return this->channelUserPrefixes.indexOf(prefix);
+    return this->channelUserPrefixes.Rank(prefix);
 }
 
 void Network::SetChannelUserPrefixes(const QList<char> &data)
 {
     this->channelUserPrefixes = data;
+    this->MarkChanged("channelUserPrefixes");
 }
 
 void Network::SetCModes(const QList<char> &data)
 {
-    this->CModes = data;
+    SERIALIZED_SET(CModes, data);
 }
 
 QList<char> Network::GetChannelUserPrefixes()
 {
-    return this->channelUserPrefixes;
+    return this->channelUserPrefixes.ToList();
 }
 
 bool Network::HasCap(const QString &cap)
@@ -559,47 +653,52 @@ bool Network::HasCap(const QString &cap)
 
 QList<char> Network::GetCModes()
 {
-    return this->CModes;
+    return this->CModes.ToList();
 }
 
 QList<char> Network::GetCPModes()
 {
-    return this->CPModes;
+    return this->CPModes.ToList();
 }
 
 void Network::SetCPModes(const QList<char> &data)
 {
-    this->CPModes = data;
+    SERIALIZED_SET(CPModes, data);
+    this->updateParameterModes();
 }
 
 void Network::SetCRModes(const QList<char> &data)
 {
-    this->CRModes = data;
+    SERIALIZED_SET(CRModes, data);
+    this->updateParameterModes();
 }
 
 QList<char> Network::GetCRModes()
 {
-    return this->CRModes;
+    return this->CRModes.ToList();
 }
 
 QList<char> Network::GetSTATUSMSGModes()
 {
-    return this->STATUSMSG_Modes;
+    return this->STATUSMSG_Modes.ToList();
 }
 
 void Network::SetSTATUSMSGModes(const QList<char> &data)
 {
     this->STATUSMSG_Modes = data;
+    this->MarkChanged("STATUSMSG_Modes");
 }
 
 void Network::SetCUModes(const QList<char> &data)
 {
     this->CUModes = data;
+    this->MarkChanged("CUModes");
+    this->updateParameterModes();
 }
 
 void Network::SetCCModes(const QList<char> &data)
 {
-    this->CCModes = data;
+    SERIALIZED_SET(CCModes, data);
 }
 
 UMode Network::GetLocalUserMode()
@@ -608,24 +707,16 @@ UMode Network::GetLocalUserMode()
 }
 
 //! This function performs a sort of a list of random chars using a mask list, that contains these chars that are sorted
-//! it removes duplicates
-static QList<char> SortingHelper(QList<char> mask, QList<char> list)
+//! it removes duplicates and chars that are not in the mask
+static QList<char> SortingHelper(const libirc::RankedModeSet &mask, const QList<char> &list)
 {
-    // Hash sort, memory expensive but pretty fast
-    QHash<int, char> hash;
-    foreach (char mode, list)
+    libirc::ModeSet present = libirc::ModeSet(list) & mask.GetSet();
+    QList<char> sorted_list;
+    for (int rank = 0; rank < mask.Count(); rank++)
     {
-        int index = mask.indexOf(mode);
-        if (hash.contains(index))
-            continue;
-        hash.insert(index, mode);
+        if (present.Contains(mask.At(rank)))
+            sorted_list.append(mask.At(rank));
     }
-    // Now that we have all modes in a hash table, we can just easily sort them
-    QList<int> unsorted_ints = hash.keys();
-    std::sort(unsorted_ints.begin(), unsorted_ints.end());
-    QList<char> sorted_list;
-    foreach (int mode, unsorted_ints)
-        sorted_list.append(mask[mode]);
     return sorted_list;
 }
 
@@ -641,19 +732,15 @@ QList<char> Network::ModeHelper_GetSortedCUModes(const QList<char> &unsorted_lis
 
 QList<char> Network::ParameterModes()
 {
-    QList<char> results;
-    results.append(this->CUModes);
-    results.append(this->CRModes);
-    results.append(this->CPModes);
-    return results;
+    return this->parameterModes.ToList();
 }
 
 QList<char> Network::GetCCModes()
 {
-    return this->CCModes;
+    return this->CCModes.ToList();
 }
 
-static QVariant serializeList(QList<char> data)
+static QVariant serializeList(const QList<char> &data)
 {
     QList<QVariant> result;
     foreach (char x, data)
@@ -663,6 +750,8 @@ static QVariant serializeList(QList<char> data)
 
 void Network::LoadHash(const QHash<QString, QVariant> &hash)
 {
+    // Channels and users are loaded together, so they are registered for RPC at once
+    libirc::RPCRegistrationBatch rpc_batch;
     libirc::Network::LoadHash(hash);
     UNSERIALIZE_STRING(awayMessage);
     UNSERIALIZE_STRING(hostname);
@@ -684,16 +773,34 @@ void Network::LoadHash(const QHash<QString, QVariant> &hash)
     UNSERIALIZE_STRING(password);
     UNSERIALIZE_STRING(alternateNick);
     if (hash.contains("server"))
+    {
+        delete this->server;
         this->server = new Server(hash["server"].toHash());
+    }
     if (hash.contains("users"))
     {
-        foreach (QVariant user, hash["user"].toList())
+        qDeleteAll(this->users);
+        this->users.clear();
+        foreach (QVariant user, hash["users"].toList())
             this->users.append(new User(user.toHash()));
     }
+    // Names of channels and nicks of their users are folded by case mapping, so it has to be known before channels
+    if (hash.contains("caseMapping"))
+    {
+        this->caseMapping = static_cast<CaseMapping> (hash["caseMapping"].toInt());
+        this->localKey = this->GetNickKey(this->localKeyNick);
+        foreach (Channel *channel, this->channels)
+            channel->UpdateUserKeys();
+    }
     if (hash.contains("channels"))
     {
         foreach (QVariant channel, hash["channels"].toList())
-            this->channels.append(new Channel(channel.toHash()));
+        {
+            // Channel shares records of its users with other channels of network only once it's inserted to it
+            Channel *channel_p = new Channel(channel.toHash());
+            channel_p->SetNetwork(this);
+            this->addChannel(channel_p);
+        }
     }
     if (hash.contains("localUserMode"))
         this->localUserMode = UMode(hash["localUserMode"].toHash());
@@ -704,9 +811,130 @@ void Network::LoadHash(const QHash<QString, QVariant> &hash)
     UNSERIALIZE_STRINGLIST(_capabilitiesSubscribed);
     UNSERIALIZE_STRINGLIST(_capabilitiesRequested);
     UNSERIALIZE_STRINGLIST(_capabilitiesSupported);
+    this->updateParameterModes();
+    this->indexChannels();
+    this->indexUsers();
 }
 
 QHash<QString, QVariant> Network::ToHash()
+{
+    QHash<QString, QVariant> hash = this->settingsToHash();
+    QList<QVariant> users_x, channels_x;
+    foreach (Channel *ch, this->channels)
+        channels_x.append(QVariant(ch->ToHash()));
+    hash.insert("channels", QVariant(channels_x));
+    foreach (User *user, this->users)
+        users_x.append(QVariant(user->ToHash()));
+    hash.insert("users", QVariant(users_x));
+    return hash;
+}
+
+QHash<QString, QVariant> Network::ToDelta(quint64 since_generation)
+{
+    if (this->GetCreatedGeneration() > since_generation)
+        return this->ToHash();
+    QHash<QString, QVariant> delta;
+    QList<QString> fields = this->GetChangedFields(since_generation);
+    if (!fields.isEmpty())
+    {
+        QHash<QString, QVariant> hash = this->settingsToHash();
+        foreach (QString field, fields)
+            delta.insert(field, hash.value(field));
+    }
+    // These are replaced as a whole by LoadHash()
+    if (this->localUser.GetGeneration() > since_generation)
+        delta.insert("localUser", this->localUser.ToHash());
+    if (this->localUserMode.GetGeneration() > since_generation)
+        delta.insert("localUserMode", this->localUserMode.ToHash());
+    if (this->channelsResetGeneration > since_generation)
+    {
+        QList<QVariant> channels_x;
+        foreach (Channel *ch, this->channels)
+            channels_x.append(QVariant(ch->ToHash()));
+        delta.insert("channels", QVariant(channels_x));
+        return delta;
+    }
+    QList<QVariant> new_channels, removed_channels;
+    QHash<QString, QVariant> channel_deltas;
+    foreach (Channel *ch, this->channels)
+    {
+        if (ch->GetCreatedGeneration() > since_generation)
+        {
+            new_channels.append(QVariant(ch->ToHash()));
+            continue;
+        }
+        QHash<QString, QVariant> channel_delta = ch->ToDelta(since_generation);
+        if (!channel_delta.isEmpty())
+            channel_deltas.insert(ch->GetName(), QVariant(channel_delta));
+    }
+    QHash<QString, quint64>::const_iterator removed = this->removedChannels.constBegin();
+    for (; removed != this->removedChannels.constEnd(); ++removed)
+    {
+        if (removed.value() > since_generation)
+            removed_channels.append(QVariant(removed.key()));
+    }
+    if (!new_channels.isEmpty())
+        delta.insert("newChannels", QVariant(new_channels));
+    if (!channel_deltas.isEmpty())
+        delta.insert("channelDeltas", QVariant(channel_deltas));
+    if (!removed_channels.isEmpty())
+        delta.insert("removedChannels", QVariant(removed_channels));
+    return delta;
+}
+
+void Network::ApplyDelta(const QHash<QString, QVariant> &delta)
+{
+    libirc::RPCRegistrationBatch rpc_batch;
+    QHash<QString, QVariant> hash = delta;
+    if (hash.contains("server"))
+    {
+        delete this->server;
+        this->server = new Server(hash.take("server").toHash());
+    }
+    // Users of channels are shared records that come with the channels, they must not be loaded again
+    hash.remove("users");
+    // LoadHash() would append the channels to existing ones, so they are handled here using sync tools
+    if (hash.contains("channels"))
+    {
+        this->_st_ClearChannels();
+        foreach (QVariant channel, hash.take("channels").toList())
+        {
+            Channel source(channel.toHash());
+            this->_st_InsertChannel(&source);
+        }
+    }
+    foreach (QVariant name, hash.take("removedChannels").toList())
+    {
+        Channel *channel = this->GetChannel(name.toString());
+        if (!channel)
+            continue;
+        this->removeChannel(channel);
+        delete channel;
+    }
+    foreach (QVariant channel, hash.take("newChannels").toList())
+    {
+        Channel source(channel.toHash());
+        // Channel was left and joined again since, so the old copy is replaced
+        Channel *previous = this->GetChannel(source.GetName());
+        if (previous)
+        {
+            this->removeChannel(previous);
+            delete previous;
+        }
+        this->_st_InsertChannel(&source);
+    }
+    QHash<QString, QVariant> channel_deltas = hash.take("channelDeltas").toHash();
+    QHash<QString, QVariant>::const_iterator channel_delta = channel_deltas.constBegin();
+    for (; channel_delta != channel_deltas.constEnd(); ++channel_delta)
+    {
+        Channel *channel = this->GetChannel(channel_delta.key());
+        if (channel)
+            channel->ApplyDelta(channel_delta.value().toHash());
+    }
+    this->LoadHash(hash);
+}
+
+QHash<QString, QVariant> Network::settingsToHash()
 {
     QHash<QString, QVariant> hash = libirc::Network::ToHash();
     SERIALIZE(awayMessage);
@@ -724,34 +952,85 @@ QHash<QString, QVariant> Network::ToHash()
     SERIALIZE(_capabilitiesSupported);
     SERIALIZE(_capabilitiesSubscribed);
     SERIALIZE(_capabilitiesRequested);
-    hash.insert("CCModes", serializeList(this->CCModes));
-    hash.insert("CModes", serializeList(this->CModes));
-    hash.insert("CPModes", serializeList(this->CPModes));
-    hash.insert("CUModes", serializeList(this->CUModes));
-    hash.insert("STATUSMSG_Modes", serializeList(this->STATUSMSG_Modes));
-    hash.insert("channelUserPrefixes", serializeList(this->channelUserPrefixes));
-    hash.insert("CRModes", serializeList(this->CRModes));
+    hash.insert("CCModes", serializeList(this->CCModes.ToList()));
+    hash.insert("CModes", serializeList(this->CModes.ToList()));
+    hash.insert("CPModes", serializeList(this->CPModes.ToList()));
+    hash.insert("CUModes", serializeList(this->CUModes.ToList()));
+    hash.insert("STATUSMSG_Modes", serializeList(this->STATUSMSG_Modes.ToList()));
+    hash.insert("channelUserPrefixes", serializeList(this->channelUserPrefixes.ToList()));
+    hash.insert("CRModes", serializeList(this->CRModes.ToList()));
     hash.insert("localUserMode", this->localUserMode.ToHash());
     SERIALIZE(channelPrefix);
     hash.insert("server", this->server->ToHash());
     hash.insert("localUser", this->localUser.ToHash());
+    QDateTime lastPing = this->lastPingTime();
     SERIALIZE(lastPing);
-    QList<QVariant> users_x, channels_x;
-    foreach (Channel *ch, this->channels)
-        channels_x.append(QVariant(ch->ToHash()));
-    hash.insert("channels", QVariant(channels_x));
-    foreach (User *user, this->users)
-        users_x.append(QVariant(user->ToHash()));
-    hash.insert("users", QVariant(users_x));
     hash.insert("encoding", static_cast<int>(this->encoding));
+    hash.insert("caseMapping", static_cast<int>(this->caseMapping));
     return hash;
 }
 
+void Network::writeBinaryFields(libirc::BinaryWriter &writer)
+{
+    // Same fields as ToHash(), channels and users are written directly without building their hashes
+    libirc::Network::writeBinaryFields(writer);
+    SERIALIZE_BINARY(awayMessage);
+    SERIALIZE_BINARY(hostname);
+    SERIALIZE_BINARY(port);
+    SERIALIZE_BINARY(pingTimeout);
+    SERIALIZE_BINARY(pingRate);
+    SERIALIZE_BINARY(defaultQuit);
+    SERIALIZE_BINARY(_enableCap);
+    SERIALIZE_BINARY(autoRejoin);
+    SERIALIZE_BINARY(autoIdentify);
+    SERIALIZE_BINARY(identifyString);
+    SERIALIZE_BINARY(password);
+    SERIALIZE_BINARY(alternateNick);
+    SERIALIZE_BINARY(_capabilitiesSupported);
+    SERIALIZE_BINARY(_capabilitiesSubscribed);
+    SERIALIZE_BINARY(_capabilitiesRequested);
+    writer.WriteField("CCModes");
+    writer.WriteCharList(this->CCModes.ToList());
+    writer.WriteField("CModes");
+    writer.WriteCharList(this->CModes.ToList());
+    writer.WriteField("CPModes");
+    writer.WriteCharList(this->CPModes.ToList());
+    writer.WriteField("CUModes");
+    writer.WriteCharList(this->CUModes.ToList());
+    writer.WriteField("STATUSMSG_Modes");
+    writer.WriteCharList(this->STATUSMSG_Modes.ToList());
+    writer.WriteField("channelUserPrefixes");
+    writer.WriteCharList(this->channelUserPrefixes.ToList());
+    writer.WriteField("CRModes");
+    writer.WriteCharList(this->CRModes.ToList());
+    writer.WriteField("localUserMode");
+    this->localUserMode.ToBinary(writer);
+    SERIALIZE_BINARY(channelPrefix);
+    writer.WriteField("server");
+    this->server->ToBinary(writer);
+    writer.WriteField("localUser");
+    this->localUser.ToBinary(writer);
+    QDateTime lastPing = this->lastPingTime();
+    SERIALIZE_BINARY(lastPing);
+    writer.WriteField("channels");
+    writer.BeginList(this->channels.size());
+    foreach (Channel *ch, this->channels)
+        ch->ToBinary(writer);
+    writer.WriteField("users");
+    writer.BeginList(this->users.size());
+    foreach (User *user, this->users)
+        user->ToBinary(writer);
+    writer.WriteField("encoding");
+    writer.WriteValue(static_cast<int>(this->encoding));
+    writer.WriteField("caseMapping");
+    writer.WriteValue(static_cast<int>(this->caseMapping));
+}
+
 // This is a slot so don't change the signature to const QList<QSslError> &errors
 void Network::OnSslHandshakeFailure(QList<QSslError> errors)
 {
     bool temp = false;
-    emit this->Event_SSLFailure(errors, &temp);
+    IRC_EVENT(Event_SSLFailure, errors, &temp);
     if (!temp)
         ((QSslSocket*)this->socket)->ignoreSslErrors();
     else
@@ -760,15 +1039,12 @@ void Network::OnSslHandshakeFailure(QList<QSslError> errors)
 
 Channel *Network::GetChannel(QString channel_name)
 {
-    channel_name = channel_name.toLower();
-    foreach(Channel *channel, this->channels)
-    {
-        if (channel->GetName().toLower() == channel_name)
-        {
-            return channel;
-        }
-    }
-    return nullptr;
+    return this->channelIndex.value(this->GetNickKey(channel_name), nullptr);
+}
+
+User *Network::GetUser(const QString &nick)
+{
+    return this->userIndex.value(this->GetNickKey(nick), nullptr);
 }
 
 QList<Channel *> Network::GetChannels()
@@ -783,7 +1059,7 @@ Encoding Network::GetEncoding()
 
 QList<char> Network::GetCUModes()
 {
-    return this->CUModes;
+    return this->CUModes.ToList();
 }
 
 bool Network::ContainsChannel(const QString &channel_name)
@@ -798,25 +1074,63 @@ long long Network::GetLag()
 
 long long Network::GetBytesSent()
 {
-    return this->bytesSent;
+    return static_cast<long long>(this->bytesSent.load(std::memory_order_relaxed));
 }
 
 long long Network::GetBytesReceived()
 {
-    return this->bytesRcvd;
+    return static_cast<long long>(this->bytesRcvd.load(std::memory_order_relaxed));
+}
+
+long long Network::GetLinesReceived()
+{
+    return static_cast<long long>(this->linesRcvd.load(std::memory_order_relaxed));
+}
+
+long long Network::GetReceiveWakeups()
+{
+    return static_cast<long long>(this->receiveWakeups.load(std::memory_order_relaxed));
+}
+
+NetworkStatistics Network::GetStatistics() const
+{
+    NetworkStatistics statistics;
+    statistics.BytesSent = this->bytesSent.load(std::memory_order_relaxed);
+    statistics.BytesReceived = this->bytesRcvd.load(std::memory_order_relaxed);
+    statistics.LinesSent = this->linesSent.load(std::memory_order_relaxed);
+    statistics.LinesReceived = this->linesRcvd.load(std::memory_order_relaxed);
+    statistics.ReceiveWakeups = this->receiveWakeups.load(std::memory_order_relaxed);
+    statistics.ParseFailures = this->parseFailures.load(std::memory_order_relaxed);
+    statistics.Writes = this->writes.load(std::memory_order_relaxed);
+    for (int slot = 0; slot < NETWORK_STATISTICS_COMMAND_SLOTS; slot++)
+    {
+        unsigned long long count = this->commandsRcvd[slot].load(std::memory_order_relaxed);
+        if (count)
+            statistics.Commands.insert(slot - NETWORK_STATISTICS_COMMAND_OFFSET, count);
+    }
+    unsigned long long unknown = this->unknownCommandsRcvd.load(std::memory_order_relaxed);
+    if (unknown)
+        statistics.Commands.insert(IRC_NUMERIC_INVALID, unknown);
+    for (int priority = 0; priority < 4; priority++)
+        statistics.QueueDepth[priority] = this->queueDepth[priority].load(std::memory_order_relaxed);
+    return statistics;
 }
 
 void Network::_st_ClearChannels()
 {
     qDeleteAll(this->channels);
     this->channels.clear();
+    this->removedChannels.clear();
+    this->channelsResetGeneration = nextGeneration();
+    this->channelIndex.clear();
+    this->userIndex.clear();
 }
 
 Channel *Network::_st_InsertChannel(Channel *channel)
 {
     Channel *cx = new Channel(channel);
     cx->SetNetwork(this);
-    this->channels.append(cx);
+    this->addChannel(cx);
     return cx;
 }
 
@@ -827,7 +1141,7 @@ void Network::OnConnected()
     {
         // IRCv3 protocol is enabled, let's verify if ircd supports it
         this->resetCap();
-        this->capTimeout.start(this->_capGraceTime * 1000);
+        this->capTimeout.Start(this->_capGraceTime * 1000);
         // There is one issue with this command though. For whatever reasons IRCv3 people believe that client should
         // send CAP END to finish negotiation, and unless client does that, it isn't allowed to login to network.
 
@@ -842,48 +1156,54 @@ void Network::OnConnected()
 
 void Network::processIncomingRawData(QByteArray data)
 {
-    this->lastPing = QDateTime::currentDateTime();
-    QString l;
-    switch (this->encoding)
+#if QT_VERSION >= 0x050000
+    if (this->listenersDirty.load(std::memory_order_relaxed) && this->listenersDirty.exchange(false))
+        this->updateListeners();
+#endif
+    this->lastActivity = TimerWheel::GetTime();
+    QByteArray line = data;
+    Encoding parser_encoding = this->encoding;
+    if (this->encoding == EncodingUTF16)
     {
-        case EncodingDefault:
-            l = QString(data);
-            break;
-        case EncodingASCII:
-        case EncodingLatin:
-            l = QString::fromLatin1(data.data());
-            break;
-        case EncodingUTF8:
-            l = QString::fromUtf8(data.data());
-            break;
-        case EncodingUTF16:
+        // UTF-16 can't be split on byte level, so it's converted to UTF-8 first
+        if (!this->decoder)
         {
             #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-            QStringDecoder decoder(QStringDecoder::Encoding::Utf16);
-            l = decoder.decode(data);
+            this->decoder = new QStringDecoder(QStringDecoder::Encoding::Utf16);
             #else
-            l = QTextCodec::codecForName("UTF-16")->toUnicode(data);
+            this->decoder = QTextCodec::codecForName("UTF-16")->makeDecoder();
             #endif
         }
-            break;
-        default:
-            l = QString(data);
-            break;
-    }
-    // let's try to parse this IRC command
-    Parser parser(l);
+        #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        line = QString(this->decoder->decode(data)).toUtf8();
+        #else
+        line = this->decoder->toUnicode(data).toUtf8();
+        #endif
+        parser_encoding = EncodingUTF8;
+    }
+    // let's try to parse this IRC command, the parser works on raw bytes and decodes only what is needed
+    Parser parser(line, parser_encoding);
     if (!parser.IsValid())
     {
-        emit this->Event_Invalid(data);
+        this->parseFailures.fetch_add(1, std::memory_order_relaxed);
+        // data may be only a view into receive buffer, so make a real copy for the signal
+        IRC_EVENT(Event_Invalid, QByteArray(data.constData(), data.size()));
         return;
     }
     bool self_command = false;
-    if (parser.GetSourceUserInfo() != nullptr)
-        self_command = parser.GetSourceUserInfo()->GetNick().toLower() == this->GetNick().toLower();
+    // Key of source is created only once for whole line, so that channels can be searched without folding the nick again
+    NickKey source_key;
+    QString source_nick = parser.GetSourceNick();
+    if (!source_nick.isEmpty())
+    {
+        source_key = this->GetNickKey(source_nick);
+        self_command = source_key == this->localNickKey();
+    }
     // This is a fixup for our own hostname as seen by the server, it may actually change runtime
     // based on cloak mechanisms used by a server, so when it happens we need to update it
     if (self_command && !parser.GetSourceUserInfo()->GetHost().isEmpty() && parser.GetSourceUserInfo()->GetHost() != this->localUser.GetHost())
         this->localUser.SetHost(parser.GetSourceUserInfo()->GetHost());
+    this->countCommand(parser.GetNumeric());
     bool known = true;
     switch (parser.GetNumeric())
     {
@@ -902,9 +1222,16 @@ void Network::processIncomingRawData(QByteArray data)
                 this->server->SetVersion(parser.GetParameters()[2]);
                 this->ChannelModeHelp = NetworkModeHelp::GetChannelModeHelp(this->server->GetVersion());
                 this->UserModeHelp = NetworkModeHelp::GetUserModeHelp(this->server->GetVersion());
+                if (!this->floodControlCustom)
+                {
+                    // Keep the current budget, only the limits change
+                    FloodControl profile = FloodControl::GetProfile(this->server->GetVersion());
+                    this->floodControl.SetBurst(profile.GetBurst());
+                    this->floodControl.SetInterval(profile.GetInterval());
+                }
             }
             this->autoJoin();
-            emit this->Event_MyInfo(&parser);
+            IRC_EVENT(Event_MyInfo, &parser);
             break;
 
         case IRC_NUMERIC_RAW_JOIN:
@@ -916,7 +1243,7 @@ void Network::processIncomingRawData(QByteArray data)
             break;
 
         case IRC_NUMERIC_RAW_NOTICE:
-            emit this->Event_NOTICE(&parser);
+            IRC_EVENT(Event_NOTICE, &parser);
             break;
 
         case IRC_NUMERIC_RAW_NICK:
@@ -925,16 +1252,17 @@ void Network::processIncomingRawData(QByteArray data)
 
         case IRC_NUMERIC_RAW_QUIT:
         {
-            // Remove the user from all channels
-            foreach (Channel *channel, this->channels)
+            // Remove the user from all channels they are in, record is deleted together with last one
+            User *user = this->userIndex.value(source_key, nullptr);
+            if (user)
             {
-                if (channel->ContainsUser(parser.GetSourceUserInfo()->GetNick()))
+                foreach (Channel *channel, user->GetChannels())
                 {
-                    channel->RemoveUser(parser.GetSourceUserInfo()->GetNick());
-                    emit this->Event_PerChannelQuit(&parser, channel);
+                    channel->RemoveUser(source_key);
+                    IRC_EVENT(Event_PerChannelQuit, &parser, channel);
                 }
             }
-            emit this->Event_Quit(&parser);
+            IRC_EVENT(Event_Quit, &parser);
         }   break;
         case IRC_NUMERIC_RAW_PART:
         {
@@ -948,22 +1276,22 @@ void Network::processIncomingRawData(QByteArray data)
             {
                 if (!channel)
                 {
-                    emit this->Event_Broken(&parser, "Channel struct not in memory");
+                    IRC_EVENT(Event_Broken, &parser, "Channel struct not in memory");
                 }
                 else
                 {
-                    emit this->Event_SelfPart(&parser, channel);
-                    this->channels.removeOne(channel);
-                    emit this->Event_Part(&parser, channel);
+                    IRC_EVENT(Event_SelfPart, &parser, channel);
+                    this->removeChannel(channel);
+                    IRC_EVENT(Event_Part, &parser, channel);
                     delete channel;
                     break;
                 }
             }
             else if (channel)
             {
-                channel->RemoveUser(parser.GetSourceUserInfo()->GetNick());
+                channel->RemoveUser(source_key);
             }
-            emit this->Event_Part(&parser, channel);
+            IRC_EVENT(Event_Part, &parser, channel);
         }   break;
         case IRC_NUMERIC_RAW_KICK:
             this->processKick(&parser);
@@ -980,12 +1308,12 @@ void Network::processIncomingRawData(QByteArray data)
             {
                 // The signal is emitted only once we are done with calculations, or in case calculation fails
                 // otherwise it wouldn't be precise enough
-                emit this->Event_PONG(&parser);
+                IRC_EVENT(Event_PONG, &parser);
                 break;
             }
             QDateTime lpdt = QDateTime::fromMSecsSinceEpoch(last_ping);
             this->lastPingResponseTimeInMs = lpdt.msecsTo(QDateTime::currentDateTime());
-            emit this->Event_PONG(&parser);
+            IRC_EVENT(Event_PONG, &parser);
         }
             break;
         case IRC_NUMERIC_RAW_MODE:
@@ -998,61 +1326,61 @@ void Network::processIncomingRawData(QByteArray data)
             this->processNamrpl(&parser);
             break;
         case IRC_NUMERIC_ENDOFNAMES:
-            emit this->Event_EndOfNames(&parser);
+            IRC_EVENT(Event_EndOfNames, &parser);
             break;
         case IRC_NUMERIC_RAW_TOPIC:
             this->processTopic(&parser);
             break;
         case IRC_NUMERIC_WHOISUSER:
-            emit this->Event_WhoisGeneric(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
             this->processWhoisUser(parser);
             break;
         case IRC_NUMERIC_WHOISIDLE:
-            emit this->Event_WhoisGeneric(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
             this->processWhoisIdle(parser);
             break;
         case IRC_NUMERIC_WHOISOPERATOR:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisOperator(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisOperator, &parser);
             break;
         case IRC_NUMERIC_WHOISREGNICK:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisRegNick(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisRegNick, &parser);
             break;
         case IRC_NUMERIC_WHOISCHANNELS:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisChannels(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisChannels, &parser);
             break;
         case IRC_NUMERIC_WHOISSERVER:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisServer(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisServer, &parser);
             break;
         case IRC_NUMERIC_ENDOFWHOIS:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisEnd(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisEnd, &parser);
             break;
         case IRC_NUMERIC_AWAY:
-            emit this->Event_RplAway(&parser);
+            IRC_EVENT(Event_RplAway, &parser);
             break;
         case IRC_NUMERIC_WHOISSECURE:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisSecure(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisSecure, &parser);
             break;
         case IRC_NUMERIC_WHOISSPECIAL:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisSpecial(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisSpecial, &parser);
             break;
         case IRC_NUMERIC_WHOISHOST:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisHost(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisHost, &parser);
             break;
         case IRC_NUMERIC_WHOISMODES:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisModes(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisModes, &parser);
             break;
         case IRC_NUMERIC_WHOISACCOUNT:
-            emit this->Event_WhoisGeneric(&parser);
-            emit this->Event_WhoisAccount(&parser);
+            IRC_EVENT_LISTENED(Listener_WhoisGeneric, Event_WhoisGeneric, &parser);
+            IRC_EVENT(Event_WhoisAccount, &parser);
             break;
         case IRC_NUMERIC_TOPICINFO:
         {
@@ -1064,11 +1392,11 @@ void Network::processIncomingRawData(QByteArray data)
             Channel *channel = this->GetChannel(parser.GetParameters()[1]);
             if (!channel)
             {
-                emit this->Event_Broken(&parser, "Channel struct not in memory");
+                IRC_EVENT(Event_Broken, &parser, "Channel struct not in memory");
                 break;
             }
             channel->SetTopic(parser.GetText());
-            emit this->Event_TOPICInfo(&parser, channel);
+            IRC_EVENT(Event_TOPICInfo, &parser, channel);
         }
             break;
         case IRC_NUMERIC_TOPICWHOTIME:
@@ -1078,20 +1406,20 @@ void Network::processIncomingRawData(QByteArray data)
             this->process433(&parser);
             break;
         case IRC_NUMERIC_MOTD:
-            emit this->Event_MOTD(&parser);
+            IRC_EVENT(Event_MOTD, &parser);
             break;
         case IRC_NUMERIC_MOTDBEGIN:
-            emit this->Event_MOTDBegin(&parser);
+            IRC_EVENT(Event_MOTDBegin, &parser);
             break;
         case IRC_NUMERIC_MOTDEND:
-            emit this->Event_MOTDEnd(&parser);
+            IRC_EVENT(Event_MOTDEnd, &parser);
             break;
         case IRC_NUMERIC_WHOREPLY:
             this->processWho(&parser);
             break;
         case IRC_NUMERIC_ENDOFWHO:
             // 315
-            emit this->Event_EndOfWHO(&parser);
+            IRC_EVENT(Event_EndOfWHO, &parser);
             break;
         case IRC_NUMERIC_MODEINFO:
             this->processMdIn(&parser);
@@ -1100,7 +1428,7 @@ void Network::processIncomingRawData(QByteArray data)
             this->processMTime(&parser);
             break;
         case IRC_NUMERIC_WELCOME:
-            emit this->Event_Welcome(&parser);
+            IRC_EVENT(Event_Welcome, &parser);
             this->loggedIn = true;
             break;
         case IRC_NUMERIC_EXCEPTION:
@@ -1110,18 +1438,20 @@ void Network::processIncomingRawData(QByteArray data)
             this->processPMode(&parser, 'b');
             break;
         case IRC_NUMERIC_ENDOFBANS:
-            emit this->Event_EndOfBans(&parser);
+            IRC_EVENT(Event_EndOfBans, &parser);
             break;
         case IRC_NUMERIC_UNAWAY:
             this->localUser.IsAway = false;
+            this->localUser.MarkChanged("IsAway");
             // Update the status of our own user in every channel
             this->updateSelfAway(&parser, false, "");
-            emit this->Event_UnAway(&parser);
+            IRC_EVENT(Event_UnAway, &parser);
             break;
         case IRC_NUMERIC_NOWAWAY:
             this->localUser.IsAway = true;
+            this->localUser.MarkChanged("IsAway");
             this->updateSelfAway(&parser, true, this->awayMessage);
-            emit this->Event_NowAway(&parser);
+            IRC_EVENT(Event_NowAway, &parser);
             break;
         case IRC_NUMERIC_RAW_CAP:
             this->processCap(&parser);
@@ -1132,9 +1462,9 @@ void Network::processIncomingRawData(QByteArray data)
         case IRC_NUMERIC_ERR_INVALIDCAPCMD:
             // If we are negotiating cap handshake right now, the ircd is clearly broken
             // let's disable it
-            if (this->capTimeout.isActive())
+            if (this->capTimeout.IsActive())
             {
-                this->capTimeout.stop();
+                this->capTimeout.Stop();
                 this->DisableIRCv3Support();
                 // This may not work but we really should finish negotiation right here
                 this->TransferRaw("CAP END");
@@ -1143,27 +1473,27 @@ void Network::processIncomingRawData(QByteArray data)
             break;
         case IRC_NUMERIC_UNKNOWN:
             // If we are negotiating cap handshake, server doesn't support it
-            if (this->capTimeout.isActive())
+            if (this->capTimeout.IsActive())
             {
-                this->capTimeout.stop();
+                this->capTimeout.Stop();
                 this->DisableIRCv3Support();
                 this->standardLogin();
             }
-            emit this->Event_NUMERIC_UNKNOWN(&parser);
+            IRC_EVENT(Event_NUMERIC_UNKNOWN, &parser);
             break;
         case IRC_NUMERIC_NICKISNOTAVAILABLE:
             this->process433(&parser);
             break;
         case IRC_NUMERIC_RAW_INVITE:
-            emit this->Event_INVITE(&parser);
+            IRC_EVENT(Event_INVITE, &parser);
             break;
         default:
             known = false;
             break;
     }
     if (!known)
-        emit this->Event_Unknown(&parser);
-    emit this->Event_Parse(&parser);
+        IRC_EVENT_LISTENED(Listener_Unknown, Event_Unknown, &parser);
+    IRC_EVENT_LISTENED(Listener_Parse, Event_Parse, &parser);
 }
 
 void Network::processNamrpl(Parser *parser)
@@ -1172,14 +1502,14 @@ void Network::processNamrpl(Parser *parser)
     // Server sent us an initial list of users that are in the channel
     if (parser->GetParameters().size() < 3)
     {
-        emit this->Event_Broken(parser, "Malformed NAMRPL");
+        IRC_EVENT(Event_Broken, parser, "Malformed NAMRPL");
         return;
     }
 
     Channel *channel = this->GetChannel(parser->GetParameters()[2]);
     if (channel == NULL)
     {
-        emit this->Event_Broken(parser, "Channel struct not in memory");
+        IRC_EVENT(Event_Broken, parser, "Channel struct not in memory");
         return;
     }
 
@@ -1191,20 +1521,15 @@ void Network::processNamrpl(Parser *parser)
             continue;
         char cumode = this->StartsWithCUPrefix(user);
         QList<char> cumodes;
-        QList<char> prefixes;
         while (cumode != 0)
         {
-            char prefix = user[0].toLatin1();
             cumodes << cumode;
-            prefixes << prefix;
             user = user.mid(1);
             cumode = this->StartsWithCUPrefix(user);
         }
         User ux;
         ux.SetNick(user);
-        ux.CUModes = cumodes;
-        ux.ChannelPrefixes = prefixes;
-        channel->InsertUser(&ux);
+        channel->InsertUser(&ux, cumodes);
     }
 }
 
@@ -1235,39 +1560,53 @@ void Network::processInfo(Parser *parser)
             prefix = prefix.mid(prefix.indexOf(")") + 1);
             if (cu.length() != prefix.length())
                 goto broken_prefix;
-            this->channelUserPrefixes.clear();
-            this->CUModes.clear();
-            foreach (QChar CUMode, cu)
-                this->CUModes.append(CUMode.toLatin1());
-            foreach (QChar pr, prefix)
-                this->channelUserPrefixes.append(pr.toLatin1());
+            this->CUModes = CLFromStr(cu);
+            this->channelUserPrefixes = CLFromStr(prefix);
+            this->MarkChanged("CUModes");
+            this->MarkChanged("channelUserPrefixes");
+            this->updateParameterModes();
 
             continue;
             broken_prefix:
                 qDebug() << "IRC PARSER: broken prefix: " + parser->GetRaw();
                 break;
+        } else if (info.startsWith("CASEMAPPING="))
+        {
+            CaseMapping mapping = CaseMappingFromString(info.mid(12));
+            if (mapping == this->caseMapping)
+                continue;
+            this->caseMapping = mapping;
+            this->MarkChanged("caseMapping");
+            this->localKey = this->GetNickKey(this->localKeyNick);
+            this->indexChannels();
+            foreach (Channel *channel, this->channels)
+                channel->UpdateUserKeys();
+            this->indexUsers();
+            continue;
         } else if (info.startsWith("NETWORK="))
         {
-            this->networkName = info.mid(8);
+            SERIALIZED_SET(networkName, info.mid(8));
             continue;
         } else if (info.startsWith("STATUSMSG="))
         {
             this->STATUSMSG_Modes = CLFromStr(info.mid(10));
+            this->MarkChanged("STATUSMSG_Modes");
         } else if (info.startsWith("CHANMODES="))
         {
             QString input = info.mid(10);
             QList<QString> groups = input.split(',');
             if (groups.count() > 0)
-                this->CPModes = CLFromStr(groups[0]);
+                SERIALIZED_SET(CPModes, CLFromStr(groups[0]));
             if (groups.count() > 1)
-                this->CRModes = CLFromStr(groups[1]);
+                SERIALIZED_SET(CRModes, CLFromStr(groups[1]));
             if (groups.count() > 2)
-                this->CCModes = CLFromStr(groups[2]);
+                SERIALIZED_SET(CCModes, CLFromStr(groups[2]));
             if (groups.count() > 3)
-                this->CModes = CLFromStr(groups[3]);
+                SERIALIZED_SET(CModes, CLFromStr(groups[3]));
+            this->updateParameterModes();
         }
     }
-    emit this->Event_ISUPPORT(parser);
+    IRC_EVENT(Event_ISUPPORT, parser);
 }
 
 void Network::processWho(Parser *parser)
@@ -1310,12 +1649,17 @@ void Network::processWho(Parser *parser)
     if (user->IsAway != is_away)
     {
         user->IsAway = is_away;
-        emit this->Event_UserAwayStatusChange(parser, channel, user);
+        user->MarkChanged("IsAway");
+        IRC_EVENT(Event_UserAwayStatusChange, parser, channel, user);
+    }
+    if (user->ServerName != parameters[4])
+    {
+        user->ServerName = parameters[4];
+        user->MarkChanged("ServerName");
     }
-    user->ServerName = parameters[4];
 
     finish:
-        emit this->Event_WHO(parser, channel, user);
+        IRC_EVENT(Event_WHO, parser, channel, user);
 }
 
 void Network::processPrivMsg(Parser *parser)
@@ -1344,10 +1688,10 @@ void Network::processPrivMsg(Parser *parser)
             parameters = command.mid(command.indexOf(" ") + 1);
             command = command.mid(0, command.indexOf(" "));
         }
-        emit this->Event_CTCP(parser, command, parameters);
+        IRC_EVENT(Event_CTCP, parser, command, parameters);
     } else
     {
-        emit this->Event_PRIVMSG(parser);
+        IRC_EVENT(Event_PRIVMSG, parser);
     }
 }
 
@@ -1362,11 +1706,11 @@ void Network::processMdIn(Parser *parser)
     Channel *channel = this->GetChannel(pl[1]);
     if (!channel)
     {
-        emit this->Event_Broken(parser, "Channel struct not in memory");
+        IRC_EVENT(Event_Broken, parser, "Channel struct not in memory");
         return;
     }
     channel->SetMode(pl[2]);
-    emit this->Event_ModeInfo(parser, channel);
+    IRC_EVENT(Event_ModeInfo, parser, channel);
 }
 
 void Network::processTopic(Parser *parser)
@@ -1379,12 +1723,12 @@ void Network::processTopic(Parser *parser)
     Channel *channel = this->GetChannel(parser->GetParameters()[0]);
     if (!channel)
     {
-        emit this->Event_Broken(parser, "Channel struct not in memory");
+        IRC_EVENT(Event_Broken, parser, "Channel struct not in memory");
         return;
     }
     QString topic = channel->GetTopic();
     channel->SetTopic(parser->GetText());
-    emit this->Event_TOPIC(parser, channel, topic);
+    IRC_EVENT(Event_TOPIC, parser, channel, topic);
 }
 
 void Network::processKick(Parser *parser)
@@ -1394,19 +1738,19 @@ void Network::processKick(Parser *parser)
         qDebug() << "IRC PARSER: Invalid KICK: " + parser->GetRaw();
         return;
     }
-    bool self_command = parser->GetParameters()[1].toLower() == this->GetNick().toLower();
+    bool self_command = this->GetNickKey(parser->GetParameters()[1]) == this->localNickKey();
     Channel *channel = this->GetChannel(parser->GetParameters()[0]);
     if (self_command)
     {
         if (!channel)
         {
-            emit this->Event_Broken(parser, "Channel struct not in memory");
+            IRC_EVENT(Event_Broken, parser, "Channel struct not in memory");
         }
         else
         {
-            emit this->Event_SelfKick(parser, channel);
-            this->channels.removeOne(channel);
-            emit this->Event_Kick(parser, channel);
+            IRC_EVENT(Event_SelfKick, parser, channel);
+            this->removeChannel(channel);
+            IRC_EVENT(Event_Kick, parser, channel);
             delete channel;
             return;
         }
@@ -1415,7 +1759,7 @@ void Network::processKick(Parser *parser)
     {
         channel->RemoveUser(parser->GetParameters()[1]);
     }
-    emit this->Event_Kick(parser, channel);
+    IRC_EVENT(Event_Kick, parser, channel);
 }
 
 void Network::processTopicWhoTime(Parser *parser)
@@ -1429,12 +1773,12 @@ void Network::processTopicWhoTime(Parser *parser)
     Channel *channel = this->GetChannel(parameters[1]);
     if (!channel)
     {
-        emit this->Event_Broken(parser, "Channel struct not in memory");
+        IRC_EVENT(Event_Broken, parser, "Channel struct not in memory");
         return;
     }
     channel->SetTopicUser(parameters[2]);
     channel->SetTopicTime(QDateTime::fromTime_t(parameters[3].toUInt()));
-    emit this->Event_TOPICWhoTime(parser, channel);
+    IRC_EVENT(Event_TOPICWhoTime, parser, channel);
 }
 
 void Network::processPMode(Parser *parser, char mode)
@@ -1445,13 +1789,13 @@ void Network::processPMode(Parser *parser, char mode)
     QList<QString> parameters = parser->GetParameters();
     if (parameters.count() < 5)
     {
-        emit this->Event_Broken(parser, "Invalid PMODE");
+        IRC_EVENT(Event_Broken, parser, "Invalid PMODE");
         return;
     }
     libircclient::Channel *channel = this->GetChannel(parameters[1]);
     if (!channel)
     {
-        emit this->Event_Broken(parser, "Unknown channel");
+        IRC_EVENT(Event_Broken, parser, "Unknown channel");
         return;
     }
     QString string = QString(QChar(mode));
@@ -1460,19 +1804,19 @@ void Network::processPMode(Parser *parser, char mode)
     temp.Parameter = parameters[2];
     temp.SetOn = QDateTime::fromTime_t(parameters[4].toUInt());
     if (channel->SetPMode(temp))
-        emit this->Event_CPMInserted(parser, temp, channel);
-    emit this->Event_PMode(parser, mode);
+        IRC_EVENT(Event_CPMInserted, parser, temp, channel);
+    IRC_EVENT(Event_PMode, parser, mode);
 }
 
 void Network::processMode(Parser *parser)
 {
     if (parser->GetParameters().count() < 1)
     {
-        emit this->Event_Broken(parser, "Invalid mode");
+        IRC_EVENT(Event_Broken, parser, "Invalid mode");
         return;
     }
     QString entity = parser->GetParameters()[0];
-    if (entity.toLower() == this->localUser.GetNick().toLower())
+    if (this->GetNickKey(entity) == this->localNickKey())
     {
         // Someone changed our own UMode
         QString mode = parser->GetText();
@@ -1483,110 +1827,89 @@ void Network::processMode(Parser *parser)
     {
         // Someone changed a channel mode
         // Get a channel first
-        QStringList parameters = parser->GetParameters();
-        Channel *channel = this->GetChannel(parameters[0]);
+        const QList<QString> parameters = parser->GetParameters();
+        Channel *channel = this->GetChannel(parameters.at(0));
         if (channel == nullptr)
         {
-            emit this->Event_Broken(parser, "No channel");
+            IRC_EVENT(Event_Broken, parser, "No channel");
             return;
         }
-        parameters.removeFirst();
-        if (parameters.isEmpty())
+        if (parameters.size() < 2)
         {
-            emit this->Event_Broken(parser, "Invalid mode");
+            IRC_EVENT(Event_Broken, parser, "Invalid mode");
             return;
         }
-        QString mode = parameters[0];
-        parameters.removeFirst();
-        QList<char> parameter_modes = this->ParameterModes();
+        const QString &mode = parameters.at(1);
         Mode new_mode(mode);
         // remove the parameter modes, as we can't apply them to local channel mode
-        new_mode.ResetModes(parameter_modes);
+        new_mode.ResetModes(this->parameterModes);
         channel->SetMode(new_mode.ToString());
-        emit this->Event_ChannelModeChanged(parser, channel);
+        IRC_EVENT(Event_ChannelModeChanged, parser, channel);
         // now that we updated the static mode, we need to update all respective bans, users and similar stuff
-        QList<libirc::SingleMode> modes = libirc::SingleMode::ToModeList(mode, parameters, parameter_modes);
-        foreach (libirc::SingleMode sm, modes)
+        // parameters of modes follow the mode string, +l takes a parameter only when it's being set
+        libirc::ModeIterator sm(mode, parameters, this->parameterModes, this->CCModes, 2);
+        while (sm.Next())
         {
-            if (this->CUModes.contains(sm.Get()))
+            if (this->CUModes.Contains(sm.Get()))
             {
                 // User mode was changed
-                User *user = channel->GetUser(sm.Parameter);
+                NickKey target = this->GetNickKey(sm.GetParameter());
+                User *user = channel->GetUser(target);
                 if (user == nullptr)
                 {
-                    emit this->Event_Broken(parser, "Invalid user");
+                    IRC_EVENT(Event_Broken, parser, "Invalid user");
                     continue;
                 }
                 // User mode was changed, the trick here is that some irc daemons allow users to have multiple modes
                 // so we need to figure if this user mode is higher level mode than mode that user currently posses
-                char current_mode = user->GetHighestCUMode();
+                char current_mode = channel->GetHighestCUMode(target);
                 if (sm.IsIncluding())
                 {
-                    if (!current_mode || !this->CUModes.contains(current_mode) || this->CUModes.indexOf(current_mode) > this->CUModes.indexOf(sm.Get()))
-                    {
-                        // yes this mode is higher, so let's update their current mode and also change their channel symbol
-                        user->CUModes.insert(0, sm.Get());
-                        user->ChannelPrefixes.insert(0, this->channelUserPrefixes[this->CUModes.indexOf(sm.Get())]);
-                        emit this->Event_ChannelUserModeChanged(parser, channel, user);
-                    } else
-                    {
-                        // this mode is not higher but we still want to track it, however we don't know which index it's meant to be
-                        // which we need to figure out first
-                        QList<char> temp = user->CUModes;
-                        temp << sm.Get();
-                        user->CUModes = this->ModeHelper_GetSortedCUModes(temp);
-                        temp = user->ChannelPrefixes;
-                        temp << this->channelUserPrefixes[this->CUModes.indexOf(sm.Get())];
-                        user->ChannelPrefixes = this->ModeHelper_GetSortedChannelPrefixes(temp);
-                        emit this->Event_ChannelUserSubmodeChanged(parser, channel, user);
-                    }
+                    channel->SetUserCUMode(target, sm.Get(), true);
+                    // channel keeps the modes sorted, so we only need to tell if the highest one changed
+                    if (!current_mode || this->CUModes.Rank(current_mode) > this->CUModes.Rank(sm.Get()))
+                        IRC_EVENT(Event_ChannelUserModeChanged, parser, channel, user);
+                    else
+                        IRC_EVENT(Event_ChannelUserSubmodeChanged, parser, channel, user);
                 } else
                 {
                     // The mode is revoked, however that matters only if user actually posses the mode, some irc servers
                     // let you revoke mode of user who never even had it
-                    // so we check if user actually have that
+                    if (!channel->SetUserCUMode(target, sm.Get(), false))
+                        continue;
                     if (sm.Get() == current_mode)
-                    {
-                        //! \todo Some networks allow users to have more than 1 user mode, although they don't easily actually share
-                        //! that information. We should however maintain a list of modes this user posses
-                        user->CUModes.removeAt(0);
-                        user->ChannelPrefixes.removeAt(0);
-                        emit this->Event_ChannelUserModeChanged(parser, channel, user);
-                    }
-                    else if (user->CUModes.contains(sm.Get()))
-                    {
-                        // User mode was changed, but not the highest one
-                        user->ChannelPrefixes.removeAll(this->channelUserPrefixes[this->CUModes.indexOf(sm.Get())]);
-                        user->CUModes.removeAll(sm.Get());
-                        emit this->Event_ChannelUserSubmodeChanged(parser, channel, user);
-                    }
+                        IRC_EVENT(Event_ChannelUserModeChanged, parser, channel, user);
+                    else
+                        IRC_EVENT(Event_ChannelUserSubmodeChanged, parser, channel, user);
                 }
-            } else if (this->CPModes.contains(sm.Get()))
+            } else if (this->CPModes.Contains(sm.Get()))
             {
                 // Ban / Exception / Invite
                 ChannelPMode channel_mode(QString(QChar(sm.Get())));
                 if (parser->GetSourceUserInfo())
                     channel_mode.SetBy = User(parser->GetSourceUserInfo());
                 channel_mode.SetOn = QDateTime::currentDateTime();
-                channel_mode.Parameter = sm.Parameter;
+                channel_mode.Parameter = sm.GetParameter();
                 if (!sm.IsIncluding())
                 {
                     // Remove existing one
                     if (channel->RemovePMode(channel_mode))
-                        emit this->Event_CPMRemoved(parser, channel_mode, channel);
+                        IRC_EVENT(Event_CPMRemoved, parser, channel_mode, channel);
                 } else
                 {
                     if (channel->SetPMode(channel_mode))
-                        emit this->Event_CPMInserted(parser, channel_mode, channel);
+                        IRC_EVENT(Event_CPMInserted, parser, channel_mode, channel);
                 }
             }
         }
+        if (sm.IsBroken())
+            qDebug() << "Invalid mode: " + mode + " missing parameters";
         //! \todo Bans / exemption and others
     } else
     {
         // Someone changed UMode of another user, this is not supported on majority of servers, unless you are services
     }
-    emit this->Event_Mode(parser);
+    IRC_EVENT(Event_Mode, parser);
 }
 
 void Network::processMTime(Parser *parser)
@@ -1594,17 +1917,17 @@ void Network::processMTime(Parser *parser)
     QStringList parameters = parser->GetParameters();
     if (parameters.size() < 3)
     {
-        emit this->Event_Broken(parser, "Invalid MODETIME");
+        IRC_EVENT(Event_Broken, parser, "Invalid MODETIME");
         return;
     }
     Channel *channel = this->GetChannel(parameters[1]);
     if (!channel)
     {
-        emit this->Event_Broken(parser, "Channel struct not in memory");
+        IRC_EVENT(Event_Broken, parser, "Channel struct not in memory");
         return;
     }
     channel->SetMTime(QDateTime::fromTime_t(parameters[2].toUInt()));
-    emit this->Event_CreationTime(parser);
+    IRC_EVENT(Event_CreationTime, parser);
 }
 
 void Network::processJoin(Parser *parser, bool self_command)
@@ -1612,7 +1935,7 @@ void Network::processJoin(Parser *parser, bool self_command)
     Channel *channel_p = nullptr;
     if (parser->GetParameters().count() < 1 && parser->GetText().isEmpty())
     {
-        emit this->Event_Broken(parser, "Malformed JOIN");
+        IRC_EVENT(Event_Broken, parser, "Malformed JOIN");
         return;
     }
     // On some extremely old servers channel is passed as text and on some as parameter
@@ -1622,7 +1945,7 @@ void Network::processJoin(Parser *parser, bool self_command)
         channel_name = parser->GetParameters()[0];
     if (!channel_name.startsWith(this->channelPrefix))
     {
-        emit this->Event_Broken(parser, "Malformed JOIN");
+        IRC_EVENT(Event_Broken, parser, "Malformed JOIN");
         return;
     }
     // Check if the person who joined the channel isn't us
@@ -1636,8 +1959,8 @@ void Network::processJoin(Parser *parser, bool self_command)
         } else
         {
             channel_p = new Channel(channel_name, this);
-            this->channels.append(channel_p);
-            emit this->Event_SelfJoin(channel_p);
+            this->addChannel(channel_p);
+            IRC_EVENT(Event_SelfJoin, channel_p);
         }
     }
     if (!channel_p)
@@ -1655,7 +1978,7 @@ void Network::processJoin(Parser *parser, bool self_command)
         temp->SetRealname(parser->GetText());
     }
     User *user = channel_p->InsertUser(temp);
-    emit this->Event_Join(parser, user, channel_p);
+    IRC_EVENT(Event_Join, parser, user, channel_p);
 }
 
 void Network::processNick(Parser *parser, bool self_command)
@@ -1685,12 +2008,16 @@ void Network::processNick(Parser *parser, bool self_command)
     {
         // our own nick was changed
         this->localUser.SetNick(new_nick);
-        emit this->Event_SelfNICK(parser, old_nick, new_nick);
+        IRC_EVENT_LISTENED(Listener_SelfNICK, Event_SelfNICK, parser, old_nick, new_nick);
     }
     // Change the nicks in every channel this user is in
-    foreach (Channel *channel, this->channels)
-        channel->ChangeNick(old_nick, new_nick);
-    emit this->Event_NICK(parser, old_nick, new_nick);
+    User *user = this->userIndex.value(this->GetNickKey(old_nick), nullptr);
+    if (user)
+    {
+        foreach (Channel *channel, user->GetChannels())
+            channel->ChangeNick(old_nick, new_nick);
+    }
+    IRC_EVENT_LISTENED(Listener_NICK, Event_NICK, parser, old_nick, new_nick);
 }
 
 void Network::processAway(Parser *parser, bool self_command)
@@ -1700,22 +2027,20 @@ void Network::processAway(Parser *parser, bool self_command)
     if (self_command)
     {
         this->localUser.IsAway = is_away;
+        this->localUser.MarkChanged("IsAway");
     }
-    // Update away status for every user in every channel
-    foreach (Channel *channel, this->channels)
+    // Update away status of user, the record is shared by all channels they are in
+    User *user = this->userIndex.value(this->GetNickKey(parser->GetSourceNick()), nullptr);
+    if (user && user->IsAway != is_away)
     {
-        if (channel->ContainsUser(parser->GetSourceUserInfo()->GetNick()))
-        {
-            User *user = channel->GetUser(parser->GetSourceUserInfo()->GetNick());
-            if (user->IsAway != is_away)
-            {
-                user->IsAway = is_away;
-                user->AwayMs = message;
-                emit this->Event_UserAwayStatusChange(parser, channel, user);
-            }
-        }
+        user->IsAway = is_away;
+        user->AwayMs = message;
+        user->MarkChanged("IsAway");
+        user->MarkChanged("AwayMs");
+        foreach (Channel *channel, user->GetChannels())
+            IRC_EVENT(Event_UserAwayStatusChange, parser, channel, user);
     }
-    emit this->Event_AWAY(parser);
+    IRC_EVENT(Event_AWAY, parser);
 }
 
 void Network::processCap(Parser *parser)
@@ -1723,11 +2048,11 @@ void Network::processCap(Parser *parser)
     QStringList params = parser->GetParameters();
     if (params.size() < 2)
     {
-        emit this->Event_Broken(parser, "Wrong number of parameters for CAP message");
+        IRC_EVENT(Event_Broken, parser, "Wrong number of parameters for CAP message");
         return;
     }
     // Obviously this network is supporting IRCv3
-    this->capTimeout.stop();
+    this->capTimeout.Stop();
     if (!this->SupportsIRCv3())
         this->EnableIRCv3Support();
     QString cap = params[1].toUpper();
@@ -1739,6 +2064,7 @@ void Network::processCap(Parser *parser)
             this->capProcessingMultilineLS = false;
         // List of supported caps
         this->_capabilitiesSupported = Generic::UniqueMerge(this->_capabilitiesSupported, parser->GetText().split(" "));
+        this->MarkChanged("_capabilitiesSupported");
         if (!this->capProcessingMultilineLS && !this->capAutoRequestFinished)
             this->processAutoCap();
     } else if (cap == "ACK" || cap == "NAK")
@@ -1746,11 +2072,12 @@ void Network::processCap(Parser *parser)
         if (cap == "ACK")
         {
             this->_capabilitiesSubscribed = Generic::UniqueMerge(this->_capabilitiesSubscribed, parser->GetText().split(" "));
-            emit this->Event_CAP_ACK(parser);
+            this->MarkChanged("_capabilitiesSubscribed");
+            IRC_EVENT(Event_CAP_ACK, parser);
         }
         else
         {
-            emit this->Event_CAP_NAK(parser);
+            IRC_EVENT(Event_CAP_NAK, parser);
         }
 
         // We don't really care if server approved or rejected the change, we just continue here
@@ -1767,7 +2094,7 @@ void Network::processCap(Parser *parser)
             }
         }
     }
-    emit this->Event_CAP(parser);
+    IRC_EVENT(Event_CAP, parser);
 }
 
 void Network::processWhoisUser(Parser &parser)
@@ -1782,7 +2109,7 @@ void Network::processWhoisUser(Parser &parser)
         user.SetHost(parameters[3]);
     }
     user.SetRealname(parser.GetText());
-    emit this->Event_WhoisUser(&parser, &user);
+    IRC_EVENT(Event_WhoisUser, &parser, &user);
 }
 
 void Network::processWhoisIdle(Parser &parser)
@@ -1793,14 +2120,14 @@ void Network::processWhoisIdle(Parser &parser)
 
     if (parameters.count() < 4)
     {
-        emit this->Event_WhoisIdle(&parser, idle_time, signon_time);
+        IRC_EVENT(Event_WhoisIdle, &parser, idle_time, signon_time);
         return;
     }
 
     idle_time = parameters[2].toUInt();
     signon_time = QDateTime::fromTime_t(parameters[3].toUInt());
 
-    emit this->Event_WhoisIdle(&parser, idle_time, signon_time);
+    IRC_EVENT(Event_WhoisIdle, &parser, idle_time, signon_time);
 }
 
 void Network::processChangeHost(Parser &parser)
@@ -1819,17 +2146,21 @@ void Network::processChangeHost(Parser &parser)
     old_host = parser.GetSourceUserInfo()->GetHost();
     nick = parser.GetSourceUserInfo()->GetNick();
 
-    if (nick.toLower() == this->GetNick().toLower())
+    if (this->GetNickKey(nick) == this->localNickKey())
     {
         // our own hostname / ident was changed
         this->localUser.SetIdent(new_ident);
         this->localUser.SetHost(new_host);
-        emit this->Event_SelfCHGHOST(&parser, old_host, old_ident, new_host, new_ident);
+        IRC_EVENT_LISTENED(Listener_SelfCHGHOST, Event_SelfCHGHOST, &parser, old_host, old_ident, new_host, new_ident);
     }
-    // Change the hosts in every channel this user is in
-    foreach (Channel *channel, this->channels)
-        channel->ChangeHost(nick, new_host, new_ident);
-    emit this->Event_CHGHOST(&parser, old_host, old_ident, new_host, new_ident);
+    // Change the host of user, the record is shared by all channels they are in
+    User *user = this->userIndex.value(this->GetNickKey(nick), nullptr);
+    if (user)
+    {
+        user->SetIdent(new_ident);
+        user->SetHost(new_host);
+    }
+    IRC_EVENT_LISTENED(Listener_CHGHOST, Event_CHGHOST, &parser, old_host, old_ident, new_host, new_ident);
 }
 
 void Network::standardLogin()
@@ -1839,21 +2170,17 @@ void Network::standardLogin()
     this->_loggedIn = true;
     this->TransferRaw("USER " + this->localUser.GetIdent() + " 8 * :" + this->localUser.GetRealname());
     this->TransferRaw("NICK " + this->localUser.GetNick());
-    this->lastPing = QDateTime::currentDateTime();
-    this->timerPingSend = new QTimer(this);
-    connect(this->timerPingSend, SIGNAL(timeout()), this, SLOT(OnPingSend()));
-    this->timerPingTimeout = new QTimer(this);
-    this->timerPingSend->start(this->pingRate);
-    connect(this->timerPingTimeout, SIGNAL(timeout()), this, SLOT(OnPing()));
-    this->timerPingTimeout->start(2000);
-    emit this->Event_Connected();
+    this->lastActivity = TimerWheel::GetTime();
+    this->timerPingSend.Start(this->pingRate);
+    this->timerPingTimeout.StartAt(this->lastActivity + static_cast<qint64>(this->pingTimeout) * 1000);
+    IRC_EVENT0(Event_Connected);
 }
 
 void Network::process433(Parser *parser)
 {
     if (this->loggedIn)
     {
-        emit this->Event_NickCollision(parser);
+        IRC_EVENT(Event_NickCollision, parser);
         return;
     }
     // Try to get some alternative nick
@@ -1875,31 +2202,35 @@ void Network::process433(Parser *parser)
         this->RequestNick(this->alternateNick);
         this->localUser.SetNick(this->alternateNick);
     }
-    emit this->Event_NickCollision(parser);
+    IRC_EVENT(Event_NickCollision, parser);
 }
 
 void Network::deleteTimers()
 {
-    if (this->timerPingSend)
-    {
-        this->timerPingSend->stop();
-        this->timerPingSend->deleteLater();
-        this->timerPingSend = nullptr;
-    }
-    if (this->timerPingTimeout)
-    {
-        this->timerPingTimeout->stop();
-        this->timerPingTimeout->deleteLater();
-        this->timerPingTimeout = nullptr;
-    }
-    this->capTimeout.stop();
-    this->senderTimer.stop();
+    this->timerPingSend.Stop();
+    this->timerPingTimeout.Stop();
+    this->capTimeout.Stop();
+    this->senderTimer.Stop();
 }
 
 void Network::initialize()
 {
     this->bytesSent = 0;
     this->bytesRcvd = 0;
+    this->linesSent = 0;
+    this->linesRcvd = 0;
+    this->receiveWakeups = 0;
+    this->parseFailures = 0;
+    this->writes = 0;
+    this->sendBufferLines = 0;
+    for (int slot = 0; slot < NETWORK_STATISTICS_COMMAND_SLOTS; slot++)
+        this->commandsRcvd[slot] = 0;
+    this->unknownCommandsRcvd = 0;
+    for (int priority = 0; priority < 4; priority++)
+        this->queueDepth[priority] = 0;
+    this->receivePending = 0;
+    this->receiveGeneration = 0;
+    this->receiving = false;
     this->_loggedIn = false;
     this->socket = nullptr;
     this->resetCap();
@@ -1908,12 +2239,12 @@ void Network::initialize()
     this->localUser.SetIdent("libirc");
     this->localUser.SetRealname("https://github.com/grumpy-irc/libirc");
     this->pingTimeout = 60;
-    this->timerPingTimeout = nullptr;
-    this->timerPingSend = nullptr;
+    this->lastActivity = 0;
     this->scheduling = true;
     this->pingRate = 20000;
     this->defaultQuit = "GrumpyChat libirc: https://github.com/grumpy-irc/libirc";
     this->channelPrefix = '#';
+    this->caseMapping = CaseMappingRFC1459;
     this->autoRejoin = false;
     this->identifyString = "PRIVMSG NickServ identify $nickname $password";
     this->alternateNickNumber = 0;
@@ -1922,30 +2253,41 @@ void Network::initialize()
     this->ResolveOnNickConflicts = true;
     this->loggedIn = false;
     // This is overriden for every server that is following IRC standards
-    this->channelUserPrefixes << '~' << '&' << '@' << '%' << '+';
-    this->CUModes << 'q' << 'a' << 'o' << 'h' << 'v';
-    this->CModes << 'i' << 'm';
-    this->STATUSMSG_Modes << '@' << '+';
-    connect(&this->capTimeout, SIGNAL(timeout()), this, SLOT(OnCapSupportTimeout()));
-    connect(&this->senderTimer, SIGNAL(timeout()), this, SLOT(OnSend()));
+    this->channelUserPrefixes = QList<char>() << '~' << '&' << '@' << '%' << '+';
+    this->CUModes = QList<char>() << 'q' << 'a' << 'o' << 'h' << 'v';
+    this->CModes = QList<char>() << 'i' << 'm';
+    this->STATUSMSG_Modes = QList<char>() << '@' << '+';
+    this->updateParameterModes();
+    // Timers are driven by wheel of thread, so that thousands of networks don't need thousands of OS timers
+    this->capTimeout.SetCallback([this] { this->OnCapSupportTimeout(); });
+    this->senderTimer.SetCallback([this] { this->OnSend(); });
+    this->timerPingTimeout.SetCallback([this] { this->OnPing(); });
+    this->timerPingSend.SetCallback([this] { this->OnPingSend(); });
     this->ChannelModeHelp = NetworkModeHelp::GetChannelModeHelp("unknown");
-    this->MSDelayOnEmpty = 300;
-    this->MSDelayOnOpen = 2000;
-    this->MSWait = 800;
-    this->senderTime = QDateTime::currentDateTime();
+    this->floodControlCustom = false;
+    this->senderWakeupPending = false;
 }
 
 void Network::freemm()
 {
     qDeleteAll(this->channels);
     this->channels.clear();
+    this->removedChannels.clear();
+    this->channelsResetGeneration = nextGeneration();
+    this->channelIndex.clear();
+    this->userIndex.clear();
     qDeleteAll(this->users);
     this->users.clear();
-    this->mutex.lock();
-    this->lprFIFO.clear();
-    this->mprFIFO.clear();
-    this->hprFIFO.clear();
-    this->mutex.unlock();
+    // Pop the items one by one so that depth stays right even if some producer is pushing right now
+    QByteArray item;
+    while (this->rtFIFO.Pop(item))
+        this->queueDepth[Priority_RealTime].fetch_sub(1, std::memory_order_relaxed);
+    while (this->lprFIFO.Pop(item))
+        this->queueDepth[Priority_Low].fetch_sub(1, std::memory_order_relaxed);
+    while (this->mprFIFO.Pop(item))
+        this->queueDepth[Priority_Normal].fetch_sub(1, std::memory_order_relaxed);
+    while (this->hprFIFO.Pop(item))
+        this->queueDepth[Priority_High].fetch_sub(1, std::memory_order_relaxed);
 }
 
 void Network::resetCap()
@@ -1957,6 +2299,9 @@ void Network::resetCap()
     this->_capabilitiesSubscribed.clear();
     this->_capabilitiesSupported.clear();
     this->_capabilitiesRequested << "away-notify" << "extended-join" << "multi-prefix" << "chghost" << "server-time";
+    this->MarkChanged("_capabilitiesRequested");
+    this->MarkChanged("_capabilitiesSubscribed");
+    this->MarkChanged("_capabilitiesSupported");
 }
 
 void Network::processAutoCap()
@@ -1976,7 +2321,7 @@ void Network::processAutoCap()
     {
         if (!this->HasCap(capability))
         {
-            emit this->Event_CAP_RequestedCapNotSupported(capability);
+            IRC_EVENT(Event_CAP_RequestedCapNotSupported, capability);
             continue;
         }
         // Request the capability
@@ -1998,85 +2343,300 @@ void Network::processAutoCap()
 
 void Network::scheduleDelivery(const QByteArray &data, libircclient::Priority priority)
 {
-    if (priority == Priority_RealTime)
-    {
-        if (!this->socket)
-            return;
-        this->bytesSent += data.size();
-        this->socket->write(data);
-        this->socket->flush();
-        return;
-    }
-    this->mutex.lock();
+    // Depth is raised first, so that it's never lower than what consumer can see in the queue
+    this->queueDepth[priority].fetch_add(1, std::memory_order_relaxed);
     switch (priority)
     {
+        case Priority_RealTime:
+            // Real time lines skip flood control, but they are still written together with other lines
+            // that were queued during same event loop iteration
+            this->rtFIFO.Push(data);
+            this->wakeSender(true);
+            return;
         case Priority_High:
-            this->hprFIFO.append(data);
+            this->hprFIFO.Push(data);
             break;
         case Priority_Normal:
-            this->mprFIFO.append(data);
+            this->mprFIFO.Push(data);
             break;
         case Priority_Low:
-            this->lprFIFO.append(data);
-            break;
-        // This will never happen because we already handled this priority level in top of this
-        // it's here just to silence clang
-        case Priority_RealTime:
+            this->lprFIFO.Push(data);
             break;
     }
-    this->mutex.unlock();
+    this->wakeSender(false);
 }
 
-void Network::autoJoin()
+void Network::appendOutgoing(const QByteArray &data)
 {
-    while(!this->channelsToJoin.isEmpty())
+    this->sendBuffer.append(data);
+    this->sendBufferLines++;
+}
+
+void Network::flushOutgoing()
+{
+    if (!this->socket || this->sendBuffer.isEmpty())
+        return;
+    this->bytesSent.fetch_add(static_cast<unsigned long long>(this->sendBuffer.size()), std::memory_order_relaxed);
+    this->linesSent.fetch_add(static_cast<unsigned long long>(this->sendBufferLines), std::memory_order_relaxed);
+    this->writes.fetch_add(1, std::memory_order_relaxed);
+    this->socket->write(this->sendBuffer);
+    // resize keeps the allocated memory, so that buffer doesn't need to grow again for next batch
+    this->sendBuffer.resize(0);
+    this->sendBufferLines = 0;
+    // Writing to socket may result in error that closes it
+    if (this->socket)
+        this->socket->flush();
+}
+
+void Network::wakeSender(bool immediately)
+{
+    // Timer can be only started from thread that owns it, flood control is also accessed only from there.
+    // Queued call runs once control returns to event loop, so all lines that are queued until then are written at once
+    if (immediately || QThread::currentThread() != this->thread())
     {
-        this->RequestJoin(this->channelsToJoin.at(0), Priority_Low);
-        this->channelsToJoin.removeAt(0);
+        // Only the first producer posts the event, the rest of them will be handled by same OnSend
+        if (!this->senderWakeupPending.exchange(true, std::memory_order_acq_rel))
+            QMetaObject::invokeMethod(this, "OnSend", Qt::QueuedConnection);
+        return;
     }
+    if (!this->senderTimer.IsActive())
+        this->senderTimer.Start(this->floodControl.GetDelay());
 }
 
-void Network::OnSend()
+CaseMapping Network::GetCaseMapping() const
 {
-    if (QDateTime::currentDateTime() < this->senderTime)
-        return;
-    if (!this->socket)
+    return this->caseMapping;
+}
+
+NickKey Network::GetNickKey(const QString &nick) const
+{
+    return NickKey(nick, this->caseMapping);
+}
+
+const NickKey &Network::localNickKey()
+{
+    // Nick of local user is changed from many places, so instead of updating it everywhere we just check if it's same
+    QString nick = this->localUser.GetNick();
+    if (nick != this->localKeyNick || this->localKey.IsEmpty())
+    {
+        this->localKeyNick = nick;
+        this->localKey = this->GetNickKey(nick);
+    }
+    return this->localKey;
+}
+
+void Network::addChannel(Channel *channel)
+{
+    this->channels.append(channel);
+    this->channelIndex.insert(this->GetNickKey(channel->GetName()), channel);
+    this->removedChannels.remove(channel->GetName());
+    channel->shareUsers();
+}
+
+void Network::removeChannel(Channel *channel)
+{
+    this->channels.removeOne(channel);
+    this->channelIndex.remove(this->GetNickKey(channel->GetName()));
+    this->removedChannels.insert(channel->GetName(), nextGeneration());
+}
+
+#if QT_VERSION >= 0x050000
+//! Returns signal of event from Listener with given bit
+static QMetaMethod listenerSignal(int index)
+{
+    switch (index)
+    {
+        case 0:
+            return QMetaMethod::fromSignal(&Network::Event_RawIncoming);
+        case 1:
+            return QMetaMethod::fromSignal(&Network::Event_RawOutgoing);
+        case 2:
+            return QMetaMethod::fromSignal(&Network::Event_Parse);
+        case 3:
+            return QMetaMethod::fromSignal(&Network::Event_Unknown);
+        case 4:
+            return QMetaMethod::fromSignal(&Network::Event_WhoisGeneric);
+        case 5:
+            return QMetaMethod::fromSignal(&Network::Event_NICK);
+        case 6:
+            return QMetaMethod::fromSignal(&Network::Event_SelfNICK);
+        case 7:
+            return QMetaMethod::fromSignal(&Network::Event_CHGHOST);
+        case 8:
+            return QMetaMethod::fromSignal(&Network::Event_SelfCHGHOST);
+    }
+    return QMetaMethod();
+}
+
+static int listenerIndex(const QMetaMethod &signal)
+{
+    for (int index = 0; index < NETWORK_LISTENER_COUNT; index++)
+    {
+        if (signal == listenerSignal(index))
+            return index;
+    }
+    return -1;
+}
+
+// Qt may call these while it holds its own locks and no QObject function may be called from them, not even
+// isSignalConnected(), so we only count the connections of signals we care about
+void Network::connectNotify(const QMetaMethod &signal)
+{
+    int index = listenerIndex(signal);
+    if (index < 0)
         return;
-    QByteArray packet = this->getDataToSend();
-    if (packet.isEmpty())
+    this->listenersLock.lock();
+    if (this->listenerConnections[index]++ == 0)
+        this->listeners.fetch_or(1u << index, std::memory_order_relaxed);
+    this->listenersLock.unlock();
+}
+
+void Network::disconnectNotify(const QMetaMethod &signal)
+{
+    // Invalid signal means that everything was disconnected at once, connections are counted again later
+    if (!signal.isValid())
     {
-        //this->pseudoSleep(this->MSDelayOnEmpty);
+        this->listenersDirty.store(true, std::memory_order_relaxed);
         return;
     }
-    //QString line(packet);
-    this->bytesSent += packet.size();
-    this->socket->write(packet);
-    this->socket->flush();
-    this->pseudoSleep(this->MSWait);
+    int index = listenerIndex(signal);
+    if (index < 0)
+        return;
+    this->listenersLock.lock();
+    if (this->listenerConnections[index] > 0 && --this->listenerConnections[index] == 0)
+        this->listeners.fetch_and(~(1u << index), std::memory_order_relaxed);
+    this->listenersLock.unlock();
 }
+#endif
 
-void Network::pseudoSleep(unsigned int msec)
+void Network::SetEventHandler(IRCEventHandler *handler)
 {
-    this->senderTime = QDateTime::currentDateTime().addMSecs(msec);
+    this->eventHandler = handler;
 }
 
-QByteArray Network::getDataToSend()
+IRCEventHandler *Network::GetEventHandler() const
 {
-    QByteArray item;
-    this->mutex.lock();
-    if (!this->hprFIFO.empty())
+    return this->eventHandler;
+}
+
+IRCEventHandler *Network::getEventHandler() const
+{
+    return this->eventHandler ? this->eventHandler : IRCEventHandler::EventHandler;
+}
+
+void Network::updateListeners()
+{
+#if QT_VERSION >= 0x050000
+    // Receivers are counted before taking the lock, because Qt takes its own locks in receivers() and connectNotify()
+    // is called with them held
+    int connections[NETWORK_LISTENER_COUNT];
+    for (int index = 0; index < NETWORK_LISTENER_COUNT; index++)
+    {
+        QByteArray signature = QByteArray("2") + listenerSignal(index).methodSignature();
+        connections[index] = this->receivers(signature.constData());
+    }
+    unsigned int listeners = 0;
+    this->listenersLock.lock();
+    for (int index = 0; index < NETWORK_LISTENER_COUNT; index++)
+    {
+        this->listenerConnections[index] = connections[index];
+        if (connections[index] > 0)
+            listeners |= 1u << index;
+    }
+    this->listeners.store(listeners, std::memory_order_relaxed);
+    this->listenersLock.unlock();
+#endif
+}
+
+void Network::updateParameterModes()
+{
+    this->parameterModes = this->CUModes.GetSet() | this->CRModes | this->CPModes;
+}
+
+void Network::indexUsers()
+{
+    this->userIndex.clear();
+    foreach (Channel *channel, this->channels)
+    {
+        for (int slot = 0; slot < channel->GetUserSlotCount(); slot++)
+        {
+            User *user = channel->GetUserAt(slot);
+            if (user)
+                this->userIndex.insert(this->GetNickKey(user->GetNick()), user);
+        }
+    }
+}
+
+void Network::indexChannels()
+{
+    this->channelIndex.clear();
+    this->channelIndex.reserve(this->channels.size());
+    foreach (Channel *channel, this->channels)
+        this->channelIndex.insert(this->GetNickKey(channel->GetName()), channel);
+}
+
+FloodControl Network::GetFloodControl() const
+{
+    return this->floodControl;
+}
+
+void Network::SetFloodControl(const FloodControl &flood_control)
+{
+    this->floodControlCustom = true;
+    this->floodControl = flood_control;
+}
+
+void Network::countCommand(int numeric)
+{
+    int slot = numeric + NETWORK_STATISTICS_COMMAND_OFFSET;
+    if (slot >= 0 && slot < NETWORK_STATISTICS_COMMAND_SLOTS)
+        this->commandsRcvd[slot].fetch_add(1, std::memory_order_relaxed);
+    else
+        this->unknownCommandsRcvd.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Network::autoJoin()
+{
+    while(!this->channelsToJoin.isEmpty())
     {
-        item = this->hprFIFO.first();
-        this->hprFIFO.removeFirst();
-    } else if (!this->mprFIFO.empty())
+        this->RequestJoin(this->channelsToJoin.at(0), Priority_Low);
+        this->channelsToJoin.removeAt(0);
+    }
+}
+
+void Network::OnSend()
+{
+    this->senderWakeupPending.store(false, std::memory_order_release);
+    if (!this->socket)
+        return;
+    QByteArray packet;
+    while (this->rtFIFO.Pop(packet))
     {
-        item = this->mprFIFO.first();
-        this->mprFIFO.removeFirst();
-    } else if (!this->lprFIFO.empty())
+        this->queueDepth[Priority_RealTime].fetch_sub(1, std::memory_order_relaxed);
+        this->appendOutgoing(packet);
+    }
+    // Gather as much as flood control lets us, write it at once and then sleep until there is budget for next line
+    while (this->floodControl.GetDelay() == 0)
     {
-        item = this->lprFIFO.first();
-        this->lprFIFO.removeFirst();
+        packet = this->getDataToSend();
+        if (packet.isEmpty())
+            break;
+        this->floodControl.TryConsume();
+        this->appendOutgoing(packet);
     }
-    this->mutex.unlock();
+    this->flushOutgoing();
+    if (this->socket && this->queueDepth[Priority_High] + this->queueDepth[Priority_Normal] + this->queueDepth[Priority_Low] > 0)
+        this->senderTimer.Start(this->floodControl.GetDelay());
+}
+
+QByteArray Network::getDataToSend()
+{
+    QByteArray item;
+    if (this->hprFIFO.Pop(item))
+        this->queueDepth[Priority_High].fetch_sub(1, std::memory_order_relaxed);
+    else if (this->mprFIFO.Pop(item))
+        this->queueDepth[Priority_Normal].fetch_sub(1, std::memory_order_relaxed);
+    else if (this->lprFIFO.Pop(item))
+        this->queueDepth[Priority_Low].fetch_sub(1, std::memory_order_relaxed);
     return item;
 }
@@ -15,9 +15,16 @@
 
 #include "../libirc/network.h"
 #include "priority.h"
+#include "encoding.h"
 #include "user.h"
 #include "mode.h"
+#include "networkstatistics.h"
+#include "floodcontrol.h"
+#include "mpscqueue.h"
+#include "casemapping.h"
+#include <atomic>
 #include <QList>
+#include <QMutex>
 #include <QString>
 #include <QDateTime>
 #include <QSslSocket>
@@ -25,10 +32,16 @@
 #include <QAbstractSocket>
 #include <QTcpSocket>
 #include <QTimer>
+#include "timerwheel.h"
 #include "libircclient_global.h"
 #include "../libirc/irc_standards.h"
 
 class QTcpSocket;
+#if QT_VERSION >= 0x060000
+class QStringDecoder;
+#else
+class QTextDecoder;
+#endif
 
 #ifndef ETIMEDOUT
 #define ETIMEDOUT     10
@@ -43,34 +56,46 @@ namespace libirc
 
 namespace libircclient
 {
-    enum Encoding
-    {
-        // Default by Qt
-        EncodingDefault = 0,
-        EncodingASCII = 1,
-        EncodingUTF8 = 2,
-        EncodingUTF16 = 3,
-        //EncodingUTF32 = 4,
-        EncodingLatin = 5
-    };
-
     class Server;
     class Channel;
     class Parser;
+    class IRCEventHandler;
+
+    /*!
+     * \brief Events that network emits only when something is connected to them
+     *
+     * These are emitted for many or all lines received from server, so when nothing listens to them network doesn't
+     * even create their parameters, see Network::HasListener()
+     */
+    enum Listener
+    {
+        Listener_RawIncoming = 1 << 0,
+        Listener_RawOutgoing = 1 << 1,
+        Listener_Parse = 1 << 2,
+        Listener_Unknown = 1 << 3,
+        Listener_WhoisGeneric = 1 << 4,
+        Listener_NICK = 1 << 5,
+        Listener_SelfNICK = 1 << 6,
+        Listener_CHGHOST = 1 << 7,
+        Listener_SelfCHGHOST = 1 << 8
+    };
+
+    //! Number of events in Listener
+    #define NETWORK_LISTENER_COUNT 9
 
     class LIBIRCCLIENTSHARED_EXPORT Network : public libirc::Network
     {
         Q_OBJECT
 
         public:
-            friend class Network_SenderThread;
+            friend class Channel;
 
             Network(libirc::ServerAddress &server, const QString &name, const Encoding &enc = EncodingDefault);
             Network(const QHash<QString, QVariant> &hash);
              ~Network() override;
-            virtual void Connect();
-            virtual void Reconnect();
-            virtual void Disconnect(QString reason = "");
+            Q_INVOKABLE virtual void Connect();
+            Q_INVOKABLE virtual void Reconnect();
+            Q_INVOKABLE virtual void Disconnect(QString reason = "");
             bool IsAway() const;
             virtual bool IsConnected();
             virtual void SetAway(bool away, const QString &message = "");
@@ -92,7 +117,13 @@ namespace libircclient
             virtual QString GetHelpForMode(char mode, QString missing);
             virtual Channel *GetChannel(QString channel_name);
             virtual QList<Channel *> GetChannels();
+            //! Returns user who is in some of channels we are in, this record is shared by all these channels
+            User *GetUser(const QString &nick);
             virtual Encoding GetEncoding();
+            //! Returns case mapping announced by server in ISUPPORT, rfc1459 if it wasn't announced
+            CaseMapping GetCaseMapping() const;
+            //! Folds the nick (or channel name) using case mapping of this network, keys can be compared instead of calling toLower()
+            NickKey GetNickKey(const QString &nick) const;
             virtual void SetPassword(const QString &Password);
             virtual void RequestJoin(const QString &name, Priority priority = Priority_Normal);
             virtual void TransferRaw(QString raw, Priority priority = Priority_Normal);
@@ -129,6 +160,22 @@ namespace libircclient
             virtual long long GetLag();
             virtual long long GetBytesSent();
             virtual long long GetBytesReceived();
+            long long GetLinesReceived();
+            //! Returns how many times the socket woke us up with new data, together with bytes and lines received it
+            //! tells how many lines and bytes are processed per wakeup
+            long long GetReceiveWakeups();
+            //! Returns a copy of all traffic counters, this doesn't lock anything and can be called from any thread
+            NetworkStatistics GetStatistics() const;
+            FloodControl GetFloodControl() const;
+            //! Changes how fast are queued lines sent to server, once this is called the limits are no longer
+            //! picked automatically based on ircd we connect to
+            void SetFloodControl(const FloodControl &flood_control);
+            //! Returns true if something is connected to signal of this event, with Qt 4 this is always true
+            bool HasListener(Listener listener) const { return (this->listeners.load(std::memory_order_relaxed) & listener) != 0; }
+            //! Sets handler that receives all events of this network through virtual calls, see IRCEventHandler,
+            //! network doesn't take ownership of it. Pass nullptr to use the global IRCEventHandler::EventHandler.
+            void SetEventHandler(IRCEventHandler *handler);
+            IRCEventHandler *GetEventHandler() const;
             //////////////////////////////////////////////////////////////////////////////////////////
             // Synchronization tools
             //! This will update the nick in operating memory, it will not request it from server and may cause troubles
@@ -178,6 +225,15 @@ namespace libircclient
             QList<char> ParameterModes();
             void LoadHash(const QHash<QString, QVariant> &hash) override;
             QHash<QString, QVariant> ToHash() override;
+            /*!
+             * \brief ToDelta returns changes made after given generation, changed channels are included as their own deltas
+             *
+             * Besides changed fields of network the hash may contain "channels" (complete list, when channel list was
+             * cleared by _st_ClearChannels()), "newChannels" (complete hashes of channels joined since), "channelDeltas"
+             * (deltas of other channels by name) and "removedChannels" (names of channels that were left).
+             */
+            QHash<QString, QVariant> ToDelta(quint64 since_generation) override;
+            void ApplyDelta(const QHash<QString, QVariant> &delta) override;
             //! This will automatically fix your own identification data in case they change
             //! For example if server changes your hostname (cloak) system will recognize
             //! the change and update localUser accordingly.
@@ -314,7 +370,17 @@ namespace libircclient
             virtual void OnPingSend();
             virtual void OnCapSupportTimeout();
 
+        private slots:
+            //! Starts timers that were suspended when network was moved to another thread
+            void resumeTimers();
+
         protected:
+            bool event(QEvent *event) override;
+#if QT_VERSION >= 0x050000
+            void connectNotify(const QMetaMethod &signal) override;
+            void disconnectNotify(const QMetaMethod &signal) override;
+#endif
+            void writeBinaryFields(libirc::BinaryWriter &writer) override;
             virtual void OnReceive(const QByteArray &data);
             virtual void closeError(const QString &error, int code);
             bool usingSSL;
@@ -364,47 +430,109 @@ namespace libircclient
             void freemm();
             void resetCap();
             void processAutoCap();
-            void pseudoSleep(unsigned int msec);
+            //! Makes sure OnSend will run, if immediately is false it runs once flood control allows next line
+            void wakeSender(bool immediately);
+            void appendOutgoing(const QByteArray &data);
+            //! Writes everything that was gathered in outgoing buffer to socket using single write
+            void flushOutgoing();
             QByteArray getDataToSend();
             void scheduleDelivery(const QByteArray &data, libircclient::Priority priority);
             void autoJoin();
+            void countCommand(int numeric);
+            //! Returns key of our own nick, it's created again only when the nick changes
+            const NickKey &localNickKey();
+            void addChannel(Channel *channel);
+            void removeChannel(Channel *channel);
+            void indexChannels();
+            void indexUsers();
+            void updateParameterModes();
+            //! Counts connections of events in Listener again, it must not be called from connectNotify()
+            void updateListeners();
+            //! Returns handler of this network, or the global one if network doesn't have its own
+            IRCEventHandler *getEventHandler() const;
+            //! Same as ToHash() but without channels and users
+            QHash<QString, QVariant> settingsToHash();
+            //! Converts lastActivity to wall clock time, which is what is serialized as lastPing
+            QDateTime lastPingTime() const;
 
             /////////////////////////////////////
             // This probably doesn't need syncing
-            unsigned int MSDelayOnEmpty;
-            unsigned int MSDelayOnOpen;
-            unsigned int MSWait;
-            QTimer capTimeout;
+            FloodControl floodControl;
+            //! If true the flood control was set by user and we don't change it based on ircd
+            bool floodControlCustom;
+            WheelTimer capTimeout;
             bool capProcessingMultilineLS;
             bool capProcessingChangeRequest;
             bool capAutoRequestFinished;
             bool loggedIn;
             bool scheduling;
-            QDateTime senderTime;
-            QTimer senderTimer;
-            QMutex mutex;
-            unsigned long long bytesSent;
-            unsigned long long bytesRcvd;
-            QList<QByteArray> hprFIFO;
-            QList<QByteArray> mprFIFO;
-            QList<QByteArray> lprFIFO;
+            //! Running only while there is something waiting in FIFO that flood control doesn't let us send yet
+            WheelTimer senderTimer;
+            // Traffic counters, these are only ever incremented so they don't need any lock
+            std::atomic<unsigned long long> bytesSent;
+            std::atomic<unsigned long long> bytesRcvd;
+            std::atomic<unsigned long long> linesSent;
+            std::atomic<unsigned long long> linesRcvd;
+            std::atomic<unsigned long long> receiveWakeups;
+            std::atomic<unsigned long long> parseFailures;
+            std::atomic<unsigned long long> writes;
+            std::atomic<unsigned long long> commandsRcvd[NETWORK_STATISTICS_COMMAND_SLOTS];
+            std::atomic<unsigned long long> unknownCommandsRcvd;
+            //! Number of items in each FIFO indexed by Priority, producers increment it before they push
+            std::atomic<int> queueDepth[4];
+            //! True if some other thread already asked the sender to wake up and it didn't run yet
+            std::atomic<bool> senderWakeupPending;
+            IRCEventHandler *eventHandler = nullptr;
+            //! Listener flags of events that have something connected, signals may be connected from other threads
+#if QT_VERSION >= 0x050000
+            std::atomic<unsigned int> listeners{0};
+            //! Number of connections of every event in Listener, indexed by bit of its flag
+            int listenerConnections[NETWORK_LISTENER_COUNT] = {};
+            //! Guards listenerConnections, it's never held while calling into QObject
+            QMutex listenersLock;
+            //! Set when Qt disconnected everything without telling which signals, see updateListeners()
+            std::atomic<bool> listenersDirty{false};
+#else
+            // Qt 4 doesn't tell which signal was connected, so everything is emitted
+            std::atomic<unsigned int> listeners{~0u};
+#endif
+            //! Data read from socket, it's reused for whole connection, the incomplete line is kept at its beginning
+            QByteArray receiveBuffer;
+            int receivePending;
+            //! Changed on every connect so that receive loop can tell the socket was replaced
+            unsigned int receiveGeneration;
+            bool receiving;
+            // Outgoing lines waiting for flood control, any thread may push, only the thread owning this network pops
+            MPSCQueue<QByteArray> rtFIFO;
+            MPSCQueue<QByteArray> hprFIFO;
+            MPSCQueue<QByteArray> mprFIFO;
+            MPSCQueue<QByteArray> lprFIFO;
+            //! Lines that will be written to socket at the end of current OnSend
+            QByteArray sendBuffer;
+            int sendBufferLines;
             /////////////////////////////////////
 
-            //! List of symbols that are used to prefix users
-            QList<char> channelUserPrefixes;
+            //! List of symbols that are used to prefix users, rank of symbol is rank of matching mode in CUModes
+            libirc::RankedModeSet channelUserPrefixes;
             //! Channel modes with no parameters
-            QList<char> CModes;
+            libirc::ModeSet CModes;
             //! Channel parameter modes (+b, +I)
-            QList<char> CPModes;
+            libirc::ModeSet CPModes;
             //! Channel secret modes (+k)
-            QList<char> CRModes;
-            //! Channel user modes (+o, +v)
-            QList<char> CUModes;
+            libirc::ModeSet CRModes;
+            //! Channel user modes (+o, +v), sorted from highest to lowest
+            libirc::RankedModeSet CUModes;
             //! Channel numeric modes (+l)
-            QList<char> CCModes;
+            libirc::ModeSet CCModes;
             //! https://tools.ietf.org/html/draft-hardy-irc-isupport-00#section-4.18
-            QList<char> STATUSMSG_Modes;
+            libirc::RankedModeSet STATUSMSG_Modes;
+            //! Union of CUModes, CRModes and CPModes, these modes take a parameter, see updateParameterModes()
+            libirc::ModeSet parameterModes;
             QString originalNick;
+            CaseMapping caseMapping;
+            //! Cached key of local user, localKeyNick is the nick it was created from
+            NickKey localKey;
+            QString localKeyNick;
             UMode localUserMode;
             QString alternateNick;
             int alternateNickNumber;
@@ -413,11 +541,29 @@ namespace libircclient
             Server *server;
             QList<User*> users;
             Encoding encoding = EncodingDefault;
+            //! Decoder used for encodings that can't be parsed on byte level, it's kept for whole life of network,
+            //! because it's expensive to create and also keeps state of incomplete sequences between lines
+#if QT_VERSION >= 0x060000
+            QStringDecoder *decoder = nullptr;
+#else
+            QTextDecoder *decoder = nullptr;
+#endif
+            //! Channels in order in which we joined them
             QList<Channel*> channels;
+            //! Same channels indexed by folded name, needs to be updated together with the list
+            QHash<NickKey, Channel*> channelIndex;
+            //! Users of all channels we are in, one record per nick, channels add and remove them
+            QHash<NickKey, User*> userIndex;
+            //! Generation in which channels were left, by name, so that deltas can tell the other side to remove them
+            QHash<QString, quint64> removedChannels;
+            //! Generation of last _st_ClearChannels(), deltas older than that need to contain all channels
+            quint64 channelsResetGeneration = 0;
             User localUser;
-            QDateTime lastPing;
-            QTimer *timerPingTimeout;
-            QTimer *timerPingSend;
+            //! Time of TimerWheel::GetTime() when we last received anything from server
+            qint64 lastActivity;
+            //! Fires when the server is silent for pingTimeout, it's moved forward lazily only when it fires
+            WheelTimer timerPingTimeout;
+            WheelTimer timerPingSend;
             //! List of channels to join after connection to network
             QList<QString> channelsToJoin;
             long long lastPingResponseTimeInMs = 0;
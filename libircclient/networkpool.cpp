@@ -0,0 +1,192 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "networkpool.h"
+#include "network.h"
+
+using namespace libircclient;
+
+NetworkPoolWorker::NetworkPoolWorker(QThread *target)
+{
+    this->target = target;
+}
+
+void NetworkPoolWorker::Release(QObject *object)
+{
+    object->moveToThread(this->target);
+}
+
+NetworkPool::NetworkPool(int threads, QObject *parent) : QObject(parent)
+{
+    if (threads <= 0)
+        threads = QThread::idealThreadCount();
+    if (threads <= 0)
+        threads = 1;
+    for (int i = 0; i < threads; i++)
+    {
+        Worker worker;
+        worker.Thread = new QThread();
+        worker.Helper = new NetworkPoolWorker(this->thread());
+        worker.Helper->moveToThread(worker.Thread);
+        worker.Thread->start();
+        this->workers.append(worker);
+    }
+}
+
+NetworkPool::~NetworkPool()
+{
+    foreach (Network *network, this->GetNetworks())
+        this->Remove(network);
+    for (int i = 0; i < this->workers.size(); i++)
+    {
+        Worker &worker = this->workers[i];
+        worker.Thread->quit();
+        worker.Thread->wait();
+        delete worker.Helper;
+        delete worker.Thread;
+    }
+}
+
+bool NetworkPool::Insert(Network *network)
+{
+    if (!network || network->parent() || network->thread() != QThread::currentThread())
+        return false;
+    this->lock.lock();
+    if (this->workerOf(network) >= 0)
+    {
+        this->lock.unlock();
+        return false;
+    }
+    int best = 0;
+    for (int i = 1; i < this->workers.size(); i++)
+    {
+        if (this->workers.at(i).Networks.size() < this->workers.at(best).Networks.size())
+            best = i;
+    }
+    this->workers[best].Networks.append(network);
+    QThread *thread = this->workers.at(best).Thread;
+    this->lock.unlock();
+    // Socket is a child of network so it moves with it, network moves its timers to wheel of new thread itself
+    network->moveToThread(thread);
+    return true;
+}
+
+bool NetworkPool::Remove(Network *network)
+{
+    this->lock.lock();
+    int worker = this->workerOf(network);
+    if (worker < 0)
+    {
+        this->lock.unlock();
+        return false;
+    }
+    this->workers[worker].Networks.removeOne(network);
+    NetworkPoolWorker *helper = this->workers.at(worker).Helper;
+    QThread *thread = this->workers.at(worker).Thread;
+    this->lock.unlock();
+    if (QThread::currentThread() == thread)
+    {
+        // We are in the thread that owns the network, waiting for it here would never end
+        helper->Release(network);
+        return true;
+    }
+    // Only the thread that owns the object can move it, so we wait until the worker does that
+    QMetaObject::invokeMethod(helper, "Release", Qt::BlockingQueuedConnection, Q_ARG(QObject*, network));
+    return true;
+}
+
+bool NetworkPool::Contains(Network *network) const
+{
+    this->lock.lock();
+    bool contains = this->workerOf(network) >= 0;
+    this->lock.unlock();
+    return contains;
+}
+
+void NetworkPool::Connect(Network *network)
+{
+    QMetaObject::invokeMethod(network, "Connect", Qt::QueuedConnection);
+}
+
+void NetworkPool::Disconnect(Network *network, const QString &reason)
+{
+    QMetaObject::invokeMethod(network, "Disconnect", Qt::QueuedConnection, Q_ARG(QString, reason));
+}
+
+void NetworkPool::Reconnect(Network *network)
+{
+    QMetaObject::invokeMethod(network, "Reconnect", Qt::QueuedConnection);
+}
+
+void NetworkPool::PostToOwner(Network *network, const std::function<void()> &function)
+{
+    PostedCall call;
+    call.Target = network;
+    call.HasTarget = network != nullptr;
+    call.Function = function;
+    this->lock.lock();
+    bool first = this->posted.isEmpty();
+    this->posted.append(call);
+    this->lock.unlock();
+    // Only the first call wakes up the owner, the rest is picked up by the same OnPosted()
+    if (first)
+        QMetaObject::invokeMethod(this, "OnPosted", Qt::QueuedConnection);
+}
+
+QList<Network *> NetworkPool::GetNetworks() const
+{
+    QList<Network*> networks;
+    this->lock.lock();
+    foreach (const Worker &worker, this->workers)
+        networks.append(worker.Networks);
+    this->lock.unlock();
+    return networks;
+}
+
+int NetworkPool::GetThreadCount() const
+{
+    return this->workers.size();
+}
+
+int NetworkPool::GetThreadLoad(int thread) const
+{
+    if (thread < 0 || thread >= this->workers.size())
+        return 0;
+    this->lock.lock();
+    int load = this->workers.at(thread).Networks.size();
+    this->lock.unlock();
+    return load;
+}
+
+void NetworkPool::OnPosted()
+{
+    QList<PostedCall> calls;
+    this->lock.lock();
+    calls.swap(this->posted);
+    this->lock.unlock();
+    foreach (const PostedCall &call, calls)
+    {
+        if (call.HasTarget && !call.Target)
+            continue;
+        call.Function();
+    }
+}
+
+int NetworkPool::workerOf(Network *network) const
+{
+    for (int i = 0; i < this->workers.size(); i++)
+    {
+        if (this->workers.at(i).Networks.contains(network))
+            return i;
+    }
+    return -1;
+}
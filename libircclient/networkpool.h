@@ -0,0 +1,120 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef NETWORKPOOL_H
+#define NETWORKPOOL_H
+
+#include <functional>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+#include "libircclient_global.h"
+
+namespace libircclient
+{
+    class Network;
+
+    //! Helper that lives in worker thread of pool, it's needed because objects can only be moved from their own thread
+    class LIBIRCCLIENTSHARED_EXPORT NetworkPoolWorker : public QObject
+    {
+        Q_OBJECT
+        public:
+            NetworkPoolWorker(QThread *target);
+
+        public slots:
+            //! Moves the object back to target thread
+            void Release(QObject *object);
+
+        private:
+            QThread *target;
+    };
+
+    /*!
+     * \brief The NetworkPool class runs networks on a fixed number of worker threads, each with its own event loop
+     *
+     * Network that is inserted to pool is moved together with its socket and timers to the worker thread that has
+     * the least networks, from then on everything the network does (reading, parsing, sending, timers) happens in that
+     * thread. Signals of network connected to objects in other threads are queued by Qt as usual, IRCEventHandler of
+     * network is called from the worker thread.
+     *
+     * Functions of network that are not thread safe must not be called from other threads while it's in pool, use
+     * Connect(), Disconnect() and Reconnect() of pool, or TransferRaw() and its variants which are thread safe.
+     *
+     * Workers can hand results back to thread of pool with PostToOwner(), calls posted from one worker are queued
+     * and the owner thread runs all of them at once, so thousands of networks don't flood its event loop.
+     *
+     * Signals of networks are not batched, every emitted signal is one queued event in the receiving thread. If owner
+     * thread needs to follow busy networks, use IRCEventHandler, which runs in the worker, and hand only what is
+     * needed to the owner with PostToOwner().
+     */
+    class LIBIRCCLIENTSHARED_EXPORT NetworkPool : public QObject
+    {
+        Q_OBJECT
+        public:
+            //! Creates pool with given number of worker threads, 0 means one thread per CPU core
+            NetworkPool(int threads = 0, QObject *parent = nullptr);
+            //! Moves all networks back to thread of pool and stops the workers, networks are not deleted
+            ~NetworkPool() override;
+            /*!
+             * \brief Insert moves network to the least loaded worker thread
+             * \param network Network that lives in thread of pool and has no parent
+             * \return False if network can't be moved or is already in pool
+             */
+            bool Insert(Network *network);
+            //! Moves network back to thread of pool, it's safe to delete it afterwards
+            //! This can be called from thread of pool or from worker thread of the network (for example from its signal
+            //! or event handler), in other threads it blocks until the worker moves the network, so the worker must not
+            //! be waiting for that thread at the same time
+            bool Remove(Network *network);
+            bool Contains(Network *network) const;
+            //! Calls Connect() of network in its worker thread
+            void Connect(Network *network);
+            void Disconnect(Network *network, const QString &reason = "");
+            void Reconnect(Network *network);
+            /*!
+             * \brief PostToOwner queues a function to be called in thread of pool, this can be called from any thread
+             * \param network The function is dropped if this network is deleted before it runs, can be nullptr
+             * \param function Function to call
+             */
+            void PostToOwner(Network *network, const std::function<void()> &function);
+            QList<Network*> GetNetworks() const;
+            int GetThreadCount() const;
+            //! Returns how many networks run in this worker
+            int GetThreadLoad(int thread) const;
+
+        private slots:
+            void OnPosted();
+
+        private:
+            struct Worker
+            {
+                QThread *Thread;
+                NetworkPoolWorker *Helper;
+                QList<Network*> Networks;
+            };
+            struct PostedCall
+            {
+                QPointer<Network> Target;
+                bool HasTarget;
+                std::function<void()> Function;
+            };
+            int workerOf(Network *network) const;
+            QList<Worker> workers;
+            //! Calls posted by workers that were not run yet
+            QList<PostedCall> posted;
+            mutable QMutex lock;
+    };
+}
+
+#endif // NETWORKPOOL_H
@@ -0,0 +1,52 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef NETWORKSTATISTICS_H
+#define NETWORKSTATISTICS_H
+
+#include <QHash>
+#include "libircclient_global.h"
+
+//! Named commands have negative numerics, they are shifted by this value so that they can be used as array index
+#define NETWORK_STATISTICS_COMMAND_OFFSET 32
+//! Numerics are 3 digit numbers, so this is enough to count every command we know
+#define NETWORK_STATISTICS_COMMAND_SLOTS  (NETWORK_STATISTICS_COMMAND_OFFSET + 1000)
+
+namespace libircclient
+{
+    /*!
+     * \brief Copy of traffic counters of a single network taken by Network::GetStatistics()
+     *
+     * Counters are updated independently of each other without locking, so the snapshot may be a few lines
+     * behind in some of them, but each of them on its own is exact.
+     */
+    struct LIBIRCCLIENTSHARED_EXPORT NetworkStatistics
+    {
+        unsigned long long BytesSent = 0;
+        unsigned long long BytesReceived = 0;
+        unsigned long long LinesSent = 0;
+        unsigned long long LinesReceived = 0;
+        //! How many times the socket woke us up with new data
+        unsigned long long ReceiveWakeups = 0;
+        //! How many times we wrote to socket, LinesSent / Writes is the average number of lines per write
+        unsigned long long Writes = 0;
+        //! Lines that parser refused (these were delivered through Event_Invalid)
+        unsigned long long ParseFailures = 0;
+        //! How many lines of each command were received, key is the IRC_NUMERIC_ constant, commands that
+        //! were never received are not present, unknown commands are counted as IRC_NUMERIC_INVALID
+        QHash<int, unsigned long long> Commands;
+        //! How many lines are waiting in outgoing queue, indexed by Priority
+        int QueueDepth[4] = { 0, 0, 0, 0 };
+    };
+}
+
+#endif // NETWORKSTATISTICS_H
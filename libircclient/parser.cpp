@@ -11,98 +11,214 @@
 // Copyright (c) Petr Bena 2015 - 2019
 
 #include "parser.h"
-#include <QStringList>
+#include "generic.h"
+#include <cstring>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <QStringDecoder>
+#else
+#include <QTextCodec>
+#endif
 
 using namespace libircclient;
 
-static QStringList Trim(QStringList list)
+#define PARSER_DECODED_SOURCE     1
+#define PARSER_DECODED_TEXT       2
+#define PARSER_DECODED_PARAMETERS 4
+#define PARSER_DECODED_TIMESTAMP  8
+
+static const ParserToken NullToken = { -1, 0 };
+
+static inline int FindByte(const char *data, int from, int length, char byte)
 {
-    QStringList result;
-    foreach (QString item, list)
-        if (!item.isEmpty())
-            result << item;
-    return result;
+    if (from >= length)
+        return -1;
+    const char *result = static_cast<const char*>(memchr(data + from, byte, static_cast<size_t>(length - from)));
+    if (!result)
+        return -1;
+    return static_cast<int>(result - data);
+}
+
+static inline int SkipSpaces(const char *data, int position, int length)
+{
+    while (position < length && data[position] == ' ')
+        position++;
+    return position;
 }
 
 Parser::Parser(QString incoming_text)
 {
-    // remove all garbage from incoming text
-    incoming_text.replace("\r", "");
-    incoming_text.replace("\n", "");
-    this->original_text = incoming_text;
+    this->data = incoming_text.toUtf8();
+    this->encoding = EncodingUTF8;
+    this->parse();
+}
+
+Parser::Parser(const QByteArray &incoming_data, Encoding encoding)
+{
+    if (encoding == EncodingUTF16)
+    {
+        // UTF-16 can't be tokenized on byte level, so we convert it to UTF-8 first, Network does this on its own
+        // with a decoder that is kept for whole connection
+        #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        QStringDecoder decoder(QStringDecoder::Encoding::Utf16);
+        QString l = decoder.decode(incoming_data);
+        #else
+        QString l = QTextCodec::codecForName("UTF-16")->toUnicode(incoming_data);
+        #endif
+        this->data = l.toUtf8();
+        this->encoding = EncodingUTF8;
+    } else
+    {
+        this->data = incoming_data;
+        this->encoding = encoding;
+    }
+    this->parse();
+}
+
+Parser::~Parser()
+{
+    delete this->user;
+}
+
+void Parser::parse()
+{
     this->_valid = false;
+    this->_numeric = IRC_NUMERIC_INVALID;
     this->user = nullptr;
+    this->decoded = 0;
+    this->tags = NullToken;
+    this->source = NullToken;
+    this->command = NullToken;
+    this->text = NullToken;
+    this->parameterLine = NullToken;
+    this->rawOffset = 0;
+
+    const char *line = this->data.constData();
+    int size = static_cast<int>(this->data.size());
+    // remove all garbage from end of incoming text
+    while (size > 0 && (line[size - 1] == '\n' || line[size - 1] == '\r'))
+        size--;
+    this->length = size;
+
+    int position = 0;
+    if (size > 0 && line[0] == '@')
+    {
+        // IRCv3 message tags, they are terminated by first space
+        // @time=2011-10-19T16:40:51.620Z :Angel!angel@example.org PRIVMSG Wiz :Hello
+        //                               ^ here
+        int end = FindByte(line, 1, size, ' ');
+        if (end < 0)
+            return;
+        this->tags.Offset = 1;
+        this->tags.Length = end - 1;
+        this->parseTags();
+        position = SkipSpaces(line, end, size);
+        this->rawOffset = position;
+    }
+
     // the incoming text must be prefixed with colon, otherwise it's not from a server and we don't relay client messages
-    if (!incoming_text.startsWith(":"))
+    if (position >= size || line[position] != ':')
     {
-        // https://ircv3.net/specs/extensions/server-time-3.2.html
-        if (incoming_text.startsWith("@time=") && incoming_text.contains(" "))
-        {
-            QString time_string = incoming_text.mid(6);
-            time_string = time_string.mid(0, time_string.indexOf(" "));
-            // Cut the incoming text at first space
-            // @time=2011-10-19T16:40:51.620Z :Angel!angel@example.org PRIVMSG Wiz :Hello
-            //                               ^ here
-            incoming_text = incoming_text.mid(incoming_text.indexOf(" ") + 1);
-            // Process the timestamp
-            this->timestamp = QDateTime::fromString(time_string, "yyyy-MM-ddTHH:mm:ss.zzzZ");
-        }
-        if (!this->timestamp.isValid())
-            this->timestamp = QDateTime::currentDateTime();
         // this is an exception though
-        if (incoming_text.startsWith("PING :"))
+        if (size - position >= 6 && memcmp(line + position, "PING :", 6) == 0)
         {
-            this->text = incoming_text;
+            this->command.Offset = position;
+            this->command.Length = 4;
             this->_numeric = IRC_NUMERIC_RAW_PING;
-            this->parameterLine = incoming_text.mid(6);
-            this->parameters = this->parameterLine.split(" ");
+            // Old servers send the token as text, we treat it as a parameter
+            position += 6;
+            this->parameterLine.Offset = position;
+            this->parameterLine.Length = size - position;
+            while ((position = SkipSpaces(line, position, size)) < size)
+            {
+                int end = FindByte(line, position, size, ' ');
+                if (end < 0)
+                    end = size;
+                ParserToken parameter = { position, end - position };
+                this->parameters.append(parameter);
+                position = end;
+            }
             this->_valid = true;
-            return;
         }
-        if (!incoming_text.startsWith(":"))
-            return;
-    } else
-    {
-        if (!this->timestamp.isValid())
-            this->timestamp = QDateTime::currentDateTime();
+        return;
     }
-    this->text = incoming_text;
-    QString temp = incoming_text.mid(1);
+
     // get the source
-    if (!temp.contains(" "))
+    int end = FindByte(line, position + 1, size, ' ');
+    if (end < 0)
         return;
-    this->source = temp.mid(0, temp.indexOf(" "));
-    temp = temp.mid(temp.indexOf(" ") + 1);
-    // first of all, extract the text if there is some
-    if (temp.contains(" :"))
-    {
-        this->message_text = temp.mid(temp.indexOf(" :") + 2);
-        temp = temp.mid(0, temp.indexOf(" :"));
-    }
+    this->source.Offset = position + 1;
+    this->source.Length = end - position - 1;
+    position = SkipSpaces(line, end, size);
+
     // extract the command, it's a first standalone word
-    if (temp.contains(" "))
+    if (position >= size)
+        return;
+    end = FindByte(line, position, size, ' ');
+    if (end < 0)
+        end = size;
+    this->command.Offset = position;
+    this->command.Length = end - position;
+    position = end;
+
+    // now the parameters, everything that follows " :" is a text
+    while ((position = SkipSpaces(line, position, size)) < size)
     {
-        this->command = temp.mid(0, temp.indexOf(" "));
-        temp = temp.mid(temp.indexOf(" ") + 1);
+        if (line[position] == ':')
+        {
+            this->text.Offset = position + 1;
+            this->text.Length = size - position - 1;
+            break;
+        }
+        end = FindByte(line, position, size, ' ');
+        if (end < 0)
+            end = size;
+        ParserToken parameter = { position, end - position };
+        this->parameters.append(parameter);
+        position = end;
     }
-    else
+    if (!this->parameters.isEmpty())
     {
-        this->command = temp;
-        temp = "";
+        this->parameterLine.Offset = this->parameters.at(0).Offset;
+        this->parameterLine.Length = this->parameters.last().Offset + this->parameters.last().Length - this->parameterLine.Offset;
     }
-    this->parameterLine = temp;
-    this->parameters = Trim(this->parameterLine.split(" "));
     this->_valid = true;
     this->obtainNumeric();
-    if (this->source.contains("@"))
-        this->user = new User(this->source);
-    else
-        this->user = new User(this->source + "!@");
 }
 
-Parser::~Parser()
+void Parser::parseTags()
 {
-    delete this->user;
+    // https://ircv3.net/specs/extensions/message-tags
+    // @aaa=bbb;ccc;example.com/ddd=eee
+    // we only remember where each key and value is, values are unescaped in GetTag()
+    const char *line = this->data.constData();
+    int end = this->tags.Offset + this->tags.Length;
+    int position = this->tags.Offset;
+    while (position < end)
+    {
+        int tag_end = FindByte(line, position, end, ';');
+        if (tag_end < 0)
+            tag_end = end;
+        if (tag_end > position)
+        {
+            ParserTag tag;
+            int separator = FindByte(line, position, tag_end, '=');
+            if (separator < 0)
+            {
+                tag.Key.Offset = position;
+                tag.Key.Length = tag_end - position;
+                tag.Value = NullToken;
+            } else
+            {
+                tag.Key.Offset = position;
+                tag.Key.Length = separator - position;
+                tag.Value.Offset = separator + 1;
+                tag.Value.Length = tag_end - separator - 1;
+            }
+            if (tag.Key.Length > 0)
+                this->tagList.append(tag);
+        }
+        position = tag_end + 1;
+    }
 }
 
 int Parser::GetNumeric()
@@ -112,52 +228,138 @@ int Parser::GetNumeric()
 
 void Parser::obtainNumeric()
 {
-    int numeric_code = this->command.toInt();
-    if (numeric_code == 0)
+    this->_numeric = Parser::CommandToNumeric(this->data.constData() + this->command.Offset, this->command.Length);
+}
+
+#define COMMAND_IS(name) (memcmp(command, name, sizeof(name) - 1) == 0)
+
+int Parser::CommandToNumeric(const char *command, int length)
+{
+    if (length <= 0)
+        return IRC_NUMERIC_INVALID;
+
+    if (command[0] >= '0' && command[0] <= '9')
     {
-        this->_numeric = IRC_NUMERIC_INVALID;
+        // Numerics are always 3 digits according to RFC, but we don't want to break on some weird ircd
+        if (length > 9)
+            return IRC_NUMERIC_INVALID;
+        int numeric_code = 0;
+        for (int i = 0; i < length; i++)
+        {
+            unsigned int digit = static_cast<unsigned int>(command[i] - '0');
+            if (digit > 9)
+                return IRC_NUMERIC_INVALID;
+            numeric_code = numeric_code * 10 + static_cast<int>(digit);
+        }
+        // 000 is not a valid numeric, it would also collide with IRC_NUMERIC_RAW_PONG
+        if (numeric_code == 0)
+            return IRC_NUMERIC_INVALID;
+        return numeric_code;
     }
-    else
+
+    // Convert text command to numeric, every command is uniquely identified by its length and first letter
+    // (or first two letters), memcmp then only confirms the match
+    switch (length)
     {
-        this->_numeric = numeric_code;
-        return;
+        case 3:
+            if (COMMAND_IS("CAP"))
+                return IRC_NUMERIC_RAW_CAP;
+            break;
+        case 4:
+            switch (command[0])
+            {
+                case 'P':
+                    if (command[1] == 'I' && COMMAND_IS("PING"))
+                        return IRC_NUMERIC_RAW_PING;
+                    if (command[1] == 'O' && COMMAND_IS("PONG"))
+                        return IRC_NUMERIC_RAW_PONG;
+                    if (command[1] == 'A' && COMMAND_IS("PART"))
+                        return IRC_NUMERIC_RAW_PART;
+                    break;
+                case 'J':
+                    if (COMMAND_IS("JOIN"))
+                        return IRC_NUMERIC_RAW_JOIN;
+                    break;
+                case 'N':
+                    if (COMMAND_IS("NICK"))
+                        return IRC_NUMERIC_RAW_NICK;
+                    break;
+                case 'M':
+                    if (COMMAND_IS("MODE"))
+                        return IRC_NUMERIC_RAW_MODE;
+                    break;
+                case 'K':
+                    if (COMMAND_IS("KICK"))
+                        return IRC_NUMERIC_RAW_KICK;
+                    break;
+                case 'C':
+                    if (COMMAND_IS("CTCP"))
+                        return IRC_NUMERIC_RAW_CTCP;
+                    break;
+                case 'Q':
+                    if (COMMAND_IS("QUIT"))
+                        return IRC_NUMERIC_RAW_QUIT;
+                    break;
+                case 'A':
+                    if (COMMAND_IS("AWAY"))
+                        return IRC_NUMERIC_RAW_AWAY;
+                    break;
+            }
+            break;
+        case 5:
+            if (COMMAND_IS("TOPIC"))
+                return IRC_NUMERIC_RAW_TOPIC;
+            break;
+        case 6:
+            if (command[0] == 'N' && COMMAND_IS("NOTICE"))
+                return IRC_NUMERIC_RAW_NOTICE;
+            if (command[0] == 'I' && COMMAND_IS("INVITE"))
+                return IRC_NUMERIC_RAW_INVITE;
+            break;
+        case 7:
+            if (command[0] == 'P' && COMMAND_IS("PRIVMSG"))
+                return IRC_NUMERIC_RAW_PRIVMSG;
+            if (command[0] == 'C' && COMMAND_IS("CHGHOST"))
+                return IRC_NUMERIC_RAW_CHGHOST;
+            break;
+        case 8:
+            if (COMMAND_IS("METADATA"))
+                return IRC_NUMERIC_RAW_METADATA;
+            break;
     }
+    return IRC_NUMERIC_INVALID;
+}
+
+#undef COMMAND_IS
+
+QString Parser::decode(const ParserToken &token) const
+{
+    if (token.Offset < 0)
+        return QString();
+    return this->decode(token.Offset, token.Length);
+}
 
-    // Convert text command to numeric
-    if (this->command == "PING")
-        this->_numeric = IRC_NUMERIC_RAW_PING;
-    else if (this->command == "JOIN")
-        this->_numeric = IRC_NUMERIC_RAW_JOIN;
-    else if (this->command == "NICK")
-        this->_numeric = IRC_NUMERIC_RAW_NICK;
-    else if (this->command == "PONG")
-        this->_numeric = IRC_NUMERIC_RAW_PONG;
-    else if (this->command == "NOTICE")
-        this->_numeric = IRC_NUMERIC_RAW_NOTICE;
-    else if (this->command == "MODE")
-        this->_numeric = IRC_NUMERIC_RAW_MODE;
-    else if (this->command == "PRIVMSG")
-        this->_numeric = IRC_NUMERIC_RAW_PRIVMSG;
-    else if (this->command == "KICK")
-        this->_numeric = IRC_NUMERIC_RAW_KICK;
-    else if (this->command == "TOPIC")
-        this->_numeric = IRC_NUMERIC_RAW_TOPIC;
-    else if (this->command == "PART")
-        this->_numeric = IRC_NUMERIC_RAW_PART;
-    else if (this->command == "CTCP")
-        this->_numeric = IRC_NUMERIC_RAW_CTCP;
-    else if (this->command == "QUIT")
-        this->_numeric = IRC_NUMERIC_RAW_QUIT;
-    else if (this->command == "AWAY")
-        this->_numeric = IRC_NUMERIC_RAW_AWAY;
-    else if (this->command == "CAP")
-        this->_numeric = IRC_NUMERIC_RAW_CAP;
-    else if (this->command == "METADATA")
-        this->_numeric = IRC_NUMERIC_RAW_METADATA;
-    else if (this->command == "INVITE")
-        this->_numeric = IRC_NUMERIC_RAW_INVITE;
-    else if (this->command == "CHGHOST")
-        this->_numeric = IRC_NUMERIC_RAW_CHGHOST;
+QString Parser::decode(int offset, int length) const
+{
+    const char *bytes = this->data.constData() + offset;
+    // Most of the IRC traffic is plain ASCII, that can be widened directly without running it through the decoder,
+    // only tokens that contain something else (usually text of messages) are decoded using network encoding
+    if (Generic::IsASCII(bytes, length))
+        return QString::fromLatin1(bytes, length);
+    switch (this->encoding)
+    {
+        case EncodingASCII:
+        case EncodingLatin:
+            return QString::fromLatin1(bytes, length);
+        case EncodingUTF8:
+            return QString::fromUtf8(bytes, length);
+        default:
+#if QT_VERSION >= 0x050000
+            return QString::fromUtf8(bytes, length);
+#else
+            return QString::fromAscii(bytes, length);
+#endif
+    }
 }
 
 bool Parser::IsValid()
@@ -167,41 +369,248 @@ bool Parser::IsValid()
 
 QString Parser::GetParameterLine()
 {
-    return this->parameterLine;
+    return this->decode(this->parameterLine);
 }
 
 QString Parser::GetRaw()
 {
-    return this->text;
+    return this->decode(this->rawOffset, this->length - this->rawOffset);
 }
 
 QString Parser::GetOriginalRaw()
 {
-    return this->original_text;
+    return this->decode(0, this->length);
 }
 
 QString Parser::GetText()
 {
-    return this->message_text;
+    if (!(this->decoded & PARSER_DECODED_TEXT))
+    {
+        this->text_s = this->decode(this->text);
+        this->decoded |= PARSER_DECODED_TEXT;
+    }
+    return this->text_s;
 }
 
 QList<QString> Parser::GetParameters()
 {
-    return this->parameters;
+    if (!(this->decoded & PARSER_DECODED_PARAMETERS))
+    {
+        this->parameters_l.reserve(this->parameters.size());
+        for (int i = 0; i < this->parameters.size(); i++)
+            this->parameters_l.append(this->decode(this->parameters.at(i)));
+        this->decoded |= PARSER_DECODED_PARAMETERS;
+    }
+    return this->parameters_l;
+}
+
+int Parser::GetParameterCount() const
+{
+    return this->parameters.size();
+}
+
+QString Parser::GetParameter(int index)
+{
+    if (index < 0 || index >= this->parameters.size())
+        return QString();
+    if (this->decoded & PARSER_DECODED_PARAMETERS)
+        return this->parameters_l.at(index);
+    return this->decode(this->parameters.at(index));
 }
 
 QDateTime Parser::GetTimestamp()
 {
+    if (!(this->decoded & PARSER_DECODED_TIMESTAMP))
+    {
+        // https://ircv3.net/specs/extensions/server-time-3.2.html
+        // @time=2011-10-19T16:40:51.620Z, the time is always in UTC
+        QString time_string = this->GetTag("time");
+        if (!time_string.isEmpty())
+        {
+#if QT_VERSION >= 0x050800
+            this->timestamp = QDateTime::fromString(time_string, Qt::ISODateWithMs);
+#else
+            this->timestamp = QDateTime::fromString(time_string, "yyyy-MM-ddTHH:mm:ss.zzzZ");
+            this->timestamp.setTimeSpec(Qt::UTC);
+#endif
+            if (this->timestamp.isValid())
+                this->timestamp = this->timestamp.toLocalTime();
+        }
+        if (!this->timestamp.isValid())
+            this->timestamp = QDateTime::currentDateTime();
+        this->decoded |= PARSER_DECODED_TIMESTAMP;
+    }
     return this->timestamp;
 }
 
+int Parser::findTag(const QString &key) const
+{
+    const char *line = this->data.constData();
+    int key_length = static_cast<int>(key.size());
+    for (int i = 0; i < this->tagList.size(); i++)
+    {
+        const ParserToken &tag_key = this->tagList.at(i).Key;
+        if (tag_key.Length != key_length)
+            continue;
+        // Keys are always ASCII so we can compare them byte by byte without converting anything
+        int c = 0;
+        while (c < key_length && key.at(c) == QLatin1Char(line[tag_key.Offset + c]))
+            c++;
+        if (c == key_length)
+            return i;
+    }
+    return -1;
+}
+
+QString Parser::unescapeTagValue(const ParserToken &value) const
+{
+    if (value.Offset < 0)
+        return QString("");
+    const char *line = this->data.constData() + value.Offset;
+    if (!memchr(line, '\\', static_cast<size_t>(value.Length)))
+        return QString::fromUtf8(line, value.Length);
+    QByteArray result;
+    result.reserve(value.Length);
+    int position = 0;
+    while (position < value.Length)
+    {
+        char c = line[position++];
+        if (c != '\\')
+        {
+            result.append(c);
+            continue;
+        }
+        // Trailing backslash is dropped
+        if (position >= value.Length)
+            break;
+        c = line[position++];
+        switch (c)
+        {
+            case ':':
+                result.append(';');
+                break;
+            case 's':
+                result.append(' ');
+                break;
+            case 'r':
+                result.append('\r');
+                break;
+            case 'n':
+                result.append('\n');
+                break;
+            default:
+                // This includes \\ as well as any invalid escape, which should be ignored
+                result.append(c);
+                break;
+        }
+    }
+    return QString::fromUtf8(result);
+}
+
+bool Parser::HasTag(const QString &key) const
+{
+    return this->findTag(key) >= 0;
+}
+
+QString Parser::GetTag(const QString &key) const
+{
+    int index = this->findTag(key);
+    if (index < 0)
+        return QString();
+    return this->unescapeTagValue(this->tagList.at(index).Value);
+}
+
+int Parser::GetTagCount() const
+{
+    return this->tagList.size();
+}
+
+QHash<QString, QString> Parser::GetTags() const
+{
+    QHash<QString, QString> result;
+    for (int i = 0; i < this->tagList.size(); i++)
+    {
+        const ParserTag &tag = this->tagList.at(i);
+        result.insert(QString::fromLatin1(this->data.constData() + tag.Key.Offset, tag.Key.Length), this->unescapeTagValue(tag.Value));
+    }
+    return result;
+}
+
+QByteArray Parser::GetRawData() const
+{
+    return QByteArray::fromRawData(this->data.constData(), this->length);
+}
+
+QByteArray Parser::GetTokenData(const ParserToken &token) const
+{
+    if (token.Offset < 0)
+        return QByteArray();
+    return QByteArray::fromRawData(this->data.constData() + token.Offset, token.Length);
+}
+
+ParserToken Parser::GetTagsToken() const
+{
+    return this->tags;
+}
+
+ParserToken Parser::GetSourceToken() const
+{
+    return this->source;
+}
+
+ParserToken Parser::GetCommandToken() const
+{
+    return this->command;
+}
+
+ParserToken Parser::GetParameterToken(int index) const
+{
+    if (index < 0 || index >= this->parameters.size())
+        return NullToken;
+    return this->parameters.at(index);
+}
+
+ParserToken Parser::GetTextToken() const
+{
+    return this->text;
+}
+
 User *Parser::GetSourceUserInfo()
 {
+    if (!this->user && this->source.Offset >= 0)
+    {
+        QString source_info = this->GetSourceInfo();
+        if (source_info.contains("@"))
+            this->user = new User(source_info);
+        else
+            this->user = new User(source_info + "!@");
+    }
     return this->user;
 }
 
 QString Parser::GetSourceInfo()
 {
-    return this->source;
+    if (!(this->decoded & PARSER_DECODED_SOURCE))
+    {
+        this->source_s = this->decode(this->source);
+        this->decoded |= PARSER_DECODED_SOURCE;
+    }
+    return this->source_s;
 }
 
+QString Parser::GetSourceNick()
+{
+    if (this->user)
+        return this->user->GetNick();
+    if (this->source.Offset < 0)
+        return QString();
+    // Same rules as in constructor of libirc::User, nick is terminated by ! or @ if there is no !
+    const char *line = this->data.constData();
+    int end = this->source.Offset + this->source.Length;
+    int nick_end = FindByte(line, this->source.Offset, end, '!');
+    if (nick_end < 0)
+        nick_end = FindByte(line, this->source.Offset, end, '@');
+    if (nick_end < 0)
+        nick_end = end;
+    return this->decode(this->source.Offset, nick_end - this->source.Offset);
+}
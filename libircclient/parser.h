@@ -16,22 +16,53 @@
 
 #include <QString>
 #include <QList>
+#include <QByteArray>
+#include <QVarLengthArray>
 #include <QDateTime>
+#include <QHash>
 #include "libircclient_global.h"
+#include "encoding.h"
 #include "user.h"
 #include "../libirc/irc_numerics.h"
 
 namespace libircclient
 {
+    //! Position of a token within the raw line that was passed to parser, Offset is negative if token is not present
+    struct ParserToken
+    {
+        int Offset;
+        int Length;
+    };
+
+    //! IRCv3 message tag, the value is kept escaped and it's only unescaped when requested
+    struct ParserTag
+    {
+        ParserToken Key;
+        ParserToken Value;
+    };
+
+    /*!
+     * \brief The Parser class splits a single IRC line into its parts
+     *
+     * Parser works on raw bytes as they were received from the socket and only remembers offsets of each token,
+     * QStrings (and the source User) are decoded only when they are requested for the first time.
+     */
     class LIBIRCCLIENTSHARED_EXPORT Parser
     {
         public:
+            //! Converts IRC command (either 3 digit numeric or named command such as PRIVMSG) to one of IRC_NUMERIC_
+            //! constants in constant time, returns IRC_NUMERIC_INVALID for unknown commands
+            static int CommandToNumeric(const char *command, int length);
+
             Parser(QString incoming_text);
+            Parser(const QByteArray &incoming_data, Encoding encoding = EncodingDefault);
             ~Parser();
             int GetNumeric();
             bool IsValid();
             User *GetSourceUserInfo();
             QString GetSourceInfo();
+            //! Returns nick of source, this is cheaper than GetSourceUserInfo() as it doesn't need to create a User
+            QString GetSourceNick();
             QString GetParameterLine();
             //! Returns RAW data as received from server, with some alterations to remove some CAP extras (such as server-time)
             //! this RAW text follows IRC RFC preceeding IRCv3
@@ -40,20 +71,55 @@ namespace libircclient
             QString GetOriginalRaw();
             QString GetText();
             QList<QString> GetParameters();
+            int GetParameterCount() const;
+            QString GetParameter(int index);
+            //! Returns time of message, either from server-time tag, or time when it was parsed
             QDateTime GetTimestamp();
+            //! Returns true if message contains IRCv3 tag with this key (for example "msgid" or "+typing")
+            bool HasTag(const QString &key) const;
+            //! Returns unescaped value of IRCv3 tag, null string if there is no such tag
+            QString GetTag(const QString &key) const;
+            int GetTagCount() const;
+            //! Decodes all IRCv3 tags into a hash, prefer GetTag() if you need only some of them
+            QHash<QString, QString> GetTags() const;
+            //! Returns the line this parser was constructed from without trailing new line, the tokens are offsets within it
+            QByteArray GetRawData() const;
+            //! Returns a shallow copy of token data, which is only valid as long as this parser exists
+            QByteArray GetTokenData(const ParserToken &token) const;
+            ParserToken GetTagsToken() const;
+            ParserToken GetSourceToken() const;
+            ParserToken GetCommandToken() const;
+            ParserToken GetParameterToken(int index) const;
+            ParserToken GetTextToken() const;
 
         private:
+            void parse();
+            void parseTags();
+            int findTag(const QString &key) const;
+            QString unescapeTagValue(const ParserToken &value) const;
             void obtainNumeric();
-            User *user;
-            QString source;
-            QString text;
-            QString original_text;
-            QString message_text;
+            QString decode(const ParserToken &token) const;
+            QString decode(int offset, int length) const;
+            QByteArray data;
+            int length;
+            Encoding encoding;
+            ParserToken tags;
+            ParserToken source;
+            ParserToken command;
+            ParserToken text;
+            ParserToken parameterLine;
+            QVarLengthArray<ParserToken, 16> parameters;
+            QVarLengthArray<ParserTag, 8> tagList;
+            //! Offset where the line without IRCv3 tags starts
+            int rawOffset;
             bool _valid;
             int _numeric;
-            QList<QString> parameters;
-            QString command;
-            QString parameterLine;
+            // Lazily decoded values
+            User *user;
+            unsigned int decoded;
+            QString source_s;
+            QString text_s;
+            QList<QString> parameters_l;
             QDateTime timestamp;
 
     };
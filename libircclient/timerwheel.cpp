@@ -0,0 +1,351 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#include "timerwheel.h"
+#include <QElapsedTimer>
+#include <QThreadStorage>
+
+using namespace libircclient;
+
+static QThreadStorage<TimerWheel*> wheels;
+
+static QElapsedTimer startClock()
+{
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+//! Timers may fire later than requested, but never sooner, so the deadline is rounded up
+static qint64 deadlineToTick(qint64 deadline)
+{
+    if (deadline < 0)
+        return 0;
+    return (deadline + TIMERWHEEL_RESOLUTION - 1) / TIMERWHEEL_RESOLUTION;
+}
+
+WheelTimer::WheelTimer()
+{
+    this->deadline = 0;
+    this->suspended = false;
+    this->wheel = nullptr;
+    this->list = nullptr;
+    this->previous = nullptr;
+    this->next = nullptr;
+    this->level = 0;
+    this->bucket = 0;
+}
+
+WheelTimer::~WheelTimer()
+{
+    this->Stop();
+}
+
+void WheelTimer::SetCallback(const std::function<void()> &callback)
+{
+    this->callback = callback;
+}
+
+void WheelTimer::Start(int msec)
+{
+    this->StartAt(TimerWheel::GetTime() + msec);
+}
+
+void WheelTimer::StartAt(qint64 deadline)
+{
+    this->Stop();
+    this->deadline = deadline;
+    TimerWheel::GetCurrent()->insert(this);
+}
+
+void WheelTimer::Stop()
+{
+    this->suspended = false;
+    if (this->wheel)
+        this->wheel->remove(this);
+}
+
+bool WheelTimer::IsActive() const
+{
+    return this->wheel != nullptr;
+}
+
+qint64 WheelTimer::GetDeadline() const
+{
+    return this->deadline;
+}
+
+void WheelTimer::Suspend()
+{
+    if (!this->wheel)
+        return;
+    this->wheel->remove(this);
+    this->suspended = true;
+}
+
+void WheelTimer::Resume()
+{
+    if (this->suspended)
+        this->StartAt(this->deadline);
+}
+
+TimerWheel *TimerWheel::GetCurrent()
+{
+    if (!wheels.hasLocalData())
+        wheels.setLocalData(new TimerWheel());
+    return wheels.localData();
+}
+
+qint64 TimerWheel::GetTime()
+{
+    static QElapsedTimer clock = startClock();
+    return clock.elapsed();
+}
+
+TimerWheel::TimerWheel()
+{
+    for (int level = 0; level < TIMERWHEEL_LEVELS; level++)
+    {
+        this->occupied[level] = 0;
+        for (int bucket = 0; bucket < TIMERWHEEL_BUCKETS; bucket++)
+            this->buckets[level][bucket] = nullptr;
+    }
+    this->expired = nullptr;
+    this->currentTick = TimerWheel::GetTime() / TIMERWHEEL_RESOLUTION;
+    this->scheduledTick = -1;
+    this->count = 0;
+    this->advancing = false;
+    this->timer.setParent(this);
+    this->timer.setSingleShot(true);
+    connect(&this->timer, SIGNAL(timeout()), this, SLOT(OnTimeout()));
+}
+
+TimerWheel::~TimerWheel()
+{
+    // Timers that are still running just stop, they may outlive the thread
+    for (int level = 0; level < TIMERWHEEL_LEVELS; level++)
+    {
+        for (int bucket = 0; bucket < TIMERWHEEL_BUCKETS; bucket++)
+        {
+            while (this->buckets[level][bucket])
+                this->remove(this->buckets[level][bucket]);
+        }
+    }
+    while (this->expired)
+        this->remove(this->expired);
+}
+
+int TimerWheel::Count() const
+{
+    return this->count;
+}
+
+void TimerWheel::OnTimeout()
+{
+    this->scheduledTick = -1;
+    this->advance(TimerWheel::GetTime() / TIMERWHEEL_RESOLUTION);
+    this->reschedule();
+}
+
+void TimerWheel::insert(WheelTimer *timer)
+{
+    // Nothing was processed while the wheel was empty, so it can start from now
+    if (this->count == 0)
+        this->currentTick = qMax(this->currentTick, TimerWheel::GetTime() / TIMERWHEEL_RESOLUTION);
+    timer->wheel = this;
+    this->count++;
+    qint64 due = this->place(timer);
+    if (!this->advancing && (this->scheduledTick < 0 || due < this->scheduledTick))
+        this->arm(due);
+}
+
+qint64 TimerWheel::place(WheelTimer *timer)
+{
+    qint64 tick = qMax(deadlineToTick(timer->deadline), this->currentTick);
+    qint64 delta = tick - this->currentTick;
+    // Timer that doesn't fit even to the last level waits there and is placed again once it gets to lower level
+    if (delta >= (Q_INT64_C(1) << (TIMERWHEEL_BITS * TIMERWHEEL_LEVELS)))
+    {
+        delta = (Q_INT64_C(1) << (TIMERWHEEL_BITS * TIMERWHEEL_LEVELS)) - 1;
+        tick = this->currentTick + delta;
+    }
+    int level = 0;
+    while (level < TIMERWHEEL_LEVELS - 1 && delta >= (Q_INT64_C(1) << (TIMERWHEEL_BITS * (level + 1))))
+        level++;
+    int shift = TIMERWHEEL_BITS * level;
+    int bucket = static_cast<int>((tick >> shift) & (TIMERWHEEL_BUCKETS - 1));
+    this->link(timer, &this->buckets[level][bucket], level, bucket);
+    // Level 0 fires in the tick itself, higher levels need to be cascaded when their bucket begins
+    return (tick >> shift) << shift;
+}
+
+void TimerWheel::remove(WheelTimer *timer)
+{
+    this->unlink(timer);
+    timer->wheel = nullptr;
+    this->count--;
+    if (this->count == 0 && !this->advancing)
+    {
+        this->timer.stop();
+        this->scheduledTick = -1;
+    }
+}
+
+void TimerWheel::link(WheelTimer *timer, WheelTimer **list, int level, int bucket)
+{
+    timer->previous = nullptr;
+    timer->next = *list;
+    if (*list)
+        (*list)->previous = timer;
+    *list = timer;
+    timer->list = list;
+    timer->level = level;
+    timer->bucket = bucket;
+    if (level >= 0)
+        this->occupied[level] |= Q_UINT64_C(1) << bucket;
+}
+
+void TimerWheel::unlink(WheelTimer *timer)
+{
+    if (timer->previous)
+        timer->previous->next = timer->next;
+    else
+        *timer->list = timer->next;
+    if (timer->next)
+        timer->next->previous = timer->previous;
+    if (timer->level >= 0 && !*timer->list)
+        this->occupied[timer->level] &= ~(Q_UINT64_C(1) << timer->bucket);
+    timer->list = nullptr;
+    timer->previous = nullptr;
+    timer->next = nullptr;
+}
+
+void TimerWheel::cascade(int level, int bucket)
+{
+    WheelTimer *timer = this->buckets[level][bucket];
+    this->buckets[level][bucket] = nullptr;
+    this->occupied[level] &= ~(Q_UINT64_C(1) << bucket);
+    while (timer)
+    {
+        WheelTimer *next = timer->next;
+        timer->list = nullptr;
+        timer->previous = nullptr;
+        timer->next = nullptr;
+        this->place(timer);
+        timer = next;
+    }
+}
+
+void TimerWheel::advance(qint64 tick)
+{
+    this->advancing = true;
+    while (this->currentTick <= tick)
+    {
+        qint64 current = this->currentTick;
+        // Higher levels go first, so that timers can fall through several levels in one tick
+        for (int level = TIMERWHEEL_LEVELS - 1; level > 0; level--)
+        {
+            int shift = TIMERWHEEL_BITS * level;
+            if ((current & ((Q_INT64_C(1) << shift) - 1)) == 0)
+                this->cascade(level, static_cast<int>((current >> shift) & (TIMERWHEEL_BUCKETS - 1)));
+        }
+        // Timers that are due are moved away before any of them fires, so that callbacks can start and stop
+        // any timer, including those that are about to fire, timers started now go to next tick at soonest
+        this->currentTick = current + 1;
+        int bucket = static_cast<int>(current & (TIMERWHEEL_BUCKETS - 1));
+        while (this->buckets[0][bucket])
+        {
+            WheelTimer *timer = this->buckets[0][bucket];
+            this->unlink(timer);
+            this->link(timer, &this->expired, -1, -1);
+        }
+        while (this->expired)
+        {
+            WheelTimer *timer = this->expired;
+            this->remove(timer);
+            // Callback may delete the timer
+            std::function<void()> callback = timer->callback;
+            if (callback)
+                callback();
+        }
+        // Skip the ticks in which nothing happens
+        if (!this->occupied[0])
+        {
+            qint64 next = this->nextTick();
+            if (next < 0 || next > tick)
+                next = tick + 1;
+            this->currentTick = qMax(this->currentTick, next);
+        }
+    }
+    this->advancing = false;
+}
+
+qint64 TimerWheel::nextTick() const
+{
+    qint64 result = -1;
+    for (int level = 0; level < TIMERWHEEL_LEVELS; level++)
+    {
+        quint64 mask = this->occupied[level];
+        if (!mask)
+            continue;
+        int shift = TIMERWHEEL_BITS * level;
+        qint64 base = this->currentTick >> shift;
+        int index = static_cast<int>(base & (TIMERWHEEL_BUCKETS - 1));
+        // Rotate the mask so that bucket of current tick is the lowest bit
+        if (index)
+            mask = (mask >> index) | (mask << (TIMERWHEEL_BUCKETS - index));
+        // Current bucket of higher level is either cascaded right now, or it was already and holds timers for its
+        // next turn, which is after all the other buckets
+        if (level > 0 && (this->currentTick & ((Q_INT64_C(1) << shift) - 1)) != 0)
+            mask &= ~Q_UINT64_C(1);
+        int offset = 0;
+        if (!mask)
+        {
+            offset = TIMERWHEEL_BUCKETS;
+        } else
+        {
+            while (!(mask & 1))
+            {
+                mask >>= 1;
+                offset++;
+            }
+        }
+        qint64 tick;
+        if (level == 0)
+            tick = this->currentTick + offset;
+        else
+            tick = (base + offset) << shift;
+        if (result < 0 || tick < result)
+            result = tick;
+    }
+    return result;
+}
+
+void TimerWheel::reschedule()
+{
+    if (this->count == 0)
+    {
+        this->timer.stop();
+        this->scheduledTick = -1;
+        return;
+    }
+    qint64 next = this->nextTick();
+    if (next != this->scheduledTick || !this->timer.isActive())
+        this->arm(next);
+}
+
+void TimerWheel::arm(qint64 tick)
+{
+    this->scheduledTick = tick;
+    qint64 wait = tick * TIMERWHEEL_RESOLUTION - TimerWheel::GetTime();
+    this->timer.start(static_cast<int>(qMax(Q_INT64_C(0), wait)));
+}
@@ -0,0 +1,130 @@
+//This program is free software: you can redistribute it and/or modify
+//it under the terms of the GNU Lesser General Public License as published by
+//the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU Lesser General Public License for more details.
+
+// Copyright (c) Petr Bena 2015 - 2019
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <functional>
+#include <QObject>
+#include <QTimer>
+#include "libircclient_global.h"
+
+//! Length of one tick of wheel in milliseconds, timers never fire sooner than requested, but up to one tick later
+#define TIMERWHEEL_RESOLUTION 10
+#define TIMERWHEEL_BITS       6
+#define TIMERWHEEL_BUCKETS    (1 << TIMERWHEEL_BITS)
+//! Number of levels, with 10ms resolution the last one covers about 46 hours, longer timers are rescheduled
+#define TIMERWHEEL_LEVELS     4
+
+namespace libircclient
+{
+    class TimerWheel;
+
+    /*!
+     * \brief The WheelTimer class is a single shot timer driven by TimerWheel of the thread it was started in
+     *
+     * Unlike QTimer it doesn't need any OS timer, starting and stopping it is only a few pointer operations, so it's
+     * cheap to use thousands of them. It must be started and stopped in same thread, use Suspend() and Resume() to
+     * move it to another thread.
+     */
+    class LIBIRCCLIENTSHARED_EXPORT WheelTimer
+    {
+        public:
+            WheelTimer();
+            ~WheelTimer();
+            //! Function that is called when the timer fires, it's called from the event loop of the thread
+            void SetCallback(const std::function<void()> &callback);
+            //! Starts or restarts the timer so that it fires after msec milliseconds
+            void Start(int msec);
+            //! Starts or restarts the timer so that it fires at given time of TimerWheel::GetTime()
+            void StartAt(qint64 deadline);
+            void Stop();
+            bool IsActive() const;
+            qint64 GetDeadline() const;
+            //! Stops the timer, but remembers it was running, so that Resume() can start it again with same deadline
+            void Suspend();
+            //! Starts the timer in wheel of current thread if it was suspended
+            void Resume();
+
+        private:
+            friend class TimerWheel;
+            std::function<void()> callback;
+            qint64 deadline;
+            bool suspended;
+            TimerWheel *wheel;
+            //! List in which the timer currently is, it's a bucket of wheel or list of expired timers
+            WheelTimer **list;
+            WheelTimer *previous;
+            WheelTimer *next;
+            int level;
+            int bucket;
+    };
+
+    /*!
+     * \brief The TimerWheel class drives all WheelTimers of one thread using a single QTimer
+     *
+     * This is a hierarchical timer wheel, each level has TIMERWHEEL_BUCKETS buckets and every bucket of a level covers
+     * as much time as the whole level below it. Timers are put into level that matches how far their deadline is, and
+     * they move to lower levels as the time approaches, so inserting and removing a timer is constant time no matter
+     * how many there are. The QTimer is armed only for the next tick that has anything to do, so the thread doesn't
+     * wake up at all while nothing is due.
+     */
+    class LIBIRCCLIENTSHARED_EXPORT TimerWheel : public QObject
+    {
+        Q_OBJECT
+        public:
+            //! Returns wheel of current thread, it's created when first needed and deleted when the thread finishes
+            static TimerWheel *GetCurrent();
+            //! Monotonic time in milliseconds, it's same for all threads and isn't affected by changes of system time
+            static qint64 GetTime();
+
+            TimerWheel();
+            ~TimerWheel() override;
+            //! Number of timers that are running in this wheel
+            int Count() const;
+
+        private slots:
+            void OnTimeout();
+
+        private:
+            friend class WheelTimer;
+            void insert(WheelTimer *timer);
+            //! Puts timer to bucket that matches its deadline, returns tick in which wheel needs to look at it
+            qint64 place(WheelTimer *timer);
+            void remove(WheelTimer *timer);
+            void link(WheelTimer *timer, WheelTimer **list, int level, int bucket);
+            void unlink(WheelTimer *timer);
+            void cascade(int level, int bucket);
+            //! Runs all ticks up to given one and fires the timers that are due
+            void advance(qint64 tick);
+            //! Returns first tick in which something needs to be done
+            qint64 nextTick() const;
+            void reschedule();
+            //! Starts the QTimer so that it times out in given tick
+            void arm(qint64 tick);
+            WheelTimer *buckets[TIMERWHEEL_LEVELS][TIMERWHEEL_BUCKETS];
+            //! Bit for every bucket that isn't empty, so that empty ones don't need to be visited
+            quint64 occupied[TIMERWHEEL_LEVELS];
+            //! Timers that are due and are being fired
+            WheelTimer *expired;
+            //! First tick that wasn't processed yet
+            qint64 currentTick;
+            //! Tick for which the timer is armed, -1 if it isn't
+            qint64 scheduledTick;
+            int count;
+            //! True while timers are being fired, the QTimer is armed again only once that is finished
+            bool advancing;
+            QTimer timer;
+    };
+}
+
+#endif // TIMERWHEEL_H
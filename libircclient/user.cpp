@@ -11,6 +11,7 @@
 // Copyright (c) Petr Bena 2015 - 2019
 
 #include "user.h"
+#include "../libirc/binaryserializer.h"
 
 using namespace libircclient;
 
@@ -36,27 +37,30 @@ User::User(const QString &user) : libirc::User(user)
 User::User(User *user) : libirc::User(user)
 {
     this->IsAway = user->IsAway;
+    this->AwayMs = user->AwayMs;
+    this->ServerName = user->ServerName;
     this->Hops = user->Hops;
     this->ChannelPrefixes = user->ChannelPrefixes;
     this->CUModes = user->CUModes;
 }
 
-QString User::GetPrefixedNick()
+void User::UpdateFrom(User *user)
 {
-    QString nick = this->GetNick();
-    if (!this->ChannelPrefixes.isEmpty())
-        nick = QChar(this->ChannelPrefixes[0]) + nick;
-
-    return nick;
+    // Nick may differ in case only, so it's always taken from newer record
+    this->SetNick(user->GetNick());
+    if (!user->GetHost().isEmpty())
+        this->SetHost(user->GetHost());
+    if (!user->GetIdent().isEmpty())
+        this->SetIdent(user->GetIdent());
+    if (!user->GetRealname().isEmpty())
+        this->SetRealname(user->GetRealname());
+    if (!user->ServerName.isEmpty())
+        SERIALIZED_SET(ServerName, user->ServerName);
 }
 
-char User::GetHighestCUMode()
+QList<Channel *> User::GetChannels() const
 {
-    if (this->CUModes.isEmpty())
-        return 0;
-
-    // Get a mode with index 0 as that is meant to be highest
-    return this->CUModes[0];
+    return this->channels;
 }
 
 void User::LoadHash(const QHash<QString, QVariant> &hash)
@@ -81,4 +85,21 @@ QHash<QString, QVariant> User::ToHash()
     return hash;
 }
 
+void User::writeBinaryFields(libirc::BinaryWriter &writer)
+{
+    this->writeMemberFields(writer, this->CUModes, this->ChannelPrefixes);
+}
+
+void User::writeMemberFields(libirc::BinaryWriter &writer, const QList<char> &cu_modes, const QList<char> &prefixes)
+{
+    libirc::User::writeBinaryFields(writer);
+    writer.WriteField("ChannelPrefixes");
+    writer.WriteCharList(prefixes);
+    writer.WriteField("CUModes");
+    writer.WriteCharList(cu_modes);
+    SERIALIZE_BINARY(ServerName);
+    SERIALIZE_BINARY(IsAway);
+    SERIALIZE_BINARY(AwayMs);
+}
+
 
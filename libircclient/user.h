@@ -13,11 +13,21 @@
 #ifndef USER_H
 #define USER_H
 
+#include <QList>
 #include "../libirc/user.h"
 #include "libircclient_global.h"
 
 namespace libircclient
 {
+    class Channel;
+
+    /*!
+     * \brief The User class is a record of IRC user
+     *
+     * Users that belong to channel of network are shared by all channels the user is in, so they don't hold any
+     * channel specific information, such as channel user modes. These are provided by Channel, see
+     * Channel::GetUserCUModes(), Channel::GetUserPrefixes() and Channel::GetPrefixedNick().
+     */
     class LIBIRCCLIENTSHARED_EXPORT User : public libirc::User
     {
         public:
@@ -25,19 +35,32 @@ namespace libircclient
             User(const QHash<QString, QVariant> &hash);
             User(const QString &user);
             User(User *user);
-            QString GetPrefixedNick();
-            char GetHighestCUMode();
-            QList<char> ChannelPrefixes;
+            //! Updates information about user from other object, empty values are ignored, so that user
+            //! inserted from NAMES doesn't remove host we already know from other channel
+            void UpdateFrom(User *user);
+            //! Returns channels of network that contain this user, this is only filled in for users that are
+            //! returned by Channel, these users are shared by all channels of same network
+            QList<Channel*> GetChannels() const;
             QString ServerName;
-            QList<char> CUModes;
             QString AwayMs;
             bool IsAway;
             int Hops;
             void LoadHash(const QHash<QString, QVariant> &hash) override;
             QHash<QString, QVariant> ToHash() override;
 
+        protected:
+            void writeBinaryFields(libirc::BinaryWriter &writer) override;
 
         private:
+            friend class Channel;
+            //! Writes fields of this user with channel user modes given by caller, channel uses this to write its
+            //! members straight from shared records, without making a copy of each of them
+            void writeMemberFields(libirc::BinaryWriter &writer, const QList<char> &cu_modes, const QList<char> &prefixes);
+            //! Channel user modes and their prefixes, these are only used by copies that carry the modes of one
+            //! channel when it's serialized or loaded, they are always empty in records of channel
+            QList<char> ChannelPrefixes;
+            QList<char> CUModes;
+            QList<Channel*> channels;
 
     };
 }